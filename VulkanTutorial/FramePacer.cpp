@@ -0,0 +1,45 @@
+#include "FramePacer.h"
+
+#include <thread>
+
+FramePacer::FramePacer(double targetFrameRate)
+{
+    SetTargetFrameRate(targetFrameRate);
+}
+
+void FramePacer::SetTargetFrameRate(double targetFrameRate)
+{
+    targetFrameRate_ = targetFrameRate > 0.0 ? targetFrameRate : 0.0;
+    framePeriod_ = targetFrameRate_ > 0.0
+        ? std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / targetFrameRate_))
+        : Clock::duration{};
+    nextFrame_ = Clock::now();
+}
+
+void FramePacer::Wait()
+{
+    if (targetFrameRate_ <= 0.0)
+    {
+        return;
+    }
+
+    Clock::time_point now = Clock::now();
+    if (nextFrame_ - now > SPIN_MARGIN)
+    {
+        std::this_thread::sleep_until(nextFrame_ - SPIN_MARGIN);
+    }
+
+    while (Clock::now() < nextFrame_)
+    {
+        std::this_thread::yield();
+    }
+
+    // Deadlines advance by whole periods to keep the cadence steady. A frame that ran more than a period
+    // late restarts the schedule rather than letting the following frames run back to back to catch up
+    nextFrame_ += framePeriod_;
+    now = Clock::now();
+    if (nextFrame_ < now)
+    {
+        nextFrame_ = now + framePeriod_;
+    }
+}
@@ -0,0 +1,32 @@
+#pragma once
+#ifndef FRAME_PACER_H
+#define FRAME_PACER_H
+
+#include <chrono>
+
+// Limits the frame rate by holding the CPU back until shortly before each frame's target time, so that
+// input is sampled as late as possible instead of frames queueing up behind the presentation engine.
+// Most of the wait is spent asleep, the final stretch is spun because sleeps overshoot by up to a scheduler tick.
+class FramePacer
+{
+public:
+    // A target of zero disables pacing
+    FramePacer(double targetFrameRate = 0.0);
+
+    void SetTargetFrameRate(double targetFrameRate);
+    double GetTargetFrameRate() const { return targetFrameRate_; }
+
+    // Returns once the next frame is due. Call right before sampling input for the frame
+    void Wait();
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    // Sleeps are only trusted to wake up within this margin of the deadline
+    static constexpr std::chrono::microseconds SPIN_MARGIN{ 2000 };
+
+    double targetFrameRate_ = 0.0;
+    Clock::duration framePeriod_{};
+    Clock::time_point nextFrame_;
+};
+#endif // FRAME_PACER_H
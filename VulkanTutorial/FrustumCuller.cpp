@@ -0,0 +1,178 @@
+#include "FrustumCuller.h"
+
+#include <bit>
+#include <cmath>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define FRUSTUM_CULLER_AVX
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define FRUSTUM_CULLER_SSE
+#endif
+
+// Half extent of unused slots. Negative enough that the box lies behind every plane
+static const float EMPTY_EXTENT = -1e30f;
+
+// Planes as (a, b, c, d) with a*x + b*y + c*z + d >= 0 inside the frustum and (a, b, c) of unit length
+static void ExtractPlanes(const glm::mat4& m, glm::vec4 planes[6])
+{
+    // Rows of the matrix, glm stores it column major
+    glm::vec4 rows[4];
+    for (int i = 0; i < 4; ++i)
+    {
+        rows[i] = glm::vec4(m[0][i], m[1][i], m[2][i], m[3][i]);
+    }
+
+    planes[0] = rows[3] + rows[0];
+    planes[1] = rows[3] - rows[0];
+    planes[2] = rows[3] + rows[1];
+    planes[3] = rows[3] - rows[1];
+#ifdef GLM_FORCE_DEPTH_ZERO_TO_ONE
+    planes[4] = rows[2];
+#else
+    planes[4] = rows[3] + rows[2];
+#endif
+    planes[5] = rows[3] - rows[2];
+
+    for (int i = 0; i < 6; ++i)
+    {
+        float length = std::sqrt(planes[i].x * planes[i].x + planes[i].y * planes[i].y + planes[i].z * planes[i].z);
+        planes[i] = planes[i] / length;
+    }
+}
+
+void FrustumCuller::Resize(uint32_t count)
+{
+    uint32_t paddedCount = (count + BLOCK_SIZE - 1) / BLOCK_SIZE * BLOCK_SIZE;
+
+    // Slots past the count must stay empty, they are tested along with the rest of their block
+    for (uint32_t i = count; i < count_; ++i)
+    {
+        extentX_[i] = extentY_[i] = extentZ_[i] = EMPTY_EXTENT;
+    }
+
+    centreX_.resize(paddedCount, 0.0f);
+    centreY_.resize(paddedCount, 0.0f);
+    centreZ_.resize(paddedCount, 0.0f);
+    extentX_.resize(paddedCount, EMPTY_EXTENT);
+    extentY_.resize(paddedCount, EMPTY_EXTENT);
+    extentZ_.resize(paddedCount, EMPTY_EXTENT);
+    count_ = count;
+}
+
+void FrustumCuller::SetBounds(uint32_t index, const glm::vec3& min, const glm::vec3& max)
+{
+    glm::vec3 centre = (min + max) * 0.5f;
+    glm::vec3 extent = (max - min) * 0.5f;
+
+    centreX_[index] = centre.x;
+    centreY_[index] = centre.y;
+    centreZ_[index] = centre.z;
+    extentX_[index] = extent.x;
+    extentY_[index] = extent.y;
+    extentZ_[index] = extent.z;
+}
+
+void FrustumCuller::Cull(const glm::mat4& viewProjection, std::vector<uint32_t>& visible) const
+{
+    glm::vec4 planes[6];
+    ExtractPlanes(viewProjection, planes);
+
+    visible.clear();
+
+    // A box is outside once it lies entirely behind any plane: the signed distance of its centre plus its
+    // projected radius |a| * ex + |b| * ey + |c| * ez is negative
+    for (uint32_t first = 0; first < count_; first += BLOCK_SIZE)
+    {
+        uint32_t insideMask = 0;
+
+#if defined(FRUSTUM_CULLER_AVX)
+        __m256 cx = _mm256_loadu_ps(&centreX_[first]);
+        __m256 cy = _mm256_loadu_ps(&centreY_[first]);
+        __m256 cz = _mm256_loadu_ps(&centreZ_[first]);
+        __m256 ex = _mm256_loadu_ps(&extentX_[first]);
+        __m256 ey = _mm256_loadu_ps(&extentY_[first]);
+        __m256 ez = _mm256_loadu_ps(&extentZ_[first]);
+        __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+
+        for (const glm::vec4& plane : planes)
+        {
+            __m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(cx, _mm256_set1_ps(plane.x)),
+                _mm256_mul_ps(cy, _mm256_set1_ps(plane.y))), _mm256_add_ps(_mm256_mul_ps(cz, _mm256_set1_ps(plane.z)),
+                _mm256_set1_ps(plane.w)));
+            __m256 radius = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(ex, _mm256_set1_ps(std::fabs(plane.x))),
+                _mm256_mul_ps(ey, _mm256_set1_ps(std::fabs(plane.y)))),
+                _mm256_mul_ps(ez, _mm256_set1_ps(std::fabs(plane.z))));
+            inside = _mm256_and_ps(inside, _mm256_cmp_ps(_mm256_add_ps(distance, radius), _mm256_setzero_ps(),
+                _CMP_GE_OQ));
+        }
+        insideMask = (uint32_t)_mm256_movemask_ps(inside);
+#elif defined(FRUSTUM_CULLER_SSE)
+        for (uint32_t half = 0; half < BLOCK_SIZE; half += 4)
+        {
+            uint32_t offset = first + half;
+            __m128 cx = _mm_loadu_ps(&centreX_[offset]);
+            __m128 cy = _mm_loadu_ps(&centreY_[offset]);
+            __m128 cz = _mm_loadu_ps(&centreZ_[offset]);
+            __m128 ex = _mm_loadu_ps(&extentX_[offset]);
+            __m128 ey = _mm_loadu_ps(&extentY_[offset]);
+            __m128 ez = _mm_loadu_ps(&extentZ_[offset]);
+            __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+
+            for (const glm::vec4& plane : planes)
+            {
+                __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(cx, _mm_set1_ps(plane.x)),
+                    _mm_mul_ps(cy, _mm_set1_ps(plane.y))), _mm_add_ps(_mm_mul_ps(cz, _mm_set1_ps(plane.z)),
+                    _mm_set1_ps(plane.w)));
+                __m128 radius = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ex, _mm_set1_ps(std::fabs(plane.x))),
+                    _mm_mul_ps(ey, _mm_set1_ps(std::fabs(plane.y)))), _mm_mul_ps(ez, _mm_set1_ps(std::fabs(plane.z))));
+                inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(distance, radius), _mm_setzero_ps()));
+            }
+            insideMask |= (uint32_t)_mm_movemask_ps(inside) << half;
+        }
+#else
+        for (uint32_t lane = 0; lane < BLOCK_SIZE; ++lane)
+        {
+            uint32_t i = first + lane;
+            bool inside = true;
+            for (const glm::vec4& plane : planes)
+            {
+                float distance = centreX_[i] * plane.x + centreY_[i] * plane.y + centreZ_[i] * plane.z + plane.w;
+                float radius = extentX_[i] * std::fabs(plane.x) + extentY_[i] * std::fabs(plane.y)
+                    + extentZ_[i] * std::fabs(plane.z);
+                inside = inside && distance + radius >= 0.0f;
+            }
+            insideMask |= (inside ? 1u : 0u) << lane;
+        }
+#endif
+
+        // Padding slots are empty boxes, so every set bit is a real slot
+        while (insideMask != 0)
+        {
+            visible.push_back(first + (uint32_t)std::countr_zero(insideMask));
+            insideMask &= insideMask - 1;
+        }
+    }
+}
+
+void FrustumCuller::TransformBox(const glm::mat4& transform, const glm::vec3& min, const glm::vec3& max,
+    glm::vec3& transformedMin, glm::vec3& transformedMax)
+{
+    // Arvo's method: the new half extent along each axis is the extent projected through the absolute matrix
+    glm::vec3 centre = (min + max) * 0.5f;
+    glm::vec3 extent = (max - min) * 0.5f;
+
+    glm::vec3 newCentre = glm::vec3(transform * glm::vec4(centre, 1.0f));
+    glm::vec3 newExtent(0.0f);
+    for (int row = 0; row < 3; ++row)
+    {
+        for (int column = 0; column < 3; ++column)
+        {
+            newExtent[row] += std::fabs(transform[column][row]) * extent[column];
+        }
+    }
+
+    transformedMin = newCentre - newExtent;
+    transformedMax = newCentre + newExtent;
+}
@@ -0,0 +1,42 @@
+#pragma once
+#ifndef FRUSTUM_CULLER_H
+#define FRUSTUM_CULLER_H
+
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+
+// Tests world space bounding boxes against the six planes of a view frustum. The boxes are kept as a structure of
+// arrays, so that the test runs over 8 boxes per instruction with AVX, 4 with SSE and one at a time elsewhere.
+class FrustumCuller
+{
+public:
+    // Boxes are stored in blocks of this many, the widest SIMD width in use
+    static constexpr uint32_t BLOCK_SIZE = 8;
+
+    // Slots are indexed by the caller's ids. New slots hold empty boxes, which are never visible
+    void Resize(uint32_t count);
+    uint32_t GetCount() const { return count_; }
+
+    void SetBounds(uint32_t index, const glm::vec3& min, const glm::vec3& max);
+
+    // Replaces visible with the indices of every box that intersects the frustum of viewProjection, in ascending
+    // order. Boxes that straddle a plane count as visible
+    void Cull(const glm::mat4& viewProjection, std::vector<uint32_t>& visible) const;
+
+    // Box around the corners of the box [min, max] after transform
+    static void TransformBox(const glm::mat4& transform, const glm::vec3& min, const glm::vec3& max,
+        glm::vec3& transformedMin, glm::vec3& transformedMax);
+
+private:
+    uint32_t count_ = 0;
+
+    // Centres and half extents, padded to whole blocks
+    std::vector<float> centreX_;
+    std::vector<float> centreY_;
+    std::vector<float> centreZ_;
+    std::vector<float> extentX_;
+    std::vector<float> extentY_;
+    std::vector<float> extentZ_;
+};
+#endif // FRUSTUM_CULLER_H
@@ -0,0 +1,91 @@
+#include "GeometryPool.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+
+// The index allocator's unit, one 16-bit index
+static const VkDeviceSize INDEX_UNIT_SIZE = sizeof(uint16_t);
+
+static VkDeviceSize GetIndexUnits(VkIndexType indexType)
+{
+    return indexType == VK_INDEX_TYPE_UINT16 ? 1 : 2;
+}
+
+GeometryPool::GeometryPool(MemoryAllocator& allocator, UploadManager& uploadManager, uint32_t vertexStride,
+    uint32_t vertexCapacity, uint32_t indexCapacity) : allocator_(allocator), uploadManager_(uploadManager),
+    vertexStride_(vertexStride), vertexRanges_(vertexCapacity),
+    indexRanges_((VkDeviceSize)indexCapacity * GetIndexUnits(VK_INDEX_TYPE_UINT32))
+{
+    allocator_.CreateBuffer((VkDeviceSize)vertexStride_ * vertexCapacity,
+        VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+        vertexBuffer_, vertexBufferMemory_);
+    allocator_.CreateBuffer((VkDeviceSize)sizeof(uint32_t) * indexCapacity,
+        VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+        indexBuffer_, indexBufferMemory_);
+}
+
+GeometryPool::~GeometryPool()
+{
+    allocator_.DestroyBuffer(vertexBuffer_, vertexBufferMemory_);
+    allocator_.DestroyBuffer(indexBuffer_, indexBufferMemory_);
+}
+
+GeometryRange GeometryPool::Allocate(const void* vertexData, uint32_t vertexCount, const uint32_t* indices,
+    uint32_t indexCount)
+{
+    if (vertexCount > MAX_16BIT_INDEXED_VERTICES)
+    {
+        return Allocate(vertexData, vertexCount, indices, VK_INDEX_TYPE_UINT32, indexCount);
+    }
+
+    // The upload copies the data straight away, so the narrowed indices only have to outlive the call
+    std::vector<uint16_t> narrowIndices(indices, indices + indexCount);
+    return Allocate(vertexData, vertexCount, narrowIndices.data(), VK_INDEX_TYPE_UINT16, indexCount);
+}
+
+GeometryRange GeometryPool::Allocate(const void* vertexData, uint32_t vertexCount, const void* indexData,
+    VkIndexType indexType, uint32_t indexCount)
+{
+    if (indexType == VK_INDEX_TYPE_UINT16 && vertexCount > MAX_16BIT_INDEXED_VERTICES)
+    {
+        throw std::runtime_error("Mesh has too many vertices for 16-bit indices!");
+    }
+
+    VkDeviceSize vertexOffset = vertexRanges_.Allocate(vertexCount, 1);
+    if (vertexOffset == RangeAllocator::INVALID_OFFSET)
+    {
+        throw std::runtime_error("Geometry pool is out of vertex space!");
+    }
+
+    // Aligning 32-bit indices to two units keeps their byte offset a multiple of their size
+    VkDeviceSize indexUnits = GetIndexUnits(indexType);
+    VkDeviceSize firstIndexUnit = indexRanges_.Allocate(indexCount * indexUnits, indexUnits);
+    if (firstIndexUnit == RangeAllocator::INVALID_OFFSET)
+    {
+        vertexRanges_.Free(vertexOffset, vertexCount);
+        throw std::runtime_error("Geometry pool is out of index space!");
+    }
+
+    GeometryRange range;
+    range.firstIndex = (uint32_t)(firstIndexUnit / indexUnits);
+    range.indexCount = indexCount;
+    range.vertexOffset = (int32_t)vertexOffset;
+    range.vertexCount = vertexCount;
+    range.indexType = indexType;
+
+    uint64_t vertexTicket = uploadManager_.Upload(vertexData, (VkDeviceSize)vertexStride_ * vertexCount,
+        vertexBuffer_, vertexOffset * vertexStride_);
+    uint64_t indexTicket = uploadManager_.Upload(indexData, indexCount * indexUnits * INDEX_UNIT_SIZE, indexBuffer_,
+        firstIndexUnit * INDEX_UNIT_SIZE);
+    range.uploadTicket = std::max(vertexTicket, indexTicket);
+
+    return range;
+}
+
+void GeometryPool::Free(const GeometryRange& range)
+{
+    vertexRanges_.Free((VkDeviceSize)range.vertexOffset, range.vertexCount);
+    VkDeviceSize indexUnits = GetIndexUnits(range.indexType);
+    indexRanges_.Free(range.firstIndex * indexUnits, range.indexCount * indexUnits);
+}
@@ -0,0 +1,79 @@
+#pragma once
+#ifndef GEOMETRY_POOL_H
+#define GEOMETRY_POOL_H
+
+#include <vulkan/vulkan.h>
+
+#include "MemoryAllocator.h"
+#include "RangeAllocator.h"
+#include "UploadManager.h"
+
+// Location of one mesh inside the pool, in the units vkCmdDrawIndexed expects
+struct GeometryRange
+{
+    // Counted in indices of indexType
+    uint32_t firstIndex = 0;
+    uint32_t indexCount = 0;
+    int32_t vertexOffset = 0;
+    uint32_t vertexCount = 0;
+
+    // 16-bit whenever every index of the mesh fits, the index buffer is bound with this type to draw it
+    VkIndexType indexType = VK_INDEX_TYPE_UINT32;
+
+    // The range may be drawn from once the UploadManager reports this ticket as complete
+    uint64_t uploadTicket = 0;
+};
+
+// One shared device local vertex buffer and one shared index buffer that meshes are sub-allocated
+// from, so that any number of meshes can be drawn after binding the buffers a single time. Indices
+// are stored relative to their mesh and rebased at draw time through the vertex offset, which is also
+// what lets meshes of up to 65536 vertices use 16-bit indices wherever they are placed in the pool.
+class GeometryPool
+{
+public:
+    // Meshes with at most this many vertices are stored with 16-bit indices. Primitive restart is never
+    // enabled, so 0xFFFF is an ordinary index
+    static constexpr uint32_t MAX_16BIT_INDEXED_VERTICES = 0x10000;
+
+    // indexCapacity counts 32-bit indices, twice as many 16-bit indices fit in the same space
+    GeometryPool(MemoryAllocator& allocator, UploadManager& uploadManager, uint32_t vertexStride,
+        uint32_t vertexCapacity, uint32_t indexCapacity);
+    ~GeometryPool();
+
+    GeometryPool(const GeometryPool&) = delete;
+    GeometryPool& operator=(const GeometryPool&) = delete;
+
+    // Reserves space for the mesh and queues its upload, narrowing the indices when they fit into 16 bits.
+    // Throws when the pool is full
+    GeometryRange Allocate(const void* vertexData, uint32_t vertexCount, const uint32_t* indices,
+        uint32_t indexCount);
+
+    // Uploads indices that are already stored as indexType, such as a mesh file's index blob, without
+    // converting them. 16-bit indices are only valid for meshes of up to MAX_16BIT_INDEXED_VERTICES vertices
+    GeometryRange Allocate(const void* vertexData, uint32_t vertexCount, const void* indexData,
+        VkIndexType indexType, uint32_t indexCount);
+
+    // The caller must make sure that no submitted work still reads from the range
+    void Free(const GeometryRange& range);
+
+    VkBuffer GetVertexBuffer() const { return vertexBuffer_; }
+
+    // Holds indices of both types. Bind it at offset zero with the range's index type
+    VkBuffer GetIndexBuffer() const { return indexBuffer_; }
+    uint32_t GetVertexStride() const { return vertexStride_; }
+
+private:
+    MemoryAllocator& allocator_;
+    UploadManager& uploadManager_;
+    uint32_t vertexStride_;
+
+    VkBuffer vertexBuffer_ = VK_NULL_HANDLE;
+    MemoryAllocation vertexBufferMemory_;
+    VkBuffer indexBuffer_ = VK_NULL_HANDLE;
+    MemoryAllocation indexBufferMemory_;
+
+    // Vertices are counted in elements and indices in 16-bit units, 32-bit indices take two aligned units
+    RangeAllocator vertexRanges_;
+    RangeAllocator indexRanges_;
+};
+#endif // GEOMETRY_POOL_H
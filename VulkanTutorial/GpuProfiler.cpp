@@ -0,0 +1,351 @@
+#include "GpuProfiler.h"
+
+#include <algorithm>
+#include <iterator>
+#include <stdexcept>
+
+// The counters collected by the statistics query, in the order the results are written
+static const VkQueryPipelineStatisticFlags STATISTICS_FLAGS =
+    VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_VERTICES_BIT |
+    VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_PRIMITIVES_BIT |
+    VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT |
+    VK_QUERY_PIPELINE_STATISTIC_CLIPPING_INVOCATIONS_BIT |
+    VK_QUERY_PIPELINE_STATISTIC_CLIPPING_PRIMITIVES_BIT |
+    VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT;
+
+GpuProfiler::GpuProfiler(VkPhysicalDevice physicalDevice, VkDevice device, uint32_t queueFamilyIndex,
+    uint32_t frameCount, bool pipelineStatistics, uint32_t maxScopesPerFrame) : device_(device),
+    maxScopes_(maxScopesPerFrame)
+{
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+
+    uint32_t queueFamilyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+    std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilies.data());
+
+    // Timestamps are only meaningful when the queue writes valid bits
+    uint32_t validBits = queueFamilyIndex < queueFamilyCount ? queueFamilies[queueFamilyIndex].timestampValidBits : 0;
+    timestampsSupported_ = validBits > 0;
+    timestampPeriodNs_ = properties.limits.timestampPeriod;
+    timestampMask_ = validBits >= 64 ? ~0ULL : ((1ULL << validBits) - 1);
+    statisticsFlags_ = pipelineStatistics ? STATISTICS_FLAGS : 0;
+
+    frames_.resize(frameCount);
+    for (FrameQueries& frame : frames_)
+    {
+        VkQueryPoolCreateInfo poolCreateInfo{};
+        poolCreateInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+
+        if (timestampsSupported_)
+        {
+            // Every scope writes a timestamp at its start and at its end
+            poolCreateInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+            poolCreateInfo.queryCount = maxScopes_ * 2;
+
+            if (vkCreateQueryPool(device_, &poolCreateInfo, nullptr, &frame.timestampPool) != VK_SUCCESS)
+            {
+                throw std::runtime_error("Failed to create a timestamp Query Pool!");
+            }
+        }
+
+        if (statisticsFlags_)
+        {
+            poolCreateInfo.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+            poolCreateInfo.queryCount = 1;
+            poolCreateInfo.pipelineStatistics = statisticsFlags_;
+
+            if (vkCreateQueryPool(device_, &poolCreateInfo, nullptr, &frame.statisticsPool) != VK_SUCCESS)
+            {
+                throw std::runtime_error("Failed to create a pipeline statistics Query Pool!");
+            }
+        }
+    }
+
+    cpuFrameStart_ = Clock::now();
+}
+
+GpuProfiler::~GpuProfiler()
+{
+    for (FrameQueries& frame : frames_)
+    {
+        vkDestroyQueryPool(device_, frame.timestampPool, nullptr);
+        vkDestroyQueryPool(device_, frame.statisticsPool, nullptr);
+    }
+}
+
+void GpuProfiler::SetOutput(const std::string& path)
+{
+    output_.open(path, std::ios::trunc);
+    if (!output_.is_open())
+    {
+        throw std::runtime_error("Failed to open file: " + path);
+    }
+
+    outputJson_ = path.size() >= 5 && path.compare(path.size() - 5, 5, ".json") == 0;
+    if (!outputJson_)
+    {
+        output_ << "frame,type,name,start_ms,duration_ms,count\n";
+    }
+}
+
+void GpuProfiler::BeginFrame(uint32_t frameIndex)
+{
+    currentFrame_ = frameIndex;
+    FrameQueries& frame = frames_[currentFrame_];
+
+    if (frame.submitted)
+    {
+        CollectResults(frame);
+        frame.submitted = false;
+    }
+
+    cpuScopes_.clear();
+    cpuScopeStarts_.clear();
+    cpuFrameStart_ = Clock::now();
+}
+
+void GpuProfiler::EndFrame()
+{
+    FrameQueries& frame = frames_[currentFrame_];
+    frame.submitted = true;
+    frame.frameNumber = frameNumber_++;
+    frame.cpuScopes = cpuScopes_;
+}
+
+void GpuProfiler::CollectPending()
+{
+    // Report in submission order, which is not slot order once the ring has wrapped
+    std::vector<FrameQueries*> pending;
+    for (FrameQueries& frame : frames_)
+    {
+        if (frame.submitted)
+        {
+            pending.push_back(&frame);
+        }
+    }
+    std::sort(pending.begin(), pending.end(), [](const FrameQueries* a, const FrameQueries* b)
+    {
+        return a->frameNumber < b->frameNumber;
+    });
+
+    for (FrameQueries* frame : pending)
+    {
+        CollectResults(*frame);
+        frame->submitted = false;
+    }
+
+    output_.flush();
+}
+
+void GpuProfiler::BeginRecording(uint32_t frameIndex)
+{
+    recordingFrame_ = frameIndex;
+    frames_[recordingFrame_].gpuScopes.clear();
+    frames_[recordingFrame_].recordedStatistics = false;
+}
+
+void GpuProfiler::ResetQueries(VkCommandBuffer commandBuffer)
+{
+    FrameQueries& frame = frames_[recordingFrame_];
+
+    if (frame.timestampPool != VK_NULL_HANDLE)
+    {
+        vkCmdResetQueryPool(commandBuffer, frame.timestampPool, 0, maxScopes_ * 2);
+    }
+    if (frame.statisticsPool != VK_NULL_HANDLE)
+    {
+        vkCmdResetQueryPool(commandBuffer, frame.statisticsPool, 0, 1);
+    }
+}
+
+uint32_t GpuProfiler::BeginGpuScope(VkCommandBuffer commandBuffer, const std::string& name)
+{
+    FrameQueries& frame = frames_[recordingFrame_];
+    if (frame.timestampPool == VK_NULL_HANDLE)
+    {
+        return INVALID_SCOPE;
+    }
+
+    uint32_t scope;
+    {
+        std::lock_guard<std::mutex> lock(scopeMutex_);
+        if (frame.gpuScopes.size() >= maxScopes_)
+        {
+            return INVALID_SCOPE;
+        }
+        scope = (uint32_t)frame.gpuScopes.size();
+        frame.gpuScopes.push_back(name);
+    }
+
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, frame.timestampPool, scope * 2);
+    return scope;
+}
+
+void GpuProfiler::EndGpuScope(VkCommandBuffer commandBuffer, uint32_t scope)
+{
+    if (scope == INVALID_SCOPE)
+    {
+        return;
+    }
+
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, frames_[recordingFrame_].timestampPool,
+        scope * 2 + 1);
+}
+
+void GpuProfiler::BeginStatistics(VkCommandBuffer commandBuffer)
+{
+    FrameQueries& frame = frames_[recordingFrame_];
+    if (frame.statisticsPool != VK_NULL_HANDLE)
+    {
+        vkCmdBeginQuery(commandBuffer, frame.statisticsPool, 0, 0);
+        frame.recordedStatistics = true;
+    }
+}
+
+void GpuProfiler::EndStatistics(VkCommandBuffer commandBuffer)
+{
+    FrameQueries& frame = frames_[recordingFrame_];
+    if (frame.recordedStatistics)
+    {
+        vkCmdEndQuery(commandBuffer, frame.statisticsPool, 0);
+    }
+}
+
+uint32_t GpuProfiler::BeginCpuScope(const std::string& name)
+{
+    ProfileScope scope;
+    scope.name = name;
+    cpuScopes_.push_back(scope);
+    cpuScopeStarts_.push_back(Clock::now());
+
+    return (uint32_t)cpuScopes_.size() - 1;
+}
+
+void GpuProfiler::EndCpuScope(uint32_t scope)
+{
+    Clock::time_point now = Clock::now();
+
+    ProfileScope& cpuScope = cpuScopes_[scope];
+    cpuScope.startMs = std::chrono::duration<double, std::milli>(cpuScopeStarts_[scope] - cpuFrameStart_).count();
+    cpuScope.durationMs = std::chrono::duration<double, std::milli>(now - cpuScopeStarts_[scope]).count();
+}
+
+void GpuProfiler::CollectResults(FrameQueries& frame)
+{
+    FrameProfile profile;
+    profile.frameNumber = frame.frameNumber;
+    profile.scopes = std::move(frame.cpuScopes);
+
+    // The frame's fence has signalled, so the results are available and no wait is requested. Anything
+    // that is somehow still not ready is dropped rather than stalling the frame
+    uint32_t queryCount = (uint32_t)frame.gpuScopes.size() * 2;
+    if (queryCount > 0)
+    {
+        std::vector<uint64_t> timestamps(queryCount);
+        VkResult result = vkGetQueryPoolResults(device_, frame.timestampPool, 0, queryCount,
+            timestamps.size() * sizeof(uint64_t), timestamps.data(), sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+
+        if (result == VK_SUCCESS)
+        {
+            uint64_t frameStart = timestamps[0] & timestampMask_;
+            for (uint64_t timestamp : timestamps)
+            {
+                frameStart = std::min(frameStart, timestamp & timestampMask_);
+            }
+
+            for (size_t i = 0; i < frame.gpuScopes.size(); ++i)
+            {
+                uint64_t begin = timestamps[i * 2] & timestampMask_;
+                uint64_t end = timestamps[i * 2 + 1] & timestampMask_;
+
+                ProfileScope scope;
+                scope.name = frame.gpuScopes[i];
+                scope.gpu = true;
+                scope.startMs = (begin - frameStart) * timestampPeriodNs_ / 1e6;
+                scope.durationMs = (end >= begin ? end - begin : 0) * timestampPeriodNs_ / 1e6;
+                profile.scopes.push_back(scope);
+            }
+        }
+    }
+
+    if (frame.recordedStatistics)
+    {
+        uint64_t counters[6] = {};
+        VkResult result = vkGetQueryPoolResults(device_, frame.statisticsPool, 0, 1, sizeof(counters), counters,
+            sizeof(counters), VK_QUERY_RESULT_64_BIT);
+
+        if (result == VK_SUCCESS)
+        {
+            profile.hasStatistics = true;
+            profile.statistics.inputAssemblyVertices = counters[0];
+            profile.statistics.inputAssemblyPrimitives = counters[1];
+            profile.statistics.vertexShaderInvocations = counters[2];
+            profile.statistics.clippingInvocations = counters[3];
+            profile.statistics.clippingPrimitives = counters[4];
+            profile.statistics.fragmentShaderInvocations = counters[5];
+        }
+    }
+
+    Export(profile);
+    lastFrame_ = std::move(profile);
+}
+
+void GpuProfiler::Export(const FrameProfile& profile)
+{
+    if (!output_.is_open())
+    {
+        return;
+    }
+
+    const std::pair<const char*, uint64_t> counters[] = {
+        { "input_assembly_vertices", profile.statistics.inputAssemblyVertices },
+        { "input_assembly_primitives", profile.statistics.inputAssemblyPrimitives },
+        { "vertex_shader_invocations", profile.statistics.vertexShaderInvocations },
+        { "clipping_invocations", profile.statistics.clippingInvocations },
+        { "clipping_primitives", profile.statistics.clippingPrimitives },
+        { "fragment_shader_invocations", profile.statistics.fragmentShaderInvocations },
+    };
+
+    if (outputJson_)
+    {
+        // Scope names are chosen by the renderer and never need escaping
+        output_ << "{\"frame\":" << profile.frameNumber << ",\"scopes\":[";
+        for (size_t i = 0; i < profile.scopes.size(); ++i)
+        {
+            const ProfileScope& scope = profile.scopes[i];
+            output_ << (i > 0 ? "," : "") << "{\"name\":\"" << scope.name << "\",\"type\":\""
+                << (scope.gpu ? "gpu" : "cpu") << "\",\"start_ms\":" << scope.startMs << ",\"duration_ms\":"
+                << scope.durationMs << "}";
+        }
+        output_ << "]";
+
+        if (profile.hasStatistics)
+        {
+            output_ << ",\"statistics\":{";
+            for (size_t i = 0; i < std::size(counters); ++i)
+            {
+                output_ << (i > 0 ? "," : "") << "\"" << counters[i].first << "\":" << counters[i].second;
+            }
+            output_ << "}";
+        }
+        output_ << "}\n";
+    }
+    else
+    {
+        for (const ProfileScope& scope : profile.scopes)
+        {
+            output_ << profile.frameNumber << "," << (scope.gpu ? "gpu" : "cpu") << "," << scope.name << ","
+                << scope.startMs << "," << scope.durationMs << ",\n";
+        }
+
+        if (profile.hasStatistics)
+        {
+            for (const auto& counter : counters)
+            {
+                output_ << profile.frameNumber << ",statistic," << counter.first << ",,," << counter.second << "\n";
+            }
+        }
+    }
+}
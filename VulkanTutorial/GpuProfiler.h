@@ -0,0 +1,137 @@
+#pragma once
+#ifndef GPU_PROFILER_H
+#define GPU_PROFILER_H
+
+#include <vulkan/vulkan.h>
+#include <chrono>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// A timed region of a frame, measured on the GPU with timestamp queries or on the CPU with a clock
+struct ProfileScope
+{
+    std::string name;
+    bool gpu = false;
+
+    // Relative to the start of the frame on the respective timeline
+    double startMs = 0.0;
+    double durationMs = 0.0;
+};
+
+// Counters from the pipeline statistics query around the frame's render pass
+struct PipelineStatistics
+{
+    uint64_t inputAssemblyVertices = 0;
+    uint64_t inputAssemblyPrimitives = 0;
+    uint64_t vertexShaderInvocations = 0;
+    uint64_t clippingInvocations = 0;
+    uint64_t clippingPrimitives = 0;
+    uint64_t fragmentShaderInvocations = 0;
+};
+
+struct FrameProfile
+{
+    uint64_t frameNumber = 0;
+    std::vector<ProfileScope> scopes;
+
+    bool hasStatistics = false;
+    PipelineStatistics statistics;
+};
+
+// Collects GPU timestamps, pipeline statistics and CPU scope timings per frame. Query pools are
+// ringed over the frames in flight and a frame's results are only read once its fence has signalled,
+// so collecting them never stalls. Completed frames can be exported as CSV or as one JSON object per line.
+class GpuProfiler
+{
+public:
+    static constexpr uint32_t INVALID_SCOPE = ~0U;
+
+    GpuProfiler(VkPhysicalDevice physicalDevice, VkDevice device, uint32_t queueFamilyIndex, uint32_t frameCount,
+        bool pipelineStatistics, uint32_t maxScopesPerFrame = 64);
+    ~GpuProfiler();
+
+    GpuProfiler(const GpuProfiler&) = delete;
+    GpuProfiler& operator=(const GpuProfiler&) = delete;
+
+    // Writes every completed frame to the file, CSV unless the path ends in .json
+    void SetOutput(const std::string& path);
+
+    // Call once the frame's fence has signalled. Collects and exports the results of the frame that last
+    // used this slot, then starts timing CPU scopes for the new frame
+    void BeginFrame(uint32_t frameIndex);
+
+    // Call once the frame has been submitted
+    void EndFrame();
+
+    // Collects every submitted frame that has not been reported yet. The device must be idle
+    void CollectPending();
+
+    // Call before re-recording the frame's command buffers. Commands that are replayed keep their scopes
+    void BeginRecording(uint32_t frameIndex);
+
+    // Must be recorded outside of a render pass, ahead of every other query in the frame
+    void ResetQueries(VkCommandBuffer commandBuffer);
+
+    // GPU scopes may be recorded from several threads at once, into primary or secondary command buffers
+    uint32_t BeginGpuScope(VkCommandBuffer commandBuffer, const std::string& name);
+    void EndGpuScope(VkCommandBuffer commandBuffer, uint32_t scope);
+
+    // One pipeline statistics query per frame. Secondary command buffers executed while it is active must
+    // inherit GetStatisticsFlags()
+    void BeginStatistics(VkCommandBuffer commandBuffer);
+    void EndStatistics(VkCommandBuffer commandBuffer);
+    VkQueryPipelineStatisticFlags GetStatisticsFlags() const { return statisticsFlags_; }
+
+    uint32_t BeginCpuScope(const std::string& name);
+    void EndCpuScope(uint32_t scope);
+
+    // The most recent frame whose results have been collected
+    const FrameProfile& GetLastFrame() const { return lastFrame_; }
+
+private:
+    struct FrameQueries
+    {
+        VkQueryPool timestampPool = VK_NULL_HANDLE;
+        VkQueryPool statisticsPool = VK_NULL_HANDLE;
+
+        // Scopes recorded into the frame's command buffers, in query order
+        std::vector<std::string> gpuScopes;
+        bool recordedStatistics = false;
+
+        // Set once the commands have been submitted, results are only read for submitted frames
+        bool submitted = false;
+        uint64_t frameNumber = 0;
+
+        // CPU timings are final at submission, they wait here to be reported with the GPU results
+        std::vector<ProfileScope> cpuScopes;
+    };
+
+    VkDevice device_;
+    bool timestampsSupported_ = false;
+    double timestampPeriodNs_ = 1.0;
+    uint64_t timestampMask_ = ~0ULL;
+    VkQueryPipelineStatisticFlags statisticsFlags_ = 0;
+    uint32_t maxScopes_;
+
+    std::vector<FrameQueries> frames_;
+    uint32_t currentFrame_ = 0;
+    uint32_t recordingFrame_ = 0;
+    uint64_t frameNumber_ = 0;
+    std::mutex scopeMutex_;
+
+    using Clock = std::chrono::steady_clock;
+    Clock::time_point cpuFrameStart_;
+    std::vector<ProfileScope> cpuScopes_;
+    std::vector<Clock::time_point> cpuScopeStarts_;
+
+    FrameProfile lastFrame_;
+
+    std::ofstream output_;
+    bool outputJson_ = false;
+
+    void CollectResults(FrameQueries& frame);
+    void Export(const FrameProfile& profile);
+};
+#endif // GPU_PROFILER_H
@@ -0,0 +1,38 @@
+#include "InstancePool.h"
+
+#include <stdexcept>
+
+InstancePool::InstancePool(MemoryAllocator& allocator, UploadManager& uploadManager, uint32_t instanceCapacity)
+    : allocator_(allocator), uploadManager_(uploadManager), ranges_(instanceCapacity)
+{
+    allocator_.CreateBuffer((VkDeviceSize)sizeof(InstanceData) * instanceCapacity,
+        VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+        buffer_, bufferMemory_);
+}
+
+InstancePool::~InstancePool()
+{
+    allocator_.DestroyBuffer(buffer_, bufferMemory_);
+}
+
+InstanceRange InstancePool::Allocate(const std::vector<InstanceData>& instances)
+{
+    VkDeviceSize firstInstance = ranges_.Allocate(instances.size(), 1);
+    if (firstInstance == RangeAllocator::INVALID_OFFSET)
+    {
+        throw std::runtime_error("Instance pool is out of space!");
+    }
+
+    InstanceRange range;
+    range.firstInstance = (uint32_t)firstInstance;
+    range.instanceCount = (uint32_t)instances.size();
+    range.uploadTicket = uploadManager_.Upload(instances.data(), sizeof(InstanceData) * instances.size(), buffer_,
+        firstInstance * sizeof(InstanceData));
+
+    return range;
+}
+
+void InstancePool::Free(const InstanceRange& range)
+{
+    ranges_.Free(range.firstInstance, range.instanceCount);
+}
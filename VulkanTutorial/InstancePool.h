@@ -0,0 +1,61 @@
+#pragma once
+#ifndef INSTANCE_POOL_H
+#define INSTANCE_POOL_H
+
+#include <glm/glm.hpp>
+#include <vulkan/vulkan.h>
+#include <vector>
+
+#include "MemoryAllocator.h"
+#include "RangeAllocator.h"
+#include "UploadManager.h"
+
+// Per-instance attributes, read through a vertex binding with VK_VERTEX_INPUT_RATE_INSTANCE
+struct InstanceData
+{
+    glm::mat4 model = glm::mat4(1.0f);
+
+    // Multiplied with the vertex colour, white leaves the mesh unchanged
+    glm::vec4 colour = glm::vec4(1.0f);
+};
+
+// Location of a group of instances inside the pool, used as vkCmdDrawIndexed's firstInstance and instanceCount
+struct InstanceRange
+{
+    uint32_t firstInstance = 0;
+    uint32_t instanceCount = 0;
+
+    // The range may be drawn from once the UploadManager reports this ticket as complete
+    uint64_t uploadTicket = 0;
+};
+
+// One shared device local buffer of InstanceData that instance groups are sub-allocated from, so
+// that it can be bound once alongside the GeometryPool and every group drawn with a single call
+class InstancePool
+{
+public:
+    InstancePool(MemoryAllocator& allocator, UploadManager& uploadManager, uint32_t instanceCapacity);
+    ~InstancePool();
+
+    InstancePool(const InstancePool&) = delete;
+    InstancePool& operator=(const InstancePool&) = delete;
+
+    // Reserves space for the instances and queues their upload. Throws when the pool is full
+    InstanceRange Allocate(const std::vector<InstanceData>& instances);
+
+    // The caller must make sure that no submitted work still reads from the range
+    void Free(const InstanceRange& range);
+
+    VkBuffer GetBuffer() const { return buffer_; }
+
+private:
+    MemoryAllocator& allocator_;
+    UploadManager& uploadManager_;
+
+    VkBuffer buffer_ = VK_NULL_HANDLE;
+    MemoryAllocation bufferMemory_;
+
+    // Counts instances, not bytes
+    RangeAllocator ranges_;
+};
+#endif // INSTANCE_POOL_H
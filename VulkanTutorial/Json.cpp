@@ -0,0 +1,328 @@
+#include "Json.h"
+
+#include <charconv>
+#include <stdexcept>
+
+// Guards the recursive parser against stack exhaustion on hostile input
+static const uint32_t MAX_NESTING_DEPTH = 256;
+
+// Recursive descent over the text, which must outlive the parser
+class JsonParser
+{
+public:
+    explicit JsonParser(std::string_view text) : text_(text) {}
+
+    JsonValue ParseDocument()
+    {
+        JsonValue value = ParseValue(0);
+        SkipWhitespace();
+        if (position_ != text_.size())
+        {
+            Fail("trailing characters");
+        }
+        return value;
+    }
+
+private:
+    std::string_view text_;
+    size_t position_ = 0;
+
+    [[noreturn]] void Fail(const char* reason)
+    {
+        throw std::runtime_error("Invalid JSON at offset " + std::to_string(position_) + ": " + reason);
+    }
+
+    void SkipWhitespace()
+    {
+        while (position_ < text_.size() && (text_[position_] == ' ' || text_[position_] == '\t'
+            || text_[position_] == '\n' || text_[position_] == '\r'))
+        {
+            ++position_;
+        }
+    }
+
+    char Peek()
+    {
+        SkipWhitespace();
+        if (position_ >= text_.size())
+        {
+            Fail("unexpected end of input");
+        }
+        return text_[position_];
+    }
+
+    void Expect(char c)
+    {
+        if (Peek() != c)
+        {
+            Fail("unexpected character");
+        }
+        ++position_;
+    }
+
+    bool ConsumeLiteral(std::string_view literal)
+    {
+        if (text_.substr(position_, literal.size()) == literal)
+        {
+            position_ += literal.size();
+            return true;
+        }
+        return false;
+    }
+
+    JsonValue ParseValue(uint32_t depth)
+    {
+        if (depth > MAX_NESTING_DEPTH)
+        {
+            Fail("nested too deeply");
+        }
+
+        JsonValue value;
+        char c = Peek();
+        if (c == '{')
+        {
+            value.type_ = JsonValue::Type::Object;
+            ++position_;
+            if (Peek() == '}')
+            {
+                ++position_;
+                return value;
+            }
+            while (true)
+            {
+                if (Peek() != '"')
+                {
+                    Fail("expected a member name");
+                }
+                std::string key = ParseString();
+                Expect(':');
+                value.members_.emplace_back(std::move(key), ParseValue(depth + 1));
+
+                char separator = Peek();
+                ++position_;
+                if (separator == '}')
+                {
+                    return value;
+                }
+                if (separator != ',')
+                {
+                    Fail("expected ',' or '}'");
+                }
+            }
+        }
+        else if (c == '[')
+        {
+            value.type_ = JsonValue::Type::Array;
+            ++position_;
+            if (Peek() == ']')
+            {
+                ++position_;
+                return value;
+            }
+            while (true)
+            {
+                value.elements_.push_back(ParseValue(depth + 1));
+
+                char separator = Peek();
+                ++position_;
+                if (separator == ']')
+                {
+                    return value;
+                }
+                if (separator != ',')
+                {
+                    Fail("expected ',' or ']'");
+                }
+            }
+        }
+        else if (c == '"')
+        {
+            value.type_ = JsonValue::Type::String;
+            value.string_ = ParseString();
+        }
+        else if (ConsumeLiteral("true"))
+        {
+            value.type_ = JsonValue::Type::Bool;
+            value.bool_ = true;
+        }
+        else if (ConsumeLiteral("false"))
+        {
+            value.type_ = JsonValue::Type::Bool;
+        }
+        else if (ConsumeLiteral("null"))
+        {
+            value.type_ = JsonValue::Type::Null;
+        }
+        else
+        {
+            value.type_ = JsonValue::Type::Number;
+            const char* begin = text_.data() + position_;
+            const char* end = text_.data() + text_.size();
+            std::from_chars_result result = std::from_chars(begin, end, value.number_);
+            if (result.ec != std::errc() || result.ptr == begin)
+            {
+                Fail("invalid value");
+            }
+            position_ += result.ptr - begin;
+        }
+
+        return value;
+    }
+
+    uint32_t ParseHex4()
+    {
+        if (position_ + 4 > text_.size())
+        {
+            Fail("truncated escape");
+        }
+        uint32_t codePoint = 0;
+        std::from_chars_result result = std::from_chars(text_.data() + position_, text_.data() + position_ + 4,
+            codePoint, 16);
+        if (result.ptr != text_.data() + position_ + 4)
+        {
+            Fail("invalid escape");
+        }
+        position_ += 4;
+        return codePoint;
+    }
+
+    static void AppendUtf8(std::string& out, uint32_t codePoint)
+    {
+        if (codePoint < 0x80)
+        {
+            out += (char)codePoint;
+        }
+        else if (codePoint < 0x800)
+        {
+            out += (char)(0xC0 | (codePoint >> 6));
+            out += (char)(0x80 | (codePoint & 0x3F));
+        }
+        else if (codePoint < 0x10000)
+        {
+            out += (char)(0xE0 | (codePoint >> 12));
+            out += (char)(0x80 | ((codePoint >> 6) & 0x3F));
+            out += (char)(0x80 | (codePoint & 0x3F));
+        }
+        else
+        {
+            out += (char)(0xF0 | (codePoint >> 18));
+            out += (char)(0x80 | ((codePoint >> 12) & 0x3F));
+            out += (char)(0x80 | ((codePoint >> 6) & 0x3F));
+            out += (char)(0x80 | (codePoint & 0x3F));
+        }
+    }
+
+    // Expects position_ on the opening quote
+    std::string ParseString()
+    {
+        ++position_;
+        std::string out;
+
+        while (true)
+        {
+            if (position_ >= text_.size())
+            {
+                Fail("unterminated string");
+            }
+
+            char c = text_[position_++];
+            if (c == '"')
+            {
+                return out;
+            }
+            if (c != '\\')
+            {
+                out += c;
+                continue;
+            }
+
+            if (position_ >= text_.size())
+            {
+                Fail("unterminated string");
+            }
+            char escape = text_[position_++];
+            switch (escape)
+            {
+            case '"': out += '"'; break;
+            case '\\': out += '\\'; break;
+            case '/': out += '/'; break;
+            case 'b': out += '\b'; break;
+            case 'f': out += '\f'; break;
+            case 'n': out += '\n'; break;
+            case 'r': out += '\r'; break;
+            case 't': out += '\t'; break;
+            case 'u':
+            {
+                uint32_t codePoint = ParseHex4();
+
+                // Characters outside the basic plane are escaped as a surrogate pair
+                if (codePoint >= 0xD800 && codePoint < 0xDC00 && ConsumeLiteral("\\u"))
+                {
+                    uint32_t low = ParseHex4();
+                    codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (low - 0xDC00);
+                }
+                AppendUtf8(out, codePoint);
+                break;
+            }
+            default:
+                Fail("invalid escape");
+            }
+        }
+    }
+};
+
+JsonValue JsonValue::Parse(std::string_view text)
+{
+    return JsonParser(text).ParseDocument();
+}
+
+bool JsonValue::AsBool(bool fallback) const
+{
+    return type_ == Type::Bool ? bool_ : fallback;
+}
+
+double JsonValue::AsNumber(double fallback) const
+{
+    return type_ == Type::Number ? number_ : fallback;
+}
+
+const std::string& JsonValue::AsString() const
+{
+    return string_;
+}
+
+const JsonValue* JsonValue::Find(std::string_view key) const
+{
+    for (const std::pair<std::string, JsonValue>& member : members_)
+    {
+        if (member.first == key)
+        {
+            return &member.second;
+        }
+    }
+    return nullptr;
+}
+
+double JsonValue::GetNumber(std::string_view key, double fallback) const
+{
+    const JsonValue* value = Find(key);
+    return value ? value->AsNumber(fallback) : fallback;
+}
+
+uint32_t JsonValue::GetUint(std::string_view key, uint32_t fallback) const
+{
+    double number = GetNumber(key, (double)fallback);
+    return number >= 0.0 && number <= 4294967295.0 ? (uint32_t)number : fallback;
+}
+
+bool JsonValue::GetBool(std::string_view key, bool fallback) const
+{
+    const JsonValue* value = Find(key);
+    return value ? value->AsBool(fallback) : fallback;
+}
+
+std::string JsonValue::GetString(std::string_view key, const std::string& fallback) const
+{
+    const JsonValue* value = Find(key);
+    return value && value->type_ == Type::String ? value->string_ : fallback;
+}
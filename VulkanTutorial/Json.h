@@ -0,0 +1,59 @@
+#pragma once
+#ifndef JSON_H
+#define JSON_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Minimal JSON document model, enough to read glTF files. Numbers are kept as doubles
+class JsonValue
+{
+public:
+    enum class Type
+    {
+        Null,
+        Bool,
+        Number,
+        String,
+        Array,
+        Object,
+    };
+
+    // Throws when the text is not valid JSON
+    static JsonValue Parse(std::string_view text);
+
+    Type GetType() const { return type_; }
+    bool IsNull() const { return type_ == Type::Null; }
+
+    // Return the fallback when the value is of a different type
+    bool AsBool(bool fallback = false) const;
+    double AsNumber(double fallback = 0.0) const;
+    const std::string& AsString() const;
+
+    // Array elements, empty unless the value is an array
+    const std::vector<JsonValue>& GetElements() const { return elements_; }
+
+    // Object member lookup, nullptr when the value is not an object or has no such member
+    const JsonValue* Find(std::string_view key) const;
+
+    // Convenience lookups for object members, returning fallback when the member is missing
+    double GetNumber(std::string_view key, double fallback = 0.0) const;
+    uint32_t GetUint(std::string_view key, uint32_t fallback = 0) const;
+    bool GetBool(std::string_view key, bool fallback = false) const;
+    std::string GetString(std::string_view key, const std::string& fallback = {}) const;
+
+private:
+    Type type_ = Type::Null;
+    bool bool_ = false;
+    double number_ = 0.0;
+    std::string string_;
+    std::vector<JsonValue> elements_;
+    std::vector<std::pair<std::string, JsonValue>> members_;
+
+    friend class JsonParser;
+};
+#endif // JSON_H
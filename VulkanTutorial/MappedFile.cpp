@@ -0,0 +1,156 @@
+#include "MappedFile.h"
+
+#include <stdexcept>
+#include <utility>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile(const std::string& path)
+{
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+        FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        throw std::runtime_error("Failed to open file: " + path);
+    }
+    fileHandle_ = file;
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize))
+    {
+        Close();
+        throw std::runtime_error("Failed to get the size of file: " + path);
+    }
+    size_ = (size_t)fileSize.QuadPart;
+
+    // Empty files cannot be mapped, they are represented by a null view
+    if (size_ > 0)
+    {
+        mappingHandle_ = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        void* view = mappingHandle_ ? MapViewOfFile(mappingHandle_, FILE_MAP_READ, 0, 0, 0) : nullptr;
+        if (!view)
+        {
+            Close();
+            throw std::runtime_error("Failed to map file: " + path);
+        }
+        data_ = static_cast<const uint8_t*>(view);
+    }
+#else
+    fileDescriptor_ = open(path.c_str(), O_RDONLY);
+    if (fileDescriptor_ < 0)
+    {
+        throw std::runtime_error("Failed to open file: " + path);
+    }
+
+    struct stat fileStatus;
+    if (fstat(fileDescriptor_, &fileStatus) != 0)
+    {
+        Close();
+        throw std::runtime_error("Failed to get the size of file: " + path);
+    }
+    size_ = (size_t)fileStatus.st_size;
+
+    // Empty files cannot be mapped, they are represented by a null view
+    if (size_ > 0)
+    {
+        void* view = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fileDescriptor_, 0);
+        if (view == MAP_FAILED)
+        {
+            Close();
+            throw std::runtime_error("Failed to map file: " + path);
+        }
+        data_ = static_cast<const uint8_t*>(view);
+    }
+#endif
+}
+
+MappedFile::~MappedFile()
+{
+    Close();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+{
+    *this = std::move(other);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+{
+    if (this != &other)
+    {
+        Close();
+
+        data_ = std::exchange(other.data_, nullptr);
+        size_ = std::exchange(other.size_, 0);
+#ifdef _WIN32
+        fileHandle_ = std::exchange(other.fileHandle_, nullptr);
+        mappingHandle_ = std::exchange(other.mappingHandle_, nullptr);
+#else
+        fileDescriptor_ = std::exchange(other.fileDescriptor_, -1);
+#endif
+    }
+
+    return *this;
+}
+
+void MappedFile::AdviseSequential() const
+{
+    if (!data_)
+    {
+        return;
+    }
+
+    // Only a hint, failures are harmless
+#ifdef _WIN32
+    WIN32_MEMORY_RANGE_ENTRY range;
+    range.VirtualAddress = const_cast<uint8_t*>(data_);
+    range.NumberOfBytes = size_;
+    PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+#else
+    madvise(const_cast<uint8_t*>(data_), size_, MADV_SEQUENTIAL);
+    madvise(const_cast<uint8_t*>(data_), size_, MADV_WILLNEED);
+#endif
+}
+
+void MappedFile::Close()
+{
+#ifdef _WIN32
+    if (data_)
+    {
+        UnmapViewOfFile(data_);
+    }
+    if (mappingHandle_)
+    {
+        CloseHandle(mappingHandle_);
+    }
+    if (fileHandle_)
+    {
+        CloseHandle(fileHandle_);
+    }
+    fileHandle_ = nullptr;
+    mappingHandle_ = nullptr;
+#else
+    if (data_)
+    {
+        munmap(const_cast<uint8_t*>(data_), size_);
+    }
+    if (fileDescriptor_ >= 0)
+    {
+        close(fileDescriptor_);
+    }
+    fileDescriptor_ = -1;
+#endif
+
+    data_ = nullptr;
+    size_ = 0;
+}
@@ -0,0 +1,44 @@
+#pragma once
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// A whole file mapped read-only into the address space. Pages are faulted in by the OS as they are read,
+// so nothing is copied onto the heap and untouched parts of the file are never read from disk
+class MappedFile
+{
+public:
+    MappedFile() = default;
+
+    // Throws when the file cannot be opened or mapped
+    explicit MappedFile(const std::string& path);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+
+    const uint8_t* GetData() const { return data_; }
+    size_t GetSize() const { return size_; }
+
+    // Tells the OS the whole file is about to be read front to back, so it can read ahead in large requests
+    void AdviseSequential() const;
+
+private:
+    const uint8_t* data_ = nullptr;
+    size_t size_ = 0;
+
+#ifdef _WIN32
+    void* fileHandle_ = nullptr;
+    void* mappingHandle_ = nullptr;
+#else
+    int fileDescriptor_ = -1;
+#endif
+
+    void Close();
+};
+#endif // MAPPED_FILE_H
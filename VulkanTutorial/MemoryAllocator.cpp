@@ -0,0 +1,304 @@
+#include "MemoryAllocator.h"
+#include "Utilities.h"
+
+#include <algorithm>
+#include <stdio.h>
+
+MemoryAllocator::MemoryAllocator(VkPhysicalDevice physicalDevice, VkDevice device, VkDeviceSize blockSize)
+    : physicalDevice_(physicalDevice), device_(device), blockSize_(blockSize)
+{
+    vkGetPhysicalDeviceProperties(physicalDevice_, &deviceProperties_);
+    vkGetPhysicalDeviceMemoryProperties(physicalDevice_, &memoryProperties_);
+
+    blocks_.resize(memoryProperties_.memoryTypeCount);
+}
+
+MemoryAllocator::~MemoryAllocator()
+{
+    for (auto& typeBlocks : blocks_)
+    {
+        for (auto& block : typeBlocks)
+        {
+            if (block)
+            {
+                if (block->allocationCount > 0)
+                {
+                    printf("MEMORY WARNING: %u allocations were not freed\n", block->allocationCount);
+                }
+
+                DestroyBlock(*block);
+            }
+        }
+    }
+}
+
+MemoryAllocator::MemoryBlock* MemoryAllocator::CreateBlock(uint32_t memoryTypeIndex, VkDeviceSize requiredSize,
+    bool linear, bool dedicated, uint32_t& blockIndex)
+{
+    VkDeviceSize blockSize = dedicated ? requiredSize : blockSize_;
+
+    VkMemoryAllocateInfo memoryAllocInfo = {};
+    memoryAllocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    memoryAllocInfo.memoryTypeIndex = memoryTypeIndex;
+
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    VkResult result = VK_ERROR_OUT_OF_DEVICE_MEMORY;
+
+    // If the heap cannot fit a full block, fall back to smaller blocks that still fit the request
+    while (blockSize >= requiredSize)
+    {
+        memoryAllocInfo.allocationSize = blockSize;
+        result = vkAllocateMemory(device_, &memoryAllocInfo, nullptr, &memory);
+        if (result == VK_SUCCESS || blockSize == requiredSize)
+        {
+            break;
+        }
+
+        blockSize = std::max(blockSize / 2, requiredSize);
+    }
+
+    if (result != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to allocate a Device Memory block!");
+    }
+
+    auto block = std::make_unique<MemoryBlock>();
+    block->memory = memory;
+    block->linear = linear;
+    block->dedicated = dedicated;
+    block->ranges = RangeAllocator(blockSize);
+
+    // Host visible blocks are mapped once and stay mapped, allocations just offset into the mapping
+    if (memoryProperties_.memoryTypes[memoryTypeIndex].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+    {
+        result = vkMapMemory(device_, memory, 0, VK_WHOLE_SIZE, 0, &block->mappedData);
+        if (result != VK_SUCCESS)
+        {
+            vkFreeMemory(device_, memory, nullptr);
+            throw std::runtime_error("Failed to map a Device Memory block!");
+        }
+    }
+
+    // Reuse the slot of a released block so that block indices stay small
+    auto& typeBlocks = blocks_[memoryTypeIndex];
+    for (blockIndex = 0; blockIndex < typeBlocks.size(); ++blockIndex)
+    {
+        if (!typeBlocks[blockIndex])
+        {
+            break;
+        }
+    }
+
+    if (blockIndex == typeBlocks.size())
+    {
+        typeBlocks.push_back(nullptr);
+    }
+
+    typeBlocks[blockIndex] = std::move(block);
+    return typeBlocks[blockIndex].get();
+}
+
+void MemoryAllocator::DestroyBlock(MemoryBlock& block)
+{
+    if (block.mappedData)
+    {
+        vkUnmapMemory(device_, block.memory);
+    }
+
+    vkFreeMemory(device_, block.memory, nullptr);
+}
+
+MemoryAllocation MemoryAllocator::Allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties,
+    bool linear)
+{
+    MemoryAllocation allocation;
+    allocation.memoryTypeIndex = FindMemoryTypeIndex(physicalDevice_, requirements.memoryTypeBits, properties);
+    allocation.size = requirements.size;
+
+    auto& typeBlocks = blocks_[allocation.memoryTypeIndex];
+
+    auto assignRange = [&allocation](MemoryBlock& block, uint32_t blockIndex, VkDeviceSize offset)
+    {
+        block.allocationCount++;
+
+        allocation.memory = block.memory;
+        allocation.offset = offset;
+        allocation.blockIndex = blockIndex;
+        allocation.mappedData = block.mappedData ? static_cast<char*>(block.mappedData) + offset : nullptr;
+    };
+
+    // Large resources get a block of their own rather than fragmenting the shared blocks
+    bool dedicated = requirements.size > blockSize_ / 2;
+
+    if (!dedicated)
+    {
+        for (uint32_t i = 0; i < typeBlocks.size(); ++i)
+        {
+            MemoryBlock* block = typeBlocks[i].get();
+            if (!block || block->dedicated || block->linear != linear)
+            {
+                continue;
+            }
+
+            VkDeviceSize offset = block->ranges.Allocate(requirements.size, requirements.alignment);
+            if (offset != RangeAllocator::INVALID_OFFSET)
+            {
+                assignRange(*block, i, offset);
+                return allocation;
+            }
+        }
+    }
+
+    uint32_t blockIndex;
+    MemoryBlock* block = CreateBlock(allocation.memoryTypeIndex, requirements.size, linear, dedicated, blockIndex);
+
+    VkDeviceSize offset = block->ranges.Allocate(requirements.size, requirements.alignment);
+    if (offset == RangeAllocator::INVALID_OFFSET)
+    {
+        throw std::runtime_error("Failed to sub-allocate from a new Device Memory block!");
+    }
+
+    assignRange(*block, blockIndex, offset);
+    return allocation;
+}
+
+void MemoryAllocator::Free(MemoryAllocation& allocation)
+{
+    if (allocation.memory == VK_NULL_HANDLE)
+    {
+        return;
+    }
+
+    auto& typeBlocks = blocks_[allocation.memoryTypeIndex];
+    MemoryBlock& block = *typeBlocks[allocation.blockIndex];
+
+    block.ranges.Free(allocation.offset, allocation.size);
+    block.allocationCount--;
+
+    if (block.allocationCount == 0)
+    {
+        // Keep a single empty shared block around so that alternating allocate/free does not thrash the driver
+        bool hasSpareBlock = false;
+        for (uint32_t i = 0; i < typeBlocks.size() && !block.dedicated; ++i)
+        {
+            MemoryBlock* other = typeBlocks[i].get();
+            if (i != allocation.blockIndex && other && !other->dedicated && other->linear == block.linear
+                && other->allocationCount == 0)
+            {
+                hasSpareBlock = true;
+                break;
+            }
+        }
+
+        if (block.dedicated || hasSpareBlock)
+        {
+            DestroyBlock(block);
+            typeBlocks[allocation.blockIndex].reset();
+        }
+    }
+
+    allocation = MemoryAllocation{};
+}
+
+void MemoryAllocator::CreateBuffer(VkDeviceSize bufferSize, VkBufferUsageFlags bufferUsage,
+    VkMemoryPropertyFlags bufferProperties, VkBuffer& buffer, MemoryAllocation& allocation)
+{
+    VkBufferCreateInfo bufferInfo {};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = bufferSize;
+    bufferInfo.usage = bufferUsage;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    VkResult result = vkCreateBuffer(device_, &bufferInfo, nullptr, &buffer);
+    if (result != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create a Buffer!");
+    }
+
+    VkMemoryRequirements memRequirements;
+    vkGetBufferMemoryRequirements(device_, buffer, &memRequirements);
+
+    allocation = Allocate(memRequirements, bufferProperties, true);
+
+    // Bind the buffer to its range of the shared block
+    vkBindBufferMemory(device_, buffer, allocation.memory, allocation.offset);
+}
+
+void MemoryAllocator::DestroyBuffer(VkBuffer& buffer, MemoryAllocation& allocation)
+{
+    vkDestroyBuffer(device_, buffer, nullptr);
+    Free(allocation);
+    buffer = VK_NULL_HANDLE;
+}
+
+void MemoryAllocator::CreateImage(const VkImageCreateInfo& imageCreateInfo, VkMemoryPropertyFlags imageProperties,
+    VkImage& image, MemoryAllocation& allocation, VkMemoryPropertyFlags preferredProperties)
+{
+    VkResult result = vkCreateImage(device_, &imageCreateInfo, nullptr, &image);
+    if (result != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create an Image!");
+    }
+
+    VkMemoryRequirements memRequirements;
+    vkGetImageMemoryRequirements(device_, image, &memRequirements);
+
+    VkMemoryPropertyFlags properties = imageProperties;
+    VkMemoryPropertyFlags preferred = imageProperties | preferredProperties;
+    for (uint32_t i = 0; i < memoryProperties_.memoryTypeCount; ++i)
+    {
+        if ((memRequirements.memoryTypeBits & (1u << i))
+            && (memoryProperties_.memoryTypes[i].propertyFlags & preferred) == preferred)
+        {
+            properties = preferred;
+            break;
+        }
+    }
+
+    allocation = Allocate(memRequirements, properties, imageCreateInfo.tiling == VK_IMAGE_TILING_LINEAR);
+
+    vkBindImageMemory(device_, image, allocation.memory, allocation.offset);
+}
+
+void MemoryAllocator::DestroyImage(VkImage& image, MemoryAllocation& allocation)
+{
+    vkDestroyImage(device_, image, nullptr);
+    Free(allocation);
+    image = VK_NULL_HANDLE;
+}
+
+std::vector<MemoryHeapStats> MemoryAllocator::GetHeapStats() const
+{
+    std::vector<MemoryHeapStats> heapStats(memoryProperties_.memoryHeapCount);
+
+    for (uint32_t typeIndex = 0; typeIndex < blocks_.size(); ++typeIndex)
+    {
+        MemoryHeapStats& stats = heapStats[memoryProperties_.memoryTypes[typeIndex].heapIndex];
+
+        for (const auto& block : blocks_[typeIndex])
+        {
+            if (block)
+            {
+                stats.blockCount++;
+                stats.allocationCount += block->allocationCount;
+                stats.blockBytes += block->ranges.GetSize();
+                stats.usedBytes += block->ranges.GetUsed();
+            }
+        }
+    }
+
+    return heapStats;
+}
+
+void MemoryAllocator::PrintStats() const
+{
+    std::vector<MemoryHeapStats> heapStats = GetHeapStats();
+
+    const double mebibyte = 1024.0 * 1024.0;
+    for (size_t i = 0; i < heapStats.size(); ++i)
+    {
+        const MemoryHeapStats& stats = heapStats[i];
+        printf("Memory heap %zu: %u blocks, %u allocations, %.2f / %.2f MiB used\n", i, stats.blockCount,
+            stats.allocationCount, stats.usedBytes / mebibyte, stats.blockBytes / mebibyte);
+    }
+}
@@ -0,0 +1,97 @@
+#pragma once
+#ifndef MEMORY_ALLOCATOR_H
+#define MEMORY_ALLOCATOR_H
+
+#include <vulkan/vulkan.h>
+#include <memory>
+#include <vector>
+
+#include "RangeAllocator.h"
+
+// A sub-range of a VkDeviceMemory block handed out by the MemoryAllocator
+struct MemoryAllocation
+{
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    VkDeviceSize offset = 0;
+    VkDeviceSize size = 0;
+
+    // Host visible blocks stay mapped for their whole lifetime, this points at the start of the allocation
+    void* mappedData = nullptr;
+
+    uint32_t memoryTypeIndex = 0;
+    uint32_t blockIndex = 0;
+};
+
+struct MemoryHeapStats
+{
+    uint32_t blockCount = 0;
+    uint32_t allocationCount = 0;
+
+    // Memory reserved from the driver vs memory handed out to allocations
+    VkDeviceSize blockBytes = 0;
+    VkDeviceSize usedBytes = 0;
+};
+
+// Reserves large VkDeviceMemory blocks per memory type and sub-allocates buffers and images from
+// them, so that the number of driver allocations stays far below maxMemoryAllocationCount.
+class MemoryAllocator
+{
+public:
+    static constexpr VkDeviceSize DEFAULT_BLOCK_SIZE = 64ULL * 1024 * 1024;
+
+    MemoryAllocator(VkPhysicalDevice physicalDevice, VkDevice device, VkDeviceSize blockSize = DEFAULT_BLOCK_SIZE);
+    ~MemoryAllocator();
+
+    MemoryAllocator(const MemoryAllocator&) = delete;
+    MemoryAllocator& operator=(const MemoryAllocator&) = delete;
+
+    // Linear resources (buffers) and optimal resources (images) are kept in separate blocks so
+    // that bufferImageGranularity never has to be honoured between neighbouring allocations
+    MemoryAllocation Allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties,
+        bool linear);
+    void Free(MemoryAllocation& allocation);
+
+    void CreateBuffer(VkDeviceSize bufferSize, VkBufferUsageFlags bufferUsage, VkMemoryPropertyFlags bufferProperties,
+        VkBuffer& buffer, MemoryAllocation& allocation);
+    void DestroyBuffer(VkBuffer& buffer, MemoryAllocation& allocation);
+
+    // preferredProperties are added to imageProperties when a memory type the image supports has both,
+    // e.g. lazily allocated memory for transient attachments
+    void CreateImage(const VkImageCreateInfo& imageCreateInfo, VkMemoryPropertyFlags imageProperties, VkImage& image,
+        MemoryAllocation& allocation, VkMemoryPropertyFlags preferredProperties = 0);
+    void DestroyImage(VkImage& image, MemoryAllocation& allocation);
+
+    // One entry per memory heap of the physical device
+    std::vector<MemoryHeapStats> GetHeapStats() const;
+    void PrintStats() const;
+
+    VkPhysicalDevice GetPhysicalDevice() const { return physicalDevice_; }
+    VkDevice GetDevice() const { return device_; }
+    const VkPhysicalDeviceProperties& GetPhysicalDeviceProperties() const { return deviceProperties_; }
+
+private:
+    struct MemoryBlock
+    {
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        void* mappedData = nullptr;
+        bool linear = true;
+        bool dedicated = false;
+        uint32_t allocationCount = 0;
+        RangeAllocator ranges;
+    };
+
+    VkPhysicalDevice physicalDevice_;
+    VkDevice device_;
+    VkDeviceSize blockSize_;
+
+    VkPhysicalDeviceProperties deviceProperties_;
+    VkPhysicalDeviceMemoryProperties memoryProperties_;
+
+    // Blocks for each memory type. Released blocks leave an empty slot so block indices stay stable.
+    std::vector<std::vector<std::unique_ptr<MemoryBlock>>> blocks_;
+
+    MemoryBlock* CreateBlock(uint32_t memoryTypeIndex, VkDeviceSize requiredSize, bool linear, bool dedicated,
+        uint32_t& blockIndex);
+    void DestroyBlock(MemoryBlock& block);
+};
+#endif // MEMORY_ALLOCATOR_H
@@ -1,20 +1,89 @@
 #include "Mesh.h"
 
-Mesh::Mesh(VkPhysicalDevice physicalDevice, VkDevice device, VkQueue transferQueue,
-        VkCommandPool transferCommandPool, const std::vector<Vertex>& vertices, 
-        const std::vector<uint32_t>& indices)
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+static MeshBounds ComputeBounds(const std::vector<Vertex>& vertices)
 {
-    vertexCount_ = (int)vertices.size();
-    indexCount_ = (int)indices.size();
-    physicalDevice_ = physicalDevice;
-    device_ = device;
-
-    CreateGpuBuffer(transferQueue, transferCommandPool, vertices, 
-        VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, vertexBuffer_,
-        vertexBufferMemory_);
-    CreateGpuBuffer(transferQueue, transferCommandPool, indices,
-        VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, indexBuffer_,
-        indexBufferMemory_);
+    MeshBounds bounds;
+    if (vertices.empty())
+    {
+        return bounds;
+    }
+
+    bounds.min = glm::vec3(std::numeric_limits<float>::max());
+    bounds.max = glm::vec3(std::numeric_limits<float>::lowest());
+    for (const Vertex& vertex : vertices)
+    {
+        bounds.min = glm::min(bounds.min, vertex.pos);
+        bounds.max = glm::max(bounds.max, vertex.pos);
+    }
+
+    bounds.sphereCentre = (bounds.min + bounds.max) * 0.5f;
+    float radiusSquared = 0.0f;
+    for (const Vertex& vertex : vertices)
+    {
+        glm::vec3 offset = vertex.pos - bounds.sphereCentre;
+        radiusSquared = std::max(radiusSquared, glm::dot(offset, offset));
+    }
+    bounds.sphereRadius = std::sqrt(radiusSquared);
+
+    return bounds;
+}
+
+// A single level covering every index when no chain is given
+static std::vector<MeshLod> GetLodsOrDefault(const std::vector<MeshLod>& lods, uint32_t indexCount)
+{
+    if (lods.empty())
+    {
+        return { MeshLod{ 0, indexCount, 0.0f } };
+    }
+
+    for (const MeshLod& lod : lods)
+    {
+        if (lod.firstIndex > indexCount || lod.indexCount > indexCount - lod.firstIndex)
+        {
+            throw std::runtime_error("Mesh LOD lies outside of the mesh's indices!");
+        }
+    }
+    return lods;
+}
+
+Mesh::Mesh(GeometryPool& geometryPool, const VertexLayout& vertexLayout, const std::vector<Vertex>& vertices,
+    const std::vector<uint32_t>& indices, const std::vector<MeshLod>& lods)
+{
+    lods_ = GetLodsOrDefault(lods, (uint32_t)indices.size());
+
+    std::vector<uint8_t> encodedVertices;
+    dequantization_ = vertexLayout.Encode(vertices, encodedVertices);
+    bounds_ = ComputeBounds(vertices);
+
+    geometryPool_ = &geometryPool;
+    range_ = geometryPool_->Allocate(encodedVertices.data(), (uint32_t)vertices.size(), indices.data(),
+        (uint32_t)indices.size());
+}
+
+Mesh::Mesh(GeometryPool& geometryPool, const VertexLayout& vertexLayout, const MeshFile& meshFile)
+{
+    if (!meshFile.MatchesLayout(vertexLayout))
+    {
+        throw std::runtime_error("Mesh file was written for a different vertex layout!");
+    }
+
+    dequantization_ = meshFile.GetDequantization();
+
+    // Only the box is stored in the file, the sphere around it is slightly looser than one fitted to the vertices
+    bounds_.min = meshFile.GetBoundsMin();
+    bounds_.max = meshFile.GetBoundsMax();
+    bounds_.sphereCentre = (bounds_.min + bounds_.max) * 0.5f;
+    bounds_.sphereRadius = glm::length(bounds_.max - bounds_.min) * 0.5f;
+    lods_ = GetLodsOrDefault(meshFile.GetLods(), meshFile.GetIndexCount());
+
+    geometryPool_ = &geometryPool;
+    range_ = geometryPool_->Allocate(meshFile.GetVertexData(), meshFile.GetVertexCount(), meshFile.GetIndexData(),
+        meshFile.GetIndexType(), meshFile.GetIndexCount());
 }
 
 Mesh::~Mesh()
@@ -24,52 +93,76 @@ Mesh::~Mesh()
 
 Mesh::Mesh(Mesh&& other) noexcept
 {
-    vertexCount_ = other.vertexCount_;
-    vertexBuffer_ = other.vertexBuffer_;
-    vertexBufferMemory_ = other.vertexBufferMemory_;
-    physicalDevice_ = other.physicalDevice_;
-    device_ = other.device_;
-    indexCount_ = other.indexCount_;
-    indexBufferMemory_ = other.indexBufferMemory_;
-    indexBuffer_ = other.indexBuffer_;
-
-    other.vertexCount_ = 0;
-    other.vertexBuffer_ = VK_NULL_HANDLE;
-    other.indexCount_ = 0;
-    other.indexBuffer_ = VK_NULL_HANDLE;
-    other.indexBufferMemory_ = VK_NULL_HANDLE;
-    other.vertexBufferMemory_ = VK_NULL_HANDLE;
-    other.physicalDevice_ = VK_NULL_HANDLE;
-    other.device_ = VK_NULL_HANDLE;
+    geometryPool_ = other.geometryPool_;
+    range_ = other.range_;
+    dequantization_ = other.dequantization_;
+    bounds_ = other.bounds_;
+    lods_ = std::move(other.lods_);
+
+    other.geometryPool_ = nullptr;
+    other.range_ = GeometryRange{};
+}
+
+Mesh& Mesh::operator=(Mesh&& other) noexcept
+{
+    if (this != &other)
+    {
+        DestroyBuffers();
+
+        geometryPool_ = other.geometryPool_;
+        range_ = other.range_;
+        dequantization_ = other.dequantization_;
+        bounds_ = other.bounds_;
+        lods_ = std::move(other.lods_);
+
+        other.geometryPool_ = nullptr;
+        other.range_ = GeometryRange{};
+    }
+
+    return *this;
 }
 
 int Mesh::GetVertexCount()
 {
-    return vertexCount_;
+    return (int)range_.vertexCount;
+}
+
+int Mesh::GetIndexCount(uint32_t lod)
+{
+    return (int)lods_[lod].indexCount;
+}
+
+uint32_t Mesh::GetFirstIndex(uint32_t lod)
+{
+    return range_.firstIndex + lods_[lod].firstIndex;
+}
+
+int32_t Mesh::GetVertexOffset()
+{
+    return range_.vertexOffset;
 }
 
-VkBuffer Mesh::GetVertexBuffer()
+VkIndexType Mesh::GetIndexType()
 {
-    return vertexBuffer_;
+    return range_.indexType;
 }
 
-int Mesh::GetIndexCount()
+uint64_t Mesh::GetUploadTicket()
 {
-    return indexCount_;
+    return range_.uploadTicket;
 }
 
-VkBuffer Mesh::GetIndexBuffer()
+VertexDequantization Mesh::GetDequantization()
 {
-    return indexBuffer_;
+    return dequantization_;
 }
 
 void Mesh::DestroyBuffers()
 {
-    if (device_)
+    // Returns the mesh's range to the pool
+    if (geometryPool_)
     {
-        vkDestroyBuffer(device_, vertexBuffer_, nullptr);
-        vkFreeMemory(device_, vertexBufferMemory_, nullptr);
-        vkDestroyBuffer(device_, indexBuffer_, nullptr);
-        vkFreeMemory(device_, indexBufferMemory_, nullptr);
+        geometryPool_->Free(range_);
+        geometryPool_ = nullptr;
     }
 }
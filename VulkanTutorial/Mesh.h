@@ -5,73 +5,67 @@
 #include <glm/glm.hpp>
 #include <vulkan/vulkan.h>
 #include <vector>
+#include "GeometryPool.h"
+#include "MeshFile.h"
+#include "MeshSimplifier.h"
 #include "Utilities.h"
+#include "VertexLayout.h"
 
-struct Vertex
+// Model space bounds of a mesh's positions. The sphere is centred on the box, which is cheap and close to the
+// smallest enclosing sphere for most meshes
+struct MeshBounds
 {
-    glm::vec3 pos;
-    glm::vec3 col;
+    glm::vec3 min = glm::vec3(0.0f);
+    glm::vec3 max = glm::vec3(0.0f);
+    glm::vec3 sphereCentre = glm::vec3(0.0f);
+    float sphereRadius = 0.0f;
 };
 
+// A mesh is a range inside a shared GeometryPool, it does not own any buffers itself
 class Mesh
 {
 public:
     Mesh() = default;
-    Mesh(VkPhysicalDevice newPhysicalDevice, VkDevice newDevice, VkQueue transferQueue,
-        VkCommandPool transferCommandPool, const std::vector<Vertex>& vertices, 
-        const std::vector<uint32_t>& indices);
+    // The vertices are converted into the pool's layout, which must match vertexLayout. indices holds every
+    // level of detail back to back as described by lods, a single level covering all of them when it is empty
+    Mesh(GeometryPool& geometryPool, const VertexLayout& vertexLayout, const std::vector<Vertex>& vertices,
+        const std::vector<uint32_t>& indices, const std::vector<MeshLod>& lods = {});
+    // Uploads the file's blobs straight from its mapping. Throws when they were not stored as vertexLayout
+    Mesh(GeometryPool& geometryPool, const VertexLayout& vertexLayout, const MeshFile& meshFile);
     Mesh(Mesh&& other) noexcept;
+    Mesh& operator=(Mesh&& other) noexcept;
 
     int GetVertexCount();
-    VkBuffer GetVertexBuffer();
 
-    int GetIndexCount();
-    VkBuffer GetIndexBuffer();
+    // Arguments for vkCmdDrawIndexed against the pool's buffers, at full detail unless a coarser level is given
+    int GetIndexCount(uint32_t lod = 0);
+    uint32_t GetFirstIndex(uint32_t lod = 0);
+    int32_t GetVertexOffset();
+    VkIndexType GetIndexType();
 
-    void DestroyBuffers();
+    // The mesh may be drawn once the UploadManager reports this ticket as complete
+    uint64_t GetUploadTicket();
 
-    ~Mesh();
+    // Restores model space positions from the stored ones, applied by the vertex shader
+    VertexDequantization GetDequantization();
 
-private:
-    int vertexCount_;
-    VkBuffer vertexBuffer_;
-    VkDeviceMemory vertexBufferMemory_;
+    const MeshBounds& GetBounds() const { return bounds_; }
 
-    int indexCount_;
-    VkBuffer indexBuffer_;
-    VkDeviceMemory indexBufferMemory_;
+    // Levels of detail, full detail first. Every mesh has at least one
+    uint32_t GetLodCount() const { return (uint32_t)lods_.size(); }
 
-    VkPhysicalDevice physicalDevice_;
-    VkDevice device_;
+    // How far the level's surface may lie from the full detail one, in model space units
+    float GetLodError(uint32_t lod) const { return lods_[lod].error; }
 
-    template <typename T>
-    void CreateGpuBuffer(VkQueue transferQueue, VkCommandPool transferCommandPool,
-        const std::vector<T>& points, VkBufferUsageFlags usageFlags, VkBuffer& buffer,
-        VkDeviceMemory& bufferMemory)
-    {
-        VkDeviceSize bufferSize = sizeof(T)*points.size();
-        
-        VkBuffer stagingBuffer;
-        VkDeviceMemory stagingBufferMemory;
-        CreateBuffer(physicalDevice_, device_, bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-            stagingBuffer, stagingBufferMemory);
- 
-        void* data;
-        vkMapMemory(device_, stagingBufferMemory, 0, bufferSize, 0, &data);
-        memcpy(data, points.data(), (size_t)bufferSize);
-        vkUnmapMemory(device_, stagingBufferMemory);
+    void DestroyBuffers();
 
-        // Create buffer for data on GPU access only area
-        CreateBuffer(physicalDevice_, device_, bufferSize, usageFlags, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-            buffer, bufferMemory);
+    ~Mesh();
 
-        // Copy from staging buffer to GPU access buffer
-        CopyBuffer(device_, transferQueue, transferCommandPool, stagingBuffer, buffer, bufferSize);
-    
-        // Destroy + Release Staging Buffer resources
-        vkDestroyBuffer(device_, stagingBuffer, nullptr);
-        vkFreeMemory(device_, stagingBufferMemory, nullptr);
-    }
+private:
+    GeometryPool* geometryPool_ = nullptr;
+    GeometryRange range_;
+    VertexDequantization dequantization_;
+    MeshBounds bounds_;
+    std::vector<MeshLod> lods_;
 };
 #endif // MESH_H
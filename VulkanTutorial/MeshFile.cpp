@@ -0,0 +1,200 @@
+#include "MeshFile.h"
+#include "GeometryPool.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+
+static uint64_t AlignUp(uint64_t value, uint64_t alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+// True when [offset, offset + size) lies within the file, without overflowing on hostile values
+static bool IsBlobInFile(uint64_t offset, uint64_t size, uint64_t fileSize)
+{
+    return offset <= fileSize && size <= fileSize - offset;
+}
+
+MeshFile::MeshFile(const std::string& path) : file_(path)
+{
+    if (file_.GetSize() < VERSION_1_HEADER_SIZE)
+    {
+        throw std::runtime_error("Not a mesh file: " + path);
+    }
+
+    // Fields a version 1 header does not have stay zero, which describes a single level of detail
+    header_ = {};
+    memcpy(&header_, file_.GetData(), VERSION_1_HEADER_SIZE);
+
+    if (memcmp(header_.magic, MAGIC, sizeof(MAGIC)) != 0)
+    {
+        throw std::runtime_error("Not a mesh file: " + path);
+    }
+    if (header_.version < MIN_VERSION || header_.version > VERSION)
+    {
+        throw std::runtime_error("Unsupported mesh file version " + std::to_string(header_.version) + ": " + path);
+    }
+    if (header_.version >= 2)
+    {
+        if (file_.GetSize() < sizeof(MeshFileHeader))
+        {
+            throw std::runtime_error("Corrupt mesh file: " + path);
+        }
+        memcpy(&header_, file_.GetData(), sizeof(header_));
+    }
+
+    // Checked up front so that the upload can trust the sizes. Index values are not checked, that would read
+    // every index page just to open the file
+    uint64_t fileSize = file_.GetSize();
+    bool valid = header_.vertexFormat <= (uint32_t)VertexFormat::Float16
+        && (header_.indexSize == sizeof(uint16_t) || header_.indexSize == sizeof(uint32_t))
+        && header_.vertexDataSize == (uint64_t)header_.vertexStride * header_.vertexCount
+        && header_.indexDataSize == (uint64_t)header_.indexSize * header_.indexCount
+        && header_.vertexDataOffset % MESH_FILE_ALIGNMENT == 0
+        && header_.indexDataOffset % MESH_FILE_ALIGNMENT == 0
+        && IsBlobInFile(header_.vertexDataOffset, header_.vertexDataSize, fileSize)
+        && IsBlobInFile(header_.indexDataOffset, header_.indexDataSize, fileSize)
+        && header_.lodDataOffset % MESH_FILE_ALIGNMENT == 0
+        && header_.lodCount <= MeshSimplifier::MAX_LODS
+        && IsBlobInFile(header_.lodDataOffset, (uint64_t)header_.lodCount * sizeof(MeshFileLod), fileSize);
+    if (!valid)
+    {
+        throw std::runtime_error("Corrupt mesh file: " + path);
+    }
+
+    const MeshFileLod* lodTable = reinterpret_cast<const MeshFileLod*>(file_.GetData() + header_.lodDataOffset);
+    for (uint32_t i = 0; i < header_.lodCount; ++i)
+    {
+        MeshFileLod fileLod;
+        memcpy(&fileLod, &lodTable[i], sizeof(fileLod));
+        if (fileLod.firstIndex > header_.indexCount || fileLod.indexCount > header_.indexCount - fileLod.firstIndex)
+        {
+            throw std::runtime_error("Corrupt mesh file: " + path);
+        }
+        lods_.push_back({ fileLod.firstIndex, fileLod.indexCount, fileLod.error });
+    }
+
+    // Files are opened to be uploaded, which reads both blobs front to back
+    file_.AdviseSequential();
+}
+
+void MeshFile::Write(const std::string& path, const VertexLayout& layout, const std::vector<Vertex>& vertices,
+    const std::vector<uint32_t>& indices, const std::vector<MeshLod>& lods)
+{
+    std::vector<uint8_t> encodedVertices;
+    VertexDequantization dequantization = layout.Encode(vertices, encodedVertices);
+
+    // Same rule as the geometry pool, so that the blob can be uploaded as it is
+    bool narrow = vertices.size() <= GeometryPool::MAX_16BIT_INDEXED_VERTICES;
+    std::vector<uint16_t> narrowIndices;
+    if (narrow)
+    {
+        narrowIndices.assign(indices.begin(), indices.end());
+    }
+
+    glm::vec3 boundsMin(std::numeric_limits<float>::max());
+    glm::vec3 boundsMax(std::numeric_limits<float>::lowest());
+    for (const Vertex& vertex : vertices)
+    {
+        boundsMin = glm::min(boundsMin, vertex.pos);
+        boundsMax = glm::max(boundsMax, vertex.pos);
+    }
+    if (vertices.empty())
+    {
+        boundsMin = boundsMax = glm::vec3(0.0f);
+    }
+
+    MeshFileHeader header{};
+    memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.vertexFormat = (uint32_t)layout.GetFormat();
+    header.flags = layout.HasNormals() ? FLAG_NORMALS : 0;
+    header.vertexStride = layout.GetStride();
+    header.vertexCount = (uint32_t)vertices.size();
+    header.indexCount = (uint32_t)indices.size();
+    header.indexSize = narrow ? sizeof(uint16_t) : sizeof(uint32_t);
+    for (int i = 0; i < 3; ++i)
+    {
+        header.boundsMin[i] = boundsMin[i];
+        header.boundsMax[i] = boundsMax[i];
+        header.positionScale[i] = dequantization.scale[i];
+        header.positionOffset[i] = dequantization.offset[i];
+    }
+    header.vertexDataOffset = AlignUp(sizeof(MeshFileHeader), MESH_FILE_ALIGNMENT);
+    header.vertexDataSize = encodedVertices.size();
+    header.indexDataOffset = AlignUp(header.vertexDataOffset + header.vertexDataSize, MESH_FILE_ALIGNMENT);
+    header.indexDataSize = (uint64_t)header.indexSize * header.indexCount;
+    header.lodCount = (uint32_t)lods.size();
+    header.lodDataOffset = lods.empty() ? 0 : AlignUp(header.indexDataOffset + header.indexDataSize,
+        MESH_FILE_ALIGNMENT);
+
+    std::vector<MeshFileLod> lodTable;
+    for (const MeshLod& lod : lods)
+    {
+        lodTable.push_back({ lod.firstIndex, lod.indexCount, lod.error, 0 });
+    }
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file.is_open())
+    {
+        throw std::runtime_error("Failed to open file: " + path);
+    }
+
+    const char padding[MESH_FILE_ALIGNMENT] = {};
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(padding, header.vertexDataOffset - sizeof(header));
+    file.write(reinterpret_cast<const char*>(encodedVertices.data()), encodedVertices.size());
+    file.write(padding, header.indexDataOffset - header.vertexDataOffset - header.vertexDataSize);
+    if (narrow)
+    {
+        file.write(reinterpret_cast<const char*>(narrowIndices.data()), header.indexDataSize);
+    }
+    else
+    {
+        file.write(reinterpret_cast<const char*>(indices.data()), header.indexDataSize);
+    }
+    if (!lodTable.empty())
+    {
+        file.write(padding, header.lodDataOffset - header.indexDataOffset - header.indexDataSize);
+        file.write(reinterpret_cast<const char*>(lodTable.data()), lodTable.size() * sizeof(MeshFileLod));
+    }
+
+    if (!file)
+    {
+        throw std::runtime_error("Failed to write mesh file: " + path);
+    }
+}
+
+bool MeshFile::MatchesLayout(const VertexLayout& layout) const
+{
+    return header_.vertexFormat == (uint32_t)layout.GetFormat()
+        && ((header_.flags & FLAG_NORMALS) != 0) == layout.HasNormals()
+        && header_.vertexStride == layout.GetStride();
+}
+
+VkIndexType MeshFile::GetIndexType() const
+{
+    return header_.indexSize == sizeof(uint16_t) ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+}
+
+VertexDequantization MeshFile::GetDequantization() const
+{
+    VertexDequantization dequantization;
+    dequantization.scale = glm::vec3(header_.positionScale[0], header_.positionScale[1], header_.positionScale[2]);
+    dequantization.offset = glm::vec3(header_.positionOffset[0], header_.positionOffset[1],
+        header_.positionOffset[2]);
+    return dequantization;
+}
+
+glm::vec3 MeshFile::GetBoundsMin() const
+{
+    return glm::vec3(header_.boundsMin[0], header_.boundsMin[1], header_.boundsMin[2]);
+}
+
+glm::vec3 MeshFile::GetBoundsMax() const
+{
+    return glm::vec3(header_.boundsMax[0], header_.boundsMax[1], header_.boundsMax[2]);
+}
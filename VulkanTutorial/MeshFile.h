@@ -0,0 +1,119 @@
+#pragma once
+#ifndef MESH_FILE_H
+#define MESH_FILE_H
+
+#include <glm/glm.hpp>
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "MappedFile.h"
+#include "MeshSimplifier.h"
+#include "VertexLayout.h"
+
+// On-disk header of a mesh file. The vertex and index blobs follow it, each starting on a
+// MESH_FILE_ALIGNMENT boundary and stored exactly as the geometry pool holds them, so loading
+// copies them from the mapping into the staging ring without converting anything. Little endian only.
+// Version 1 files end the header after indexDataSize and hold a single level of detail
+struct MeshFileHeader
+{
+    char magic[4];
+    uint32_t version;
+
+    // VertexFormat and whether normals are present, the renderer's VertexLayout must match both
+    uint32_t vertexFormat;
+    uint32_t flags;
+    uint32_t vertexStride;
+    uint32_t vertexCount;
+
+    uint32_t indexCount;
+
+    // 2 or 4 bytes, 16-bit whenever every index fits
+    uint32_t indexSize;
+
+    // Model space bounds of the positions before quantisation
+    float boundsMin[3];
+    float boundsMax[3];
+
+    // VertexDequantization of the stored positions
+    float positionScale[3];
+    float positionOffset[3];
+
+    // Byte offsets from the start of the file
+    uint64_t vertexDataOffset;
+    uint64_t vertexDataSize;
+    uint64_t indexDataOffset;
+    uint64_t indexDataSize;
+
+    // Table of MeshFileLod entries describing the levels stored back to back in the index blob. Empty when
+    // the index blob is a single level
+    uint64_t lodDataOffset;
+    uint32_t lodCount;
+    uint32_t reserved;
+};
+static_assert(sizeof(MeshFileHeader) == 128, "MeshFileHeader must match the on-disk layout");
+
+// On-disk entry of the level of detail table, the same fields as MeshLod
+struct MeshFileLod
+{
+    uint32_t firstIndex;
+    uint32_t indexCount;
+    float error;
+    uint32_t reserved;
+};
+static_assert(sizeof(MeshFileLod) == 16, "MeshFileLod must match the on-disk layout");
+
+// A mesh file mapped into memory. The blobs are read straight from the mapping, which stays valid for
+// as long as the MeshFile exists
+class MeshFile
+{
+public:
+    static constexpr char MAGIC[4] = { 'P', '3', 'D', 'M' };
+    static constexpr uint32_t VERSION = 2;
+
+    // Oldest version that can still be read, and the size of its header
+    static constexpr uint32_t MIN_VERSION = 1;
+    static constexpr size_t VERSION_1_HEADER_SIZE = 112;
+    static constexpr uint32_t FLAG_NORMALS = 1;
+
+    // Keeps every blob cache line aligned in the mapping, which also satisfies the staging ring's alignment
+    static constexpr uint64_t MESH_FILE_ALIGNMENT = 64;
+
+    // Maps the file and validates its header. Throws when the file is not a mesh file of a supported version
+    explicit MeshFile(const std::string& path);
+
+    // Encodes the vertices into layout, narrows the indices where possible and writes them as a mesh file.
+    // indices holds every level of detail back to back as described by lods, which may be empty
+    static void Write(const std::string& path, const VertexLayout& layout, const std::vector<Vertex>& vertices,
+        const std::vector<uint32_t>& indices, const std::vector<MeshLod>& lods = {});
+
+    const MeshFileHeader& GetHeader() const { return header_; }
+    size_t GetFileSize() const { return file_.GetSize(); }
+
+    // True when the blobs can be uploaded into a geometry pool that stores vertices as layout
+    bool MatchesLayout(const VertexLayout& layout) const;
+
+    const void* GetVertexData() const { return file_.GetData() + header_.vertexDataOffset; }
+    const void* GetIndexData() const { return file_.GetData() + header_.indexDataOffset; }
+    uint32_t GetVertexCount() const { return header_.vertexCount; }
+    uint32_t GetIndexCount() const { return header_.indexCount; }
+    VkIndexType GetIndexType() const;
+
+    // Empty when the file holds a single level of detail
+    const std::vector<MeshLod>& GetLods() const { return lods_; }
+
+    VertexDequantization GetDequantization() const;
+    glm::vec3 GetBoundsMin() const;
+    glm::vec3 GetBoundsMax() const;
+
+private:
+    MappedFile file_;
+
+    // Validated copy of the header at the start of the mapping, upgraded to the current version
+    MeshFileHeader header_;
+
+    // Validated copy of the level of detail table
+    std::vector<MeshLod> lods_;
+};
+#endif // MESH_FILE_H
@@ -0,0 +1,857 @@
+#include "MeshImporter.h"
+#include "Json.h"
+#include "MappedFile.h"
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <stdexcept>
+#include <string_view>
+#include <unordered_map>
+
+// glTF componentType values
+static const uint32_t GLTF_BYTE = 5120;
+static const uint32_t GLTF_UNSIGNED_BYTE = 5121;
+static const uint32_t GLTF_SHORT = 5122;
+static const uint32_t GLTF_UNSIGNED_SHORT = 5123;
+static const uint32_t GLTF_UNSIGNED_INT = 5125;
+static const uint32_t GLTF_FLOAT = 5126;
+
+static const uint32_t GLTF_TRIANGLES = 4;
+
+// GLB container magic and chunk types, little endian
+static const uint32_t GLB_MAGIC = 0x46546C67;
+static const uint32_t GLB_CHUNK_JSON = 0x4E4F534A;
+static const uint32_t GLB_CHUNK_BIN = 0x004E4942;
+
+static const glm::vec3 DEFAULT_COLOUR = glm::vec3(1.0f);
+
+namespace
+{
+    // A face corner as written in the file. Positive indices are absolute, negative ones count back from the last
+    // element read so far and become absolute once the chunk's place in the file is known
+    struct ObjCorner
+    {
+        static constexpr uint8_t POSITION_RELATIVE = 1;
+        static constexpr uint8_t NORMAL_RELATIVE = 2;
+        static constexpr uint8_t HAS_NORMAL = 4;
+
+        int32_t position = 0;
+        int32_t normal = 0;
+        uint8_t flags = 0;
+    };
+
+    struct FileImport;
+
+    // A range of whole lines of an OBJ file
+    struct ObjChunk
+    {
+        FileImport* file = nullptr;
+        const char* begin = nullptr;
+        const char* end = nullptr;
+
+        // Parsed elements, moved into the file once every chunk is parsed. Colours are parallel to positions
+        std::vector<glm::vec3> positions;
+        std::vector<glm::vec3> colours;
+        std::vector<glm::vec3> normals;
+
+        // Three per triangle, polygons are triangulated as fans while parsing
+        std::vector<ObjCorner> corners;
+
+        // Elements in all preceding chunks, what relative indices are rebased on
+        uint32_t firstPosition = 0;
+        uint32_t firstNormal = 0;
+
+        // Vertices are welded within the chunk only, so chunks never wait on each other
+        std::vector<Vertex> vertices;
+        std::vector<uint32_t> indices;
+    };
+
+    // Element pointers of a glTF accessor, resolved and bounds checked against its buffer
+    struct GltfAccessor
+    {
+        const uint8_t* data = nullptr;
+        uint32_t count = 0;
+        uint32_t componentType = 0;
+        uint32_t componentCount = 0;
+        uint32_t stride = 0;
+        bool normalized = false;
+    };
+
+    struct GltfPrimitive
+    {
+        ImportedMesh mesh;
+
+        GltfAccessor position;
+        GltfAccessor normal;
+        GltfAccessor colour;
+        GltfAccessor indices;
+    };
+
+    struct GltfBuffer
+    {
+        // External .bin files stay mapped, embedded base64 data has to be decoded into memory
+        MappedFile mapping;
+        std::vector<uint8_t> decoded;
+
+        const uint8_t* data = nullptr;
+        size_t size = 0;
+    };
+
+    struct FileImport
+    {
+        std::string path;
+        bool gltf = false;
+        MappedFile mapping;
+
+        std::vector<ObjChunk> objChunks;
+        std::vector<glm::vec3> objPositions;
+        std::vector<glm::vec3> objColours;
+        std::vector<glm::vec3> objNormals;
+
+        std::vector<GltfBuffer> gltfBuffers;
+        std::vector<GltfPrimitive> gltfPrimitives;
+    };
+}
+
+static void RunTasks(ThreadPool& threadPool, const std::vector<std::function<void()>>& tasks)
+{
+    threadPool.ParallelFor((uint32_t)tasks.size(), [&](uint32_t taskIndex)
+        {
+            tasks[taskIndex]();
+        });
+}
+
+static std::string GetExtension(const std::string& path)
+{
+    std::string extension = std::filesystem::path(path).extension().string();
+    std::transform(extension.begin(), extension.end(), extension.begin(),
+        [](unsigned char c) { return (char)std::tolower(c); });
+    return extension;
+}
+
+// --- OBJ ---
+
+static const char* SkipSpaces(const char* p, const char* end)
+{
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\r'))
+    {
+        ++p;
+    }
+    return p;
+}
+
+static bool ParseFloat(const char*& p, const char* end, float& value)
+{
+    p = SkipSpaces(p, end);
+    std::from_chars_result result = std::from_chars(p, end, value);
+    if (result.ec != std::errc() || result.ptr == p)
+    {
+        return false;
+    }
+    p = result.ptr;
+    return true;
+}
+
+static bool ParseVec3(const char*& p, const char* end, glm::vec3& value)
+{
+    return ParseFloat(p, end, value.x) && ParseFloat(p, end, value.y) && ParseFloat(p, end, value.z);
+}
+
+static bool ParseInt(const char*& p, const char* end, int32_t& value)
+{
+    std::from_chars_result result = std::from_chars(p, end, value);
+    if (result.ec != std::errc() || result.ptr == p)
+    {
+        return false;
+    }
+    p = result.ptr;
+    return true;
+}
+
+// Splits the file at the first line break after every OBJ_CHUNK_SIZE bytes
+static void SplitObjFile(FileImport& file)
+{
+    const char* data = reinterpret_cast<const char*>(file.mapping.GetData());
+    const char* end = data + file.mapping.GetSize();
+
+    const char* begin = data;
+    while (begin < end)
+    {
+        const char* chunkEnd = begin + std::min<size_t>(MeshImporter::OBJ_CHUNK_SIZE, end - begin);
+        const char* lineBreak = static_cast<const char*>(memchr(chunkEnd, '\n', end - chunkEnd));
+        chunkEnd = lineBreak ? lineBreak + 1 : end;
+
+        ObjChunk chunk;
+        chunk.file = &file;
+        chunk.begin = begin;
+        chunk.end = chunkEnd;
+        file.objChunks.push_back(std::move(chunk));
+
+        begin = chunkEnd;
+    }
+}
+
+static void ParseObjFace(ObjChunk& chunk, const char* p, const char* end, std::vector<ObjCorner>& polygon)
+{
+    polygon.clear();
+
+    while (true)
+    {
+        p = SkipSpaces(p, end);
+        if (p >= end || *p == '#')
+        {
+            break;
+        }
+
+        ObjCorner corner;
+        int32_t position = 0;
+        if (!ParseInt(p, end, position) || position == 0)
+        {
+            throw std::runtime_error("Malformed face in OBJ file: " + chunk.file->path);
+        }
+        corner.position = position > 0 ? position - 1 : (int32_t)chunk.positions.size() + position;
+        corner.flags |= position < 0 ? ObjCorner::POSITION_RELATIVE : 0;
+
+        // v, v/vt, v//vn or v/vt/vn. Texture coordinates are not stored by Vertex and skipped
+        if (p < end && *p == '/')
+        {
+            ++p;
+            int32_t unused = 0;
+            if (p < end && *p != '/')
+            {
+                ParseInt(p, end, unused);
+            }
+
+            int32_t normal = 0;
+            if (p < end && *p == '/')
+            {
+                ++p;
+                if (!ParseInt(p, end, normal) || normal == 0)
+                {
+                    throw std::runtime_error("Malformed face in OBJ file: " + chunk.file->path);
+                }
+                corner.normal = normal > 0 ? normal - 1 : (int32_t)chunk.normals.size() + normal;
+                corner.flags |= ObjCorner::HAS_NORMAL | (normal < 0 ? ObjCorner::NORMAL_RELATIVE : 0);
+            }
+        }
+
+        polygon.push_back(corner);
+    }
+
+    for (size_t i = 2; i < polygon.size(); ++i)
+    {
+        chunk.corners.push_back(polygon[0]);
+        chunk.corners.push_back(polygon[i - 1]);
+        chunk.corners.push_back(polygon[i]);
+    }
+}
+
+static void ParseObjChunk(ObjChunk& chunk)
+{
+    std::vector<ObjCorner> polygon;
+
+    const char* p = chunk.begin;
+    while (p < chunk.end)
+    {
+        const char* lineBreak = static_cast<const char*>(memchr(p, '\n', chunk.end - p));
+        const char* lineEnd = lineBreak ? lineBreak : chunk.end;
+
+        p = SkipSpaces(p, lineEnd);
+        size_t length = lineEnd - p;
+
+        // Groups, objects, materials and texture coordinates are ignored, the file becomes a single mesh
+        if (length > 2 && p[0] == 'v' && (p[1] == ' ' || p[1] == '\t'))
+        {
+            const char* values = p + 2;
+            glm::vec3 position;
+            if (!ParseVec3(values, lineEnd, position))
+            {
+                throw std::runtime_error("Malformed vertex in OBJ file: " + chunk.file->path);
+            }
+
+            // A widespread extension appends an RGB colour to the position
+            glm::vec3 colour;
+            if (!ParseVec3(values, lineEnd, colour))
+            {
+                colour = DEFAULT_COLOUR;
+            }
+
+            chunk.positions.push_back(position);
+            chunk.colours.push_back(colour);
+        }
+        else if (length > 3 && p[0] == 'v' && p[1] == 'n' && (p[2] == ' ' || p[2] == '\t'))
+        {
+            const char* values = p + 3;
+            glm::vec3 normal;
+            if (!ParseVec3(values, lineEnd, normal))
+            {
+                throw std::runtime_error("Malformed normal in OBJ file: " + chunk.file->path);
+            }
+            chunk.normals.push_back(normal);
+        }
+        else if (length > 2 && p[0] == 'f' && (p[1] == ' ' || p[1] == '\t'))
+        {
+            ParseObjFace(chunk, p + 2, lineEnd, polygon);
+        }
+
+        p = lineEnd + 1;
+    }
+}
+
+// Turns the chunk's corners into welded vertices, looking elements up in the file wide arrays
+static void ResolveObjChunk(ObjChunk& chunk)
+{
+    const FileImport& file = *chunk.file;
+
+    std::unordered_map<uint64_t, uint32_t> vertexIds;
+    vertexIds.reserve(chunk.corners.size());
+    chunk.indices.reserve(chunk.corners.size());
+
+    for (const ObjCorner& corner : chunk.corners)
+    {
+        int64_t position = corner.position
+            + ((corner.flags & ObjCorner::POSITION_RELATIVE) ? (int64_t)chunk.firstPosition : 0);
+        if (position < 0 || position >= (int64_t)file.objPositions.size())
+        {
+            throw std::runtime_error("Face references a missing vertex in OBJ file: " + file.path);
+        }
+
+        int64_t normal = -1;
+        if (corner.flags & ObjCorner::HAS_NORMAL)
+        {
+            normal = corner.normal + ((corner.flags & ObjCorner::NORMAL_RELATIVE) ? (int64_t)chunk.firstNormal : 0);
+            if (normal < 0 || normal >= (int64_t)file.objNormals.size())
+            {
+                throw std::runtime_error("Face references a missing normal in OBJ file: " + file.path);
+            }
+        }
+
+        uint64_t key = ((uint64_t)position << 32) | (uint32_t)(normal + 1);
+        auto [it, inserted] = vertexIds.try_emplace(key, (uint32_t)chunk.vertices.size());
+        if (inserted)
+        {
+            Vertex vertex;
+            vertex.pos = file.objPositions[position];
+            vertex.col = file.objColours[position];
+            if (normal >= 0)
+            {
+                vertex.normal = file.objNormals[normal];
+            }
+            chunk.vertices.push_back(vertex);
+        }
+        chunk.indices.push_back(it->second);
+    }
+}
+
+// --- glTF ---
+
+static uint32_t ReadUint32(const uint8_t* data)
+{
+    uint32_t value;
+    memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+static std::vector<uint8_t> DecodeBase64(std::string_view text, const std::string& path)
+{
+    std::vector<uint8_t> decoded;
+    decoded.reserve(text.size() / 4 * 3);
+
+    uint32_t bits = 0;
+    int bitCount = 0;
+    for (char c : text)
+    {
+        uint32_t value;
+        if (c >= 'A' && c <= 'Z') value = c - 'A';
+        else if (c >= 'a' && c <= 'z') value = c - 'a' + 26;
+        else if (c >= '0' && c <= '9') value = c - '0' + 52;
+        else if (c == '+') value = 62;
+        else if (c == '/') value = 63;
+        else if (c == '=') break;
+        else throw std::runtime_error("Invalid base64 buffer in glTF file: " + path);
+
+        bits = (bits << 6) | value;
+        bitCount += 6;
+        if (bitCount >= 8)
+        {
+            bitCount -= 8;
+            decoded.push_back((uint8_t)(bits >> bitCount));
+        }
+    }
+
+    return decoded;
+}
+
+static uint32_t GetComponentSize(uint32_t componentType)
+{
+    switch (componentType)
+    {
+    case GLTF_BYTE:
+    case GLTF_UNSIGNED_BYTE:
+        return 1;
+    case GLTF_SHORT:
+    case GLTF_UNSIGNED_SHORT:
+        return 2;
+    case GLTF_UNSIGNED_INT:
+    case GLTF_FLOAT:
+        return 4;
+    default:
+        return 0;
+    }
+}
+
+static uint32_t GetComponentCount(const std::string& type)
+{
+    if (type == "SCALAR") return 1;
+    if (type == "VEC2") return 2;
+    if (type == "VEC3") return 3;
+    if (type == "VEC4") return 4;
+    return 0;
+}
+
+static float ReadComponent(const uint8_t* data, uint32_t componentType, bool normalized)
+{
+    switch (componentType)
+    {
+    case GLTF_BYTE:
+    {
+        int8_t value = (int8_t)data[0];
+        return normalized ? std::max(value / 127.0f, -1.0f) : (float)value;
+    }
+    case GLTF_UNSIGNED_BYTE:
+        return normalized ? data[0] / 255.0f : (float)data[0];
+    case GLTF_SHORT:
+    {
+        int16_t value;
+        memcpy(&value, data, sizeof(value));
+        return normalized ? std::max(value / 32767.0f, -1.0f) : (float)value;
+    }
+    case GLTF_UNSIGNED_SHORT:
+    {
+        uint16_t value;
+        memcpy(&value, data, sizeof(value));
+        return normalized ? value / 65535.0f : (float)value;
+    }
+    case GLTF_UNSIGNED_INT:
+        return (float)ReadUint32(data);
+    default:
+    {
+        float value;
+        memcpy(&value, data, sizeof(value));
+        return value;
+    }
+    }
+}
+
+static glm::vec3 ReadVec3(const GltfAccessor& accessor, uint32_t element)
+{
+    const uint8_t* data = accessor.data + (size_t)element * accessor.stride;
+    uint32_t componentSize = GetComponentSize(accessor.componentType);
+    return glm::vec3(ReadComponent(data, accessor.componentType, accessor.normalized),
+        ReadComponent(data + componentSize, accessor.componentType, accessor.normalized),
+        ReadComponent(data + 2 * componentSize, accessor.componentType, accessor.normalized));
+}
+
+// glTF 2.0 only allows unsigned integer index accessors
+static bool IsIndexComponentType(uint32_t componentType)
+{
+    return componentType == GLTF_UNSIGNED_BYTE || componentType == GLTF_UNSIGNED_SHORT
+        || componentType == GLTF_UNSIGNED_INT;
+}
+
+// The accessor must have passed IsIndexComponentType, other types would be read past their element
+static uint32_t ReadIndex(const GltfAccessor& accessor, uint32_t element)
+{
+    const uint8_t* data = accessor.data + (size_t)element * accessor.stride;
+    switch (accessor.componentType)
+    {
+    case GLTF_UNSIGNED_BYTE:
+        return data[0];
+    case GLTF_UNSIGNED_SHORT:
+    {
+        uint16_t value;
+        memcpy(&value, data, sizeof(value));
+        return value;
+    }
+    case GLTF_UNSIGNED_INT:
+    default:
+        return ReadUint32(data);
+    }
+}
+
+static const JsonValue& GetElement(const JsonValue& document, const char* array, uint32_t index, const std::string& path)
+{
+    const JsonValue* elements = document.Find(array);
+    if (!elements || index >= elements->GetElements().size())
+    {
+        throw std::runtime_error(std::string("Missing ") + array + " entry in glTF file: " + path);
+    }
+    return elements->GetElements()[index];
+}
+
+// Resolves an accessor to its first element and checks that every element lies inside its buffer
+static GltfAccessor ResolveAccessor(const FileImport& file, const JsonValue& document, uint32_t accessorIndex)
+{
+    const JsonValue& accessorJson = GetElement(document, "accessors", accessorIndex, file.path);
+    if (accessorJson.Find("sparse") || !accessorJson.Find("bufferView"))
+    {
+        throw std::runtime_error("Sparse and buffer-less accessors are not supported: " + file.path);
+    }
+
+    GltfAccessor accessor;
+    accessor.count = accessorJson.GetUint("count");
+    accessor.componentType = accessorJson.GetUint("componentType");
+    accessor.componentCount = GetComponentCount(accessorJson.GetString("type"));
+    accessor.normalized = accessorJson.GetBool("normalized");
+
+    uint32_t elementSize = GetComponentSize(accessor.componentType) * accessor.componentCount;
+    if (elementSize == 0)
+    {
+        throw std::runtime_error("Accessor has an unknown type in glTF file: " + file.path);
+    }
+
+    const JsonValue& viewJson = GetElement(document, "bufferViews", accessorJson.GetUint("bufferView"), file.path);
+    uint32_t bufferIndex = viewJson.GetUint("buffer");
+    if (bufferIndex >= file.gltfBuffers.size())
+    {
+        throw std::runtime_error("Buffer view references a missing buffer in glTF file: " + file.path);
+    }
+    const GltfBuffer& buffer = file.gltfBuffers[bufferIndex];
+
+    uint64_t viewOffset = viewJson.GetUint("byteOffset");
+    uint64_t viewLength = viewJson.GetUint("byteLength");
+    uint64_t accessorOffset = accessorJson.GetUint("byteOffset");
+    accessor.stride = viewJson.GetUint("byteStride", elementSize);
+
+    uint64_t accessorEnd = accessor.count > 0
+        ? accessorOffset + (uint64_t)(accessor.count - 1) * accessor.stride + elementSize : accessorOffset;
+    if (viewOffset + viewLength > buffer.size || accessorEnd > viewLength)
+    {
+        throw std::runtime_error("Accessor lies outside of its buffer in glTF file: " + file.path);
+    }
+
+    accessor.data = buffer.data + viewOffset + accessorOffset;
+    return accessor;
+}
+
+static void LoadGltfBuffers(FileImport& file, const JsonValue& document, const uint8_t* glbData, size_t glbSize)
+{
+    const JsonValue* buffers = document.Find("buffers");
+    if (!buffers)
+    {
+        return;
+    }
+
+    std::filesystem::path directory = std::filesystem::path(file.path).parent_path();
+    file.gltfBuffers.resize(buffers->GetElements().size());
+
+    for (size_t i = 0; i < file.gltfBuffers.size(); ++i)
+    {
+        const JsonValue& bufferJson = buffers->GetElements()[i];
+        GltfBuffer& buffer = file.gltfBuffers[i];
+        const JsonValue* uri = bufferJson.Find("uri");
+
+        if (!uri)
+        {
+            // Only the first buffer of a GLB may omit its uri, it refers to the binary chunk
+            if (i != 0 || !glbData)
+            {
+                throw std::runtime_error("Buffer without a uri in glTF file: " + file.path);
+            }
+            buffer.data = glbData;
+            buffer.size = glbSize;
+        }
+        else if (uri->AsString().rfind("data:", 0) == 0)
+        {
+            size_t comma = uri->AsString().find(',');
+            if (comma == std::string::npos || uri->AsString().find(";base64") > comma)
+            {
+                throw std::runtime_error("Unsupported data uri in glTF file: " + file.path);
+            }
+            buffer.decoded = DecodeBase64(std::string_view(uri->AsString()).substr(comma + 1), file.path);
+            buffer.data = buffer.decoded.data();
+            buffer.size = buffer.decoded.size();
+        }
+        else
+        {
+            buffer.mapping = MappedFile((directory / uri->AsString()).string());
+            buffer.mapping.AdviseSequential();
+            buffer.data = buffer.mapping.GetData();
+            buffer.size = buffer.mapping.GetSize();
+        }
+
+        if (bufferJson.GetNumber("byteLength") > (double)buffer.size)
+        {
+            throw std::runtime_error("Buffer is shorter than its byteLength in glTF file: " + file.path);
+        }
+    }
+}
+
+// Parses the document and resolves every triangle primitive's accessors. The vertex data is decoded later
+static void LoadGltfFile(FileImport& file)
+{
+    const uint8_t* data = file.mapping.GetData();
+    size_t size = file.mapping.GetSize();
+
+    std::string_view json(reinterpret_cast<const char*>(data), size);
+    const uint8_t* binData = nullptr;
+    size_t binSize = 0;
+
+    if (size >= 12 && ReadUint32(data) == GLB_MAGIC)
+    {
+        // 12 byte header followed by a JSON chunk and an optional binary chunk, each with an 8 byte header
+        if (ReadUint32(data + 4) != 2 || size < 20 || ReadUint32(data + 16) != GLB_CHUNK_JSON)
+        {
+            throw std::runtime_error("Unsupported GLB file: " + file.path);
+        }
+
+        size_t jsonLength = ReadUint32(data + 12);
+        if (jsonLength > size - 20)
+        {
+            throw std::runtime_error("Truncated GLB file: " + file.path);
+        }
+        json = std::string_view(reinterpret_cast<const char*>(data + 20), jsonLength);
+
+        size_t binChunk = 20 + jsonLength;
+        if (binChunk + 8 <= size && ReadUint32(data + binChunk + 4) == GLB_CHUNK_BIN)
+        {
+            binSize = ReadUint32(data + binChunk);
+            if (binSize > size - binChunk - 8)
+            {
+                throw std::runtime_error("Truncated GLB file: " + file.path);
+            }
+            binData = data + binChunk + 8;
+        }
+    }
+
+    JsonValue document = JsonValue::Parse(json);
+    LoadGltfBuffers(file, document, binData, binSize);
+
+    const JsonValue* meshes = document.Find("meshes");
+    if (!meshes)
+    {
+        return;
+    }
+
+    std::string stem = std::filesystem::path(file.path).stem().string();
+    for (size_t meshIndex = 0; meshIndex < meshes->GetElements().size(); ++meshIndex)
+    {
+        const JsonValue& meshJson = meshes->GetElements()[meshIndex];
+        std::string meshName = meshJson.GetString("name", stem + "_" + std::to_string(meshIndex));
+
+        const JsonValue* primitives = meshJson.Find("primitives");
+        if (!primitives)
+        {
+            continue;
+        }
+
+        for (size_t primitiveIndex = 0; primitiveIndex < primitives->GetElements().size(); ++primitiveIndex)
+        {
+            const JsonValue& primitiveJson = primitives->GetElements()[primitiveIndex];
+            if (primitiveJson.GetUint("mode", GLTF_TRIANGLES) != GLTF_TRIANGLES)
+            {
+                printf("Skipping non-triangle primitive %zu of mesh %s in %s\n", primitiveIndex, meshName.c_str(),
+                    file.path.c_str());
+                continue;
+            }
+
+            const JsonValue* attributes = primitiveJson.Find("attributes");
+            if (!attributes || !attributes->Find("POSITION"))
+            {
+                throw std::runtime_error("Primitive without positions in glTF file: " + file.path);
+            }
+
+            GltfPrimitive primitive;
+            primitive.mesh.name = primitives->GetElements().size() > 1
+                ? meshName + "_" + std::to_string(primitiveIndex) : meshName;
+            primitive.position = ResolveAccessor(file, document, attributes->GetUint("POSITION"));
+            if (attributes->Find("NORMAL"))
+            {
+                primitive.normal = ResolveAccessor(file, document, attributes->GetUint("NORMAL"));
+            }
+            if (attributes->Find("COLOR_0"))
+            {
+                primitive.colour = ResolveAccessor(file, document, attributes->GetUint("COLOR_0"));
+            }
+            if (primitiveJson.Find("indices"))
+            {
+                primitive.indices = ResolveAccessor(file, document, primitiveJson.GetUint("indices"));
+            }
+
+            const GltfAccessor& position = primitive.position;
+            bool valid = position.componentType == GLTF_FLOAT && position.componentCount == 3
+                && (!primitive.normal.data || (primitive.normal.componentType == GLTF_FLOAT
+                    && primitive.normal.componentCount == 3 && primitive.normal.count == position.count))
+                && (!primitive.colour.data || (primitive.colour.componentCount >= 3
+                    && primitive.colour.count == position.count))
+                && (!primitive.indices.data || (primitive.indices.componentCount == 1
+                    && IsIndexComponentType(primitive.indices.componentType)));
+            if (!valid)
+            {
+                throw std::runtime_error("Primitive has unsupported attribute types in glTF file: " + file.path);
+            }
+
+            primitive.mesh.vertices.resize(position.count);
+            primitive.mesh.indices.resize(primitive.indices.data ? primitive.indices.count : position.count);
+            file.gltfPrimitives.push_back(std::move(primitive));
+        }
+    }
+}
+
+static void DecodeGltfVertices(GltfPrimitive& primitive, uint32_t begin, uint32_t end)
+{
+    for (uint32_t i = begin; i < end; ++i)
+    {
+        Vertex& vertex = primitive.mesh.vertices[i];
+        vertex.pos = ReadVec3(primitive.position, i);
+        vertex.col = primitive.colour.data ? ReadVec3(primitive.colour, i) : DEFAULT_COLOUR;
+        if (primitive.normal.data)
+        {
+            vertex.normal = ReadVec3(primitive.normal, i);
+        }
+    }
+}
+
+static void DecodeGltfIndices(GltfPrimitive& primitive, uint32_t begin, uint32_t end, const std::string& path)
+{
+    uint32_t vertexCount = (uint32_t)primitive.mesh.vertices.size();
+    for (uint32_t i = begin; i < end; ++i)
+    {
+        // Non-indexed primitives draw their vertices in order
+        uint32_t index = primitive.indices.data ? ReadIndex(primitive.indices, i) : i;
+        if (index >= vertexCount)
+        {
+            throw std::runtime_error("Index out of range in glTF file: " + path);
+        }
+        primitive.mesh.indices[i] = index;
+    }
+}
+
+// --- Import ---
+
+MeshImporter::MeshImporter(ThreadPool& threadPool) : threadPool_(threadPool)
+{
+}
+
+std::vector<ImportedMesh> MeshImporter::Import(const std::vector<std::string>& paths)
+{
+    std::vector<FileImport> files(paths.size());
+    std::vector<std::function<void()>> tasks;
+
+    // Map every file, split OBJ files into chunks and parse glTF documents
+    for (size_t i = 0; i < paths.size(); ++i)
+    {
+        FileImport& file = files[i];
+        file.path = paths[i];
+
+        std::string extension = GetExtension(file.path);
+        if (extension == ".gltf" || extension == ".glb")
+        {
+            file.gltf = true;
+        }
+        else if (extension != ".obj")
+        {
+            throw std::runtime_error("Unsupported mesh format: " + file.path);
+        }
+
+        tasks.push_back([&file]()
+            {
+                file.mapping = MappedFile(file.path);
+                file.mapping.AdviseSequential();
+                if (file.gltf)
+                {
+                    LoadGltfFile(file);
+                }
+                else
+                {
+                    SplitObjFile(file);
+                }
+            });
+    }
+    RunTasks(threadPool_, tasks);
+    tasks.clear();
+
+    // Parse OBJ chunks and decode glTF accessors block by block, all files at once
+    for (FileImport& file : files)
+    {
+        for (ObjChunk& chunk : file.objChunks)
+        {
+            tasks.push_back([&chunk]() { ParseObjChunk(chunk); });
+        }
+
+        for (GltfPrimitive& primitive : file.gltfPrimitives)
+        {
+            uint32_t vertexCount = (uint32_t)primitive.mesh.vertices.size();
+            for (uint32_t begin = 0; begin < vertexCount; begin += GLTF_BLOCK_SIZE)
+            {
+                uint32_t end = std::min(begin + GLTF_BLOCK_SIZE, vertexCount);
+                tasks.push_back([&primitive, begin, end]() { DecodeGltfVertices(primitive, begin, end); });
+            }
+
+            uint32_t indexCount = (uint32_t)primitive.mesh.indices.size();
+            for (uint32_t begin = 0; begin < indexCount; begin += GLTF_BLOCK_SIZE)
+            {
+                uint32_t end = std::min(begin + GLTF_BLOCK_SIZE, indexCount);
+                tasks.push_back([&primitive, &file, begin, end]()
+                    {
+                        DecodeGltfIndices(primitive, begin, end, file.path);
+                    });
+            }
+        }
+    }
+    RunTasks(threadPool_, tasks);
+    tasks.clear();
+
+    // Gather each OBJ file's elements so that faces can reference elements of any chunk
+    for (FileImport& file : files)
+    {
+        for (ObjChunk& chunk : file.objChunks)
+        {
+            chunk.firstPosition = (uint32_t)file.objPositions.size();
+            chunk.firstNormal = (uint32_t)file.objNormals.size();
+            file.objPositions.insert(file.objPositions.end(), chunk.positions.begin(), chunk.positions.end());
+            file.objColours.insert(file.objColours.end(), chunk.colours.begin(), chunk.colours.end());
+            file.objNormals.insert(file.objNormals.end(), chunk.normals.begin(), chunk.normals.end());
+            chunk.positions = {};
+            chunk.colours = {};
+            chunk.normals = {};
+
+            tasks.push_back([&chunk]() { ResolveObjChunk(chunk); });
+        }
+    }
+    RunTasks(threadPool_, tasks);
+    tasks.clear();
+
+    std::vector<ImportedMesh> meshes;
+    for (FileImport& file : files)
+    {
+        if (file.gltf)
+        {
+            for (GltfPrimitive& primitive : file.gltfPrimitives)
+            {
+                meshes.push_back(std::move(primitive.mesh));
+            }
+            continue;
+        }
+
+        ImportedMesh mesh;
+        mesh.name = std::filesystem::path(file.path).stem().string();
+        for (ObjChunk& chunk : file.objChunks)
+        {
+            uint32_t firstVertex = (uint32_t)mesh.vertices.size();
+            mesh.vertices.insert(mesh.vertices.end(), chunk.vertices.begin(), chunk.vertices.end());
+            for (uint32_t index : chunk.indices)
+            {
+                mesh.indices.push_back(firstVertex + index);
+            }
+        }
+        meshes.push_back(std::move(mesh));
+    }
+
+    return meshes;
+}
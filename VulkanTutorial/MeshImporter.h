@@ -0,0 +1,43 @@
+#pragma once
+#ifndef MESH_IMPORTER_H
+#define MESH_IMPORTER_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "ThreadPool.h"
+#include "VertexLayout.h"
+
+// Triangle list ready to be handed to Mesh or MeshFile::Write
+struct ImportedMesh
+{
+    std::string name;
+    std::vector<Vertex> vertices;
+    std::vector<uint32_t> indices;
+};
+
+// Loads Wavefront OBJ and glTF 2.0 (.gltf with embedded or external buffers, and .glb) files.
+//
+// All files of an import are processed together in a few fork/join phases on the thread pool, so the work is
+// spread over the threads whether it comes from many small files or a few large ones: OBJ files are split into
+// chunks at line boundaries that are parsed independently, and glTF accessors are decoded in blocks of vertices.
+class MeshImporter
+{
+public:
+    // Text is split into chunks of about this size, large enough that the per-chunk overhead is negligible
+    static constexpr size_t OBJ_CHUNK_SIZE = 1024 * 1024;
+
+    // glTF accessors are decoded in blocks of this many elements
+    static constexpr uint32_t GLTF_BLOCK_SIZE = 64 * 1024;
+
+    explicit MeshImporter(ThreadPool& threadPool);
+
+    // Returns the meshes in the order of the files. An OBJ file becomes one mesh, a glTF file one mesh per
+    // triangle primitive. The format is chosen by extension. Throws on the first file that fails to load
+    std::vector<ImportedMesh> Import(const std::vector<std::string>& paths);
+
+private:
+    ThreadPool& threadPool_;
+};
+#endif // MESH_IMPORTER_H
@@ -0,0 +1,382 @@
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <string_view>
+#include <unordered_map>
+
+// Cache modelled while scoring triangles in OptimizeVertexCache, see Forsyth's paper for the constants
+static const int SCORING_CACHE_SIZE = 32;
+static const float CACHE_DECAY_POWER = 1.5f;
+static const float LAST_TRIANGLE_SCORE = 0.75f;
+static const float VALENCE_BOOST_SCALE = 2.0f;
+static const float VALENCE_BOOST_POWER = 0.5f;
+
+static float ScoreVertex(int cachePosition, uint32_t remainingTriangles)
+{
+    // Vertices no triangle needs any more are worthless
+    if (remainingTriangles == 0)
+    {
+        return -1.0f;
+    }
+
+    float score = 0.0f;
+    if (cachePosition >= 0)
+    {
+        // The three most recent vertices belong to the last triangle, which gives them a fixed score so that
+        // the next triangle does not simply reuse the same edge over and over
+        if (cachePosition < 3)
+        {
+            score = LAST_TRIANGLE_SCORE;
+        }
+        else
+        {
+            float scaler = 1.0f / (SCORING_CACHE_SIZE - 3);
+            score = std::pow(1.0f - (cachePosition - 3) * scaler, CACHE_DECAY_POWER);
+        }
+    }
+
+    // Favour vertices with few triangles left, finishing them off frees their cache slot for good
+    score += VALENCE_BOOST_SCALE * std::pow((float)remainingTriangles, -VALENCE_BOOST_POWER);
+    return score;
+}
+
+MeshOptimizationReport MeshOptimizer::Optimize(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+{
+    MeshOptimizationReport report;
+    report.vertexCountBefore = (uint32_t)vertices.size();
+    report.before = AnalyzeVertexCache(indices, (uint32_t)vertices.size());
+
+    RemoveDuplicateVertices(vertices, indices);
+    OptimizeVertexCache(indices, (uint32_t)vertices.size());
+    OptimizeOverdraw(indices, vertices);
+    OptimizeVertexFetch(vertices, indices);
+
+    report.vertexCountAfter = (uint32_t)vertices.size();
+    report.after = AnalyzeVertexCache(indices, (uint32_t)vertices.size());
+    return report;
+}
+
+void MeshOptimizer::RemoveDuplicateVertices(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+{
+    // Vertex has no padding, so its bytes identify it
+    std::unordered_map<std::string_view, uint32_t> uniqueVertices;
+    uniqueVertices.reserve(vertices.size());
+
+    std::vector<uint32_t> remap(vertices.size());
+    std::vector<Vertex> uniques;
+    uniques.reserve(vertices.size());
+
+    for (size_t i = 0; i < vertices.size(); ++i)
+    {
+        std::string_view key(reinterpret_cast<const char*>(&vertices[i]), sizeof(Vertex));
+        auto inserted = uniqueVertices.emplace(key, (uint32_t)uniques.size());
+        if (inserted.second)
+        {
+            uniques.push_back(vertices[i]);
+        }
+        remap[i] = inserted.first->second;
+    }
+
+    if (uniques.size() == vertices.size())
+    {
+        return;
+    }
+
+    for (uint32_t& index : indices)
+    {
+        index = remap[index];
+    }
+
+    // The keys point into the original vertices, they are not used past this point
+    vertices = std::move(uniques);
+}
+
+void MeshOptimizer::OptimizeVertexCache(std::vector<uint32_t>& indices, uint32_t vertexCount)
+{
+    size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0)
+    {
+        return;
+    }
+
+    // Triangles using each vertex, packed into one array with an offset per vertex
+    std::vector<uint32_t> remainingTriangles(vertexCount, 0);
+    for (uint32_t index : indices)
+    {
+        ++remainingTriangles[index];
+    }
+
+    std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+    for (uint32_t vertex = 0; vertex < vertexCount; ++vertex)
+    {
+        adjacencyOffsets[vertex + 1] = adjacencyOffsets[vertex] + remainingTriangles[vertex];
+    }
+
+    std::vector<uint32_t> adjacency(indices.size());
+    std::vector<uint32_t> adjacencyFill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+    for (size_t triangle = 0; triangle < triangleCount; ++triangle)
+    {
+        for (size_t corner = 0; corner < 3; ++corner)
+        {
+            adjacency[adjacencyFill[indices[triangle * 3 + corner]]++] = (uint32_t)triangle;
+        }
+    }
+
+    std::vector<int> cachePosition(vertexCount, -1);
+    std::vector<float> vertexScore(vertexCount);
+    for (uint32_t vertex = 0; vertex < vertexCount; ++vertex)
+    {
+        vertexScore[vertex] = ScoreVertex(-1, remainingTriangles[vertex]);
+    }
+
+    std::vector<float> triangleScore(triangleCount);
+    std::vector<bool> emitted(triangleCount, false);
+    for (size_t triangle = 0; triangle < triangleCount; ++triangle)
+    {
+        triangleScore[triangle] = vertexScore[indices[triangle * 3]] + vertexScore[indices[triangle * 3 + 1]]
+            + vertexScore[indices[triangle * 3 + 2]];
+    }
+
+    std::vector<uint32_t> optimized;
+    optimized.reserve(indices.size());
+
+    // Most recently used vertex first. Holds three extra entries while a triangle is being pushed in
+    std::vector<uint32_t> cache;
+    cache.reserve(SCORING_CACHE_SIZE + 3);
+
+    size_t nextUnemitted = 0;
+    size_t bestTriangle = 0;
+    float bestScore = -1.0f;
+    for (size_t triangle = 0; triangle < triangleCount; ++triangle)
+    {
+        if (triangleScore[triangle] > bestScore)
+        {
+            bestScore = triangleScore[triangle];
+            bestTriangle = triangle;
+        }
+    }
+
+    for (size_t emittedCount = 0; emittedCount < triangleCount; ++emittedCount)
+    {
+        emitted[bestTriangle] = true;
+
+        const uint32_t* corners = &indices[bestTriangle * 3];
+        for (size_t corner = 0; corner < 3; ++corner)
+        {
+            uint32_t vertex = corners[corner];
+            optimized.push_back(vertex);
+
+            // Remove the triangle from the vertex's list of remaining triangles
+            uint32_t* first = &adjacency[adjacencyOffsets[vertex]];
+            uint32_t* last = first + remainingTriangles[vertex];
+            *std::find(first, last, (uint32_t)bestTriangle) = *(last - 1);
+            --remainingTriangles[vertex];
+
+            auto cached = std::find(cache.begin(), cache.end(), vertex);
+            if (cached != cache.end())
+            {
+                cache.erase(cached);
+            }
+        }
+        for (size_t corner = 3; corner-- > 0;)
+        {
+            // Degenerate triangles repeat a vertex, it only takes one cache entry
+            if (std::find(cache.begin(), cache.end(), corners[corner]) == cache.end())
+            {
+                cache.insert(cache.begin(), corners[corner]);
+            }
+        }
+
+        // Vertices pushed out of the cache lose their position score
+        for (size_t i = SCORING_CACHE_SIZE; i < cache.size(); ++i)
+        {
+            cachePosition[cache[i]] = -1;
+            vertexScore[cache[i]] = ScoreVertex(-1, remainingTriangles[cache[i]]);
+        }
+        if (cache.size() > (size_t)SCORING_CACHE_SIZE)
+        {
+            cache.resize(SCORING_CACHE_SIZE);
+        }
+
+        for (size_t i = 0; i < cache.size(); ++i)
+        {
+            cachePosition[cache[i]] = (int)i;
+            vertexScore[cache[i]] = ScoreVertex((int)i, remainingTriangles[cache[i]]);
+        }
+
+        // Only triangles touching the cache changed score, the best of them is emitted next
+        bestScore = -1.0f;
+        for (uint32_t vertex : cache)
+        {
+            for (uint32_t i = 0; i < remainingTriangles[vertex]; ++i)
+            {
+                uint32_t triangle = adjacency[adjacencyOffsets[vertex] + i];
+                float score = vertexScore[indices[triangle * 3]] + vertexScore[indices[triangle * 3 + 1]]
+                    + vertexScore[indices[triangle * 3 + 2]];
+                triangleScore[triangle] = score;
+
+                if (score > bestScore)
+                {
+                    bestScore = score;
+                    bestTriangle = triangle;
+                }
+            }
+        }
+
+        // Nothing in the cache has triangles left, continue with the next triangle in the original order
+        if (bestScore < 0.0f)
+        {
+            while (nextUnemitted < triangleCount && emitted[nextUnemitted])
+            {
+                ++nextUnemitted;
+            }
+            bestTriangle = nextUnemitted;
+        }
+    }
+
+    indices = std::move(optimized);
+}
+
+void MeshOptimizer::OptimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<Vertex>& vertices)
+{
+    size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0)
+    {
+        return;
+    }
+
+    // A triangle that misses the cache on all three vertices starts a new cluster. Reordering whole clusters
+    // only pays for those restarts, which the cache pays for anyway
+    std::vector<uint32_t> clusterStarts;
+    std::vector<uint32_t> cacheTimestamps(vertices.size(), 0);
+    uint32_t timestamp = ANALYSIS_CACHE_SIZE + 1;
+
+    for (size_t triangle = 0; triangle < triangleCount; ++triangle)
+    {
+        uint32_t misses = 0;
+        for (size_t corner = 0; corner < 3; ++corner)
+        {
+            uint32_t vertex = indices[triangle * 3 + corner];
+            if (timestamp - cacheTimestamps[vertex] > ANALYSIS_CACHE_SIZE)
+            {
+                cacheTimestamps[vertex] = timestamp++;
+                ++misses;
+            }
+        }
+
+        if (misses == 3)
+        {
+            clusterStarts.push_back((uint32_t)triangle);
+        }
+    }
+    clusterStarts.push_back((uint32_t)triangleCount);
+
+    glm::vec3 meshCentroid(0.0f);
+    for (const Vertex& vertex : vertices)
+    {
+        meshCentroid += vertex.pos;
+    }
+    meshCentroid /= (float)std::max<size_t>(vertices.size(), 1);
+
+    // Clusters whose area weighted normal points away from the mesh's centre are likely to be in front
+    struct Cluster
+    {
+        uint32_t firstTriangle;
+        uint32_t triangleCount;
+        float sortKey;
+    };
+
+    std::vector<Cluster> clusters;
+    for (size_t i = 0; i + 1 < clusterStarts.size(); ++i)
+    {
+        Cluster cluster{ clusterStarts[i], clusterStarts[i + 1] - clusterStarts[i], 0.0f };
+
+        glm::vec3 centroid(0.0f);
+        glm::vec3 normal(0.0f);
+        float area = 0.0f;
+        for (uint32_t triangle = cluster.firstTriangle; triangle < cluster.firstTriangle + cluster.triangleCount;
+            ++triangle)
+        {
+            const glm::vec3& a = vertices[indices[triangle * 3]].pos;
+            const glm::vec3& b = vertices[indices[triangle * 3 + 1]].pos;
+            const glm::vec3& c = vertices[indices[triangle * 3 + 2]].pos;
+
+            glm::vec3 triangleNormal = glm::cross(b - a, c - a);
+            float triangleArea = glm::length(triangleNormal);
+            centroid += (a + b + c) * (triangleArea / 3.0f);
+            normal += triangleNormal;
+            area += triangleArea;
+        }
+
+        float normalLength = glm::length(normal);
+        if (area > 0.0f && normalLength > 0.0f)
+        {
+            centroid /= area;
+            cluster.sortKey = glm::dot(centroid - meshCentroid, normal / normalLength);
+        }
+        clusters.push_back(cluster);
+    }
+
+    // Stable, so clusters facing the same way keep their cache friendly order
+    std::stable_sort(clusters.begin(), clusters.end(), [](const Cluster& a, const Cluster& b)
+    {
+        return a.sortKey > b.sortKey;
+    });
+
+    std::vector<uint32_t> sorted;
+    sorted.reserve(indices.size());
+    for (const Cluster& cluster : clusters)
+    {
+        auto first = indices.begin() + (size_t)cluster.firstTriangle * 3;
+        sorted.insert(sorted.end(), first, first + (size_t)cluster.triangleCount * 3);
+    }
+
+    indices = std::move(sorted);
+}
+
+void MeshOptimizer::OptimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+{
+    const uint32_t unassigned = ~0U;
+    std::vector<uint32_t> remap(vertices.size(), unassigned);
+
+    std::vector<Vertex> reordered;
+    reordered.reserve(vertices.size());
+
+    for (uint32_t& index : indices)
+    {
+        if (remap[index] == unassigned)
+        {
+            remap[index] = (uint32_t)reordered.size();
+            reordered.push_back(vertices[index]);
+        }
+        index = remap[index];
+    }
+
+    vertices = std::move(reordered);
+}
+
+VertexCacheStatistics MeshOptimizer::AnalyzeVertexCache(const std::vector<uint32_t>& indices, uint32_t vertexCount,
+    uint32_t cacheSize)
+{
+    VertexCacheStatistics statistics;
+
+    // A vertex is in the FIFO while fewer than cacheSize vertices have been transformed since it was
+    std::vector<uint32_t> cacheTimestamps(vertexCount, 0);
+    uint32_t timestamp = cacheSize + 1;
+
+    for (uint32_t index : indices)
+    {
+        if (timestamp - cacheTimestamps[index] > cacheSize)
+        {
+            cacheTimestamps[index] = timestamp++;
+            ++statistics.transformedVertices;
+        }
+    }
+
+    size_t triangleCount = indices.size() / 3;
+    statistics.acmr = triangleCount > 0 ? (float)statistics.transformedVertices / triangleCount : 0.0f;
+    statistics.atvr = vertexCount > 0 ? (float)statistics.transformedVertices / vertexCount : 0.0f;
+    return statistics;
+}
@@ -0,0 +1,58 @@
+#pragma once
+#ifndef MESH_OPTIMIZER_H
+#define MESH_OPTIMIZER_H
+
+#include <cstdint>
+#include <vector>
+
+#include "VertexLayout.h"
+
+// Post-transform vertex cache efficiency of an index buffer, simulated with a FIFO cache
+struct VertexCacheStatistics
+{
+    uint32_t transformedVertices = 0;
+
+    // Average cache miss ratio, vertices transformed per triangle. 0.5 is ideal for a regular grid, 3 the worst
+    float acmr = 0.0f;
+
+    // Average transform to vertex ratio, vertices transformed per unique vertex. 1 is ideal
+    float atvr = 0.0f;
+};
+
+struct MeshOptimizationReport
+{
+    uint32_t vertexCountBefore = 0;
+    uint32_t vertexCountAfter = 0;
+
+    VertexCacheStatistics before;
+    VertexCacheStatistics after;
+};
+
+// CPU stages that reorder triangle lists before upload so that the GPU shades and fetches fewer vertices.
+// Every stage keeps the mesh's triangles and their winding, only their order and the vertex numbering change.
+class MeshOptimizer
+{
+public:
+    // Size of the FIFO cache the statistics are measured against, a conservative match for current GPUs
+    static constexpr uint32_t ANALYSIS_CACHE_SIZE = 16;
+
+    // Runs every stage below in order and measures the index buffer before and after
+    static MeshOptimizationReport Optimize(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices);
+
+    // Merges vertices whose attributes are bitwise identical
+    static void RemoveDuplicateVertices(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices);
+
+    // Reorders triangles for post-transform cache locality (Forsyth, "Linear-Speed Vertex Cache Optimisation")
+    static void OptimizeVertexCache(std::vector<uint32_t>& indices, uint32_t vertexCount);
+
+    // Splits the cache optimised order into clusters at cache restarts and draws outward facing clusters first,
+    // so that occluders tend to be drawn ahead of what they occlude. Run after OptimizeVertexCache
+    static void OptimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<Vertex>& vertices);
+
+    // Renumbers vertices in the order the index buffer first references them and drops unreferenced ones
+    static void OptimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices);
+
+    static VertexCacheStatistics AnalyzeVertexCache(const std::vector<uint32_t>& indices, uint32_t vertexCount,
+        uint32_t cacheSize = ANALYSIS_CACHE_SIZE);
+};
+#endif // MESH_OPTIMIZER_H
@@ -0,0 +1,458 @@
+#include "MeshSimplifier.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+
+// Border planes outweigh surface planes so that open edges keep their outline
+static const float BORDER_WEIGHT = 10.0f;
+
+// Gives up on meshes that stop shrinking long before reaching their target
+static const uint32_t MAX_PASSES = 64;
+
+// A collapse is rejected when it turns a triangle by more than roughly 75 degrees
+static const float FLIP_THRESHOLD = 0.25f;
+
+// A level that keeps more than this share of the previous one's triangles ends the chain
+static const float MIN_LOD_PROGRESS = 0.9f;
+
+static const uint32_t NO_VERTEX = ~0u;
+
+// Sum of squared distances to a set of planes, weighted by area. Divided by the accumulated weight when
+// evaluated, which turns it into a mean squared distance
+struct Quadric
+{
+    float a00 = 0.0f, a11 = 0.0f, a22 = 0.0f;
+    float a01 = 0.0f, a02 = 0.0f, a12 = 0.0f;
+    float b0 = 0.0f, b1 = 0.0f, b2 = 0.0f;
+    float c = 0.0f;
+    float weight = 0.0f;
+};
+
+enum class VertexKind : uint8_t
+{
+    // Surrounded by triangles, may collapse into any neighbour
+    Manifold,
+
+    // On exactly one open border, may only collapse along it
+    Border,
+
+    // Shares its position with other vertices, or sits where several borders meet
+    Locked
+};
+
+struct Collapse
+{
+    uint32_t from;
+    uint32_t to;
+    float error;
+};
+
+static void AddPlane(Quadric& quadric, const glm::vec3& normal, float distance, float weight)
+{
+    quadric.a00 += weight * normal.x * normal.x;
+    quadric.a11 += weight * normal.y * normal.y;
+    quadric.a22 += weight * normal.z * normal.z;
+    quadric.a01 += weight * normal.x * normal.y;
+    quadric.a02 += weight * normal.x * normal.z;
+    quadric.a12 += weight * normal.y * normal.z;
+    quadric.b0 += weight * normal.x * distance;
+    quadric.b1 += weight * normal.y * distance;
+    quadric.b2 += weight * normal.z * distance;
+    quadric.c += weight * distance * distance;
+    quadric.weight += weight;
+}
+
+static void AddQuadric(Quadric& quadric, const Quadric& other)
+{
+    quadric.a00 += other.a00;
+    quadric.a11 += other.a11;
+    quadric.a22 += other.a22;
+    quadric.a01 += other.a01;
+    quadric.a02 += other.a02;
+    quadric.a12 += other.a12;
+    quadric.b0 += other.b0;
+    quadric.b1 += other.b1;
+    quadric.b2 += other.b2;
+    quadric.c += other.c;
+    quadric.weight += other.weight;
+}
+
+// Mean squared distance of the point to the quadric's planes
+static float EvaluateQuadric(const Quadric& quadric, const glm::vec3& p)
+{
+    float error = quadric.a00 * p.x * p.x + quadric.a11 * p.y * p.y + quadric.a22 * p.z * p.z
+        + 2.0f * (quadric.a01 * p.x * p.y + quadric.a02 * p.x * p.z + quadric.a12 * p.y * p.z)
+        + 2.0f * (quadric.b0 * p.x + quadric.b1 * p.y + quadric.b2 * p.z) + quadric.c;
+    return quadric.weight > 0.0f ? std::fabs(error) / quadric.weight : 0.0f;
+}
+
+static uint64_t EdgeKey(uint32_t from, uint32_t to)
+{
+    return ((uint64_t)from << 32) | to;
+}
+
+// True when moving vertex from onto vertex to turns any triangle that survives the collapse inside out
+static bool FlipsTriangle(const std::vector<glm::vec3>& positions, const std::vector<uint32_t>& indices,
+    const std::vector<uint32_t>& adjacencyOffsets, const std::vector<uint32_t>& adjacency, uint32_t from, uint32_t to)
+{
+    for (uint32_t i = adjacencyOffsets[from]; i < adjacencyOffsets[from + 1]; ++i)
+    {
+        const uint32_t* triangle = &indices[adjacency[i] * 3];
+        if (triangle[0] == to || triangle[1] == to || triangle[2] == to)
+        {
+            continue;
+        }
+
+        // Rotate the triangle so that the moving vertex comes first, the winding stays the same
+        uint32_t corner = triangle[0] == from ? 0 : triangle[1] == from ? 1 : 2;
+        const glm::vec3& b = positions[triangle[(corner + 1) % 3]];
+        const glm::vec3& c = positions[triangle[(corner + 2) % 3]];
+
+        glm::vec3 normalBefore = glm::cross(b - positions[from], c - positions[from]);
+        glm::vec3 normalAfter = glm::cross(b - positions[to], c - positions[to]);
+        if (glm::dot(normalBefore, normalAfter) <= FLIP_THRESHOLD * glm::length(normalBefore)
+            * glm::length(normalAfter))
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+float MeshSimplifier::Simplify(const std::vector<Vertex>& vertices, std::vector<uint32_t>& indices,
+    uint32_t targetIndexCount, float maxError)
+{
+    uint32_t vertexCount = (uint32_t)vertices.size();
+    if (indices.size() <= targetIndexCount || vertexCount == 0)
+    {
+        return 0.0f;
+    }
+
+    // Errors are measured in a unit box, which keeps the quadrics well conditioned for any mesh scale
+    glm::vec3 boundsMin(std::numeric_limits<float>::max());
+    glm::vec3 boundsMax(std::numeric_limits<float>::lowest());
+    for (const Vertex& vertex : vertices)
+    {
+        boundsMin = glm::min(boundsMin, vertex.pos);
+        boundsMax = glm::max(boundsMax, vertex.pos);
+    }
+    glm::vec3 size = boundsMax - boundsMin;
+    float extent = std::max(std::max(size.x, size.y), std::max(size.z, std::numeric_limits<float>::min()));
+
+    std::vector<glm::vec3> positions(vertexCount);
+    for (uint32_t i = 0; i < vertexCount; ++i)
+    {
+        positions[i] = (vertices[i].pos - boundsMin) / extent;
+    }
+
+    // Vertices that only differ in their attributes form a seam. Topology is worked out on the first vertex
+    // of each position so that a seam does not look like an open border
+    std::unordered_map<std::string_view, uint32_t> uniquePositions;
+    uniquePositions.reserve(vertexCount);
+    std::vector<uint32_t> positionIds(vertexCount);
+    std::vector<uint32_t> verticesPerPosition(vertexCount, 0);
+    for (uint32_t i = 0; i < vertexCount; ++i)
+    {
+        std::string_view key(reinterpret_cast<const char*>(&vertices[i].pos), sizeof(glm::vec3));
+        positionIds[i] = uniquePositions.emplace(key, i).first->second;
+        ++verticesPerPosition[positionIds[i]];
+    }
+
+    std::unordered_set<uint64_t> halfEdges;
+    halfEdges.reserve(indices.size());
+    for (size_t i = 0; i < indices.size(); i += 3)
+    {
+        for (uint32_t corner = 0; corner < 3; ++corner)
+        {
+            halfEdges.insert(EdgeKey(positionIds[indices[i + corner]], positionIds[indices[i + (corner + 1) % 3]]));
+        }
+    }
+
+    // A half edge without a twin is on an open border. Border neighbours are tracked per position
+    std::vector<uint32_t> borderNext(vertexCount, NO_VERTEX);
+    std::vector<uint32_t> borderPrevious(vertexCount, NO_VERTEX);
+    std::vector<uint8_t> openOut(vertexCount, 0);
+    std::vector<uint8_t> openIn(vertexCount, 0);
+    for (size_t i = 0; i < indices.size(); i += 3)
+    {
+        for (uint32_t corner = 0; corner < 3; ++corner)
+        {
+            uint32_t from = positionIds[indices[i + corner]];
+            uint32_t to = positionIds[indices[i + (corner + 1) % 3]];
+            if (halfEdges.count(EdgeKey(to, from)) == 0)
+            {
+                borderNext[from] = to;
+                borderPrevious[to] = from;
+                openOut[from] = (uint8_t)std::min(openOut[from] + 1, 255);
+                openIn[to] = (uint8_t)std::min(openIn[to] + 1, 255);
+            }
+        }
+    }
+
+    std::vector<VertexKind> kinds(vertexCount, VertexKind::Manifold);
+    for (uint32_t i = 0; i < vertexCount; ++i)
+    {
+        uint32_t positionId = positionIds[i];
+        if (verticesPerPosition[positionId] > 1)
+        {
+            kinds[i] = VertexKind::Locked;
+        }
+        else if (openOut[positionId] == 1 && openIn[positionId] == 1)
+        {
+            kinds[i] = VertexKind::Border;
+        }
+        else if (openOut[positionId] != 0 || openIn[positionId] != 0)
+        {
+            kinds[i] = VertexKind::Locked;
+        }
+    }
+
+    // Every vertex starts with the planes of the triangles around it, border vertices also with planes
+    // standing upright on their border edges
+    std::vector<Quadric> quadrics(vertexCount);
+    for (size_t i = 0; i < indices.size(); i += 3)
+    {
+        const glm::vec3& p0 = positions[indices[i]];
+        glm::vec3 normal = glm::cross(positions[indices[i + 1]] - p0, positions[indices[i + 2]] - p0);
+        float length = glm::length(normal);
+        if (length == 0.0f)
+        {
+            continue;
+        }
+        normal /= length;
+
+        for (uint32_t corner = 0; corner < 3; ++corner)
+        {
+            uint32_t vertex = indices[i + corner];
+            AddPlane(quadrics[vertex], normal, -glm::dot(normal, p0), length * 0.5f);
+        }
+
+        for (uint32_t corner = 0; corner < 3; ++corner)
+        {
+            uint32_t from = indices[i + corner];
+            uint32_t to = indices[i + (corner + 1) % 3];
+            if (halfEdges.count(EdgeKey(positionIds[to], positionIds[from])) != 0)
+            {
+                continue;
+            }
+
+            glm::vec3 edge = positions[to] - positions[from];
+            float edgeLength = glm::length(edge);
+            if (edgeLength == 0.0f)
+            {
+                continue;
+            }
+
+            glm::vec3 borderNormal = glm::normalize(glm::cross(edge, normal));
+            float borderDistance = -glm::dot(borderNormal, positions[from]);
+            AddPlane(quadrics[from], borderNormal, borderDistance, edgeLength * edgeLength * BORDER_WEIGHT);
+            AddPlane(quadrics[to], borderNormal, borderDistance, edgeLength * edgeLength * BORDER_WEIGHT);
+        }
+    }
+
+    float maxErrorSquared = (maxError / extent) * (maxError / extent);
+    float resultErrorSquared = 0.0f;
+
+    std::vector<uint32_t> remap(vertexCount);
+    std::vector<uint8_t> touched(vertexCount);
+    std::vector<uint32_t> adjacencyOffsets(vertexCount + 1);
+    std::vector<uint32_t> adjacency;
+    std::vector<Collapse> collapses;
+
+    for (uint32_t pass = 0; pass < MAX_PASSES && indices.size() > targetIndexCount; ++pass)
+    {
+        uint32_t triangleCount = (uint32_t)(indices.size() / 3);
+
+        // Triangles around each vertex, for the flip test and to find the vertices a collapse disturbs
+        std::fill(adjacencyOffsets.begin(), adjacencyOffsets.end(), 0);
+        for (uint32_t index : indices)
+        {
+            ++adjacencyOffsets[index + 1];
+        }
+        for (uint32_t i = 0; i < vertexCount; ++i)
+        {
+            adjacencyOffsets[i + 1] += adjacencyOffsets[i];
+        }
+        adjacency.resize(indices.size());
+        std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+        for (uint32_t i = 0; i < (uint32_t)indices.size(); ++i)
+        {
+            adjacency[fill[indices[i]]++] = i / 3;
+        }
+
+        // The cheaper allowed direction of every edge. Edges shared by two triangles show up twice, the
+        // second one is skipped once either end has moved
+        collapses.clear();
+        for (size_t i = 0; i < indices.size(); i += 3)
+        {
+            for (uint32_t corner = 0; corner < 3; ++corner)
+            {
+                uint32_t a = indices[i + corner];
+                uint32_t b = indices[i + (corner + 1) % 3];
+
+                Collapse best{ NO_VERTEX, NO_VERTEX, std::numeric_limits<float>::max() };
+                for (uint32_t direction = 0; direction < 2; ++direction)
+                {
+                    uint32_t from = direction == 0 ? a : b;
+                    uint32_t to = direction == 0 ? b : a;
+
+                    bool allowed = kinds[from] == VertexKind::Manifold || (kinds[from] == VertexKind::Border
+                        && (borderNext[from] == positionIds[to] || borderPrevious[from] == positionIds[to]));
+                    if (!allowed)
+                    {
+                        continue;
+                    }
+
+                    float error = EvaluateQuadric(quadrics[from], positions[to]);
+                    if (error < best.error)
+                    {
+                        best = { from, to, error };
+                    }
+                }
+
+                if (best.from != NO_VERTEX)
+                {
+                    collapses.push_back(best);
+                }
+            }
+        }
+
+        std::sort(collapses.begin(), collapses.end(),
+            [](const Collapse& lhs, const Collapse& rhs) { return lhs.error < rhs.error; });
+
+        for (uint32_t i = 0; i < vertexCount; ++i)
+        {
+            remap[i] = i;
+        }
+        std::fill(touched.begin(), touched.end(), 0);
+
+        // Collapses in one pass must not share triangles, otherwise the flip test of one would be made with
+        // positions another one has already moved
+        uint32_t trianglesToRemove = triangleCount - targetIndexCount / 3;
+        uint32_t trianglesRemoved = 0;
+        uint32_t collapsesApplied = 0;
+        for (const Collapse& collapse : collapses)
+        {
+            if (collapse.error > maxErrorSquared || trianglesRemoved >= trianglesToRemove)
+            {
+                break;
+            }
+            if (touched[collapse.from] || touched[collapse.to] ||
+                FlipsTriangle(positions, indices, adjacencyOffsets, adjacency, collapse.from, collapse.to))
+            {
+                continue;
+            }
+
+            remap[collapse.from] = collapse.to;
+            AddQuadric(quadrics[collapse.to], quadrics[collapse.from]);
+            resultErrorSquared = std::max(resultErrorSquared, collapse.error);
+            ++collapsesApplied;
+
+            for (uint32_t j = adjacencyOffsets[collapse.from]; j < adjacencyOffsets[collapse.from + 1]; ++j)
+            {
+                const uint32_t* triangle = &indices[adjacency[j] * 3];
+                touched[triangle[0]] = touched[triangle[1]] = touched[triangle[2]] = 1;
+            }
+
+            // The border now runs straight from the collapsed vertex's neighbour to the target
+            if (kinds[collapse.from] == VertexKind::Border)
+            {
+                uint32_t to = positionIds[collapse.to];
+                uint32_t next = borderNext[collapse.from];
+                uint32_t previous = borderPrevious[collapse.from];
+                if (next == to)
+                {
+                    borderPrevious[to] = previous;
+                    borderNext[previous] = to;
+                }
+                else
+                {
+                    borderNext[to] = next;
+                    borderPrevious[next] = to;
+                }
+                trianglesRemoved += 1;
+            }
+            else
+            {
+                trianglesRemoved += 2;
+            }
+        }
+
+        if (collapsesApplied == 0)
+        {
+            break;
+        }
+
+        // Triangles that lost a corner to the collapses are gone, the rest keep their order
+        size_t writeIndex = 0;
+        for (size_t i = 0; i < indices.size(); i += 3)
+        {
+            uint32_t a = remap[indices[i]];
+            uint32_t b = remap[indices[i + 1]];
+            uint32_t c = remap[indices[i + 2]];
+            if (a != b && b != c && a != c)
+            {
+                indices[writeIndex++] = a;
+                indices[writeIndex++] = b;
+                indices[writeIndex++] = c;
+            }
+        }
+        indices.resize(writeIndex);
+    }
+
+    return std::sqrt(resultErrorSquared) * extent;
+}
+
+std::vector<MeshLod> MeshSimplifier::GenerateLods(const std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+{
+    std::vector<MeshLod> lods;
+    lods.push_back({ 0, (uint32_t)indices.size(), 0.0f });
+
+    glm::vec3 boundsMin(std::numeric_limits<float>::max());
+    glm::vec3 boundsMax(std::numeric_limits<float>::lowest());
+    for (const Vertex& vertex : vertices)
+    {
+        boundsMin = glm::min(boundsMin, vertex.pos);
+        boundsMax = glm::max(boundsMax, vertex.pos);
+    }
+    glm::vec3 size = boundsMax - boundsMin;
+    float maxError = std::max(std::max(size.x, size.y), size.z) * MAX_LOD_ERROR;
+    if (vertices.empty() || maxError <= 0.0f)
+    {
+        return lods;
+    }
+
+    // Each level starts from the previous one, which is cheaper and keeps the levels nested
+    std::vector<uint32_t> lodIndices = indices;
+    while (lods.size() < MAX_LODS)
+    {
+        uint32_t previousCount = (uint32_t)lodIndices.size();
+        uint32_t targetCount = (uint32_t)(previousCount / 3 * LOD_REDUCTION) * 3;
+        if (targetCount < MIN_LOD_TRIANGLES * 3)
+        {
+            break;
+        }
+
+        float error = Simplify(vertices, lodIndices, targetCount, maxError);
+        if (lodIndices.size() > previousCount * MIN_LOD_PROGRESS)
+        {
+            break;
+        }
+
+        // The distance to the full detail surface is at most the sum of the distances between levels
+        MeshLod lod;
+        lod.firstIndex = (uint32_t)indices.size();
+        lod.indexCount = (uint32_t)lodIndices.size();
+        lod.error = lods.back().error + error;
+        lods.push_back(lod);
+
+        indices.insert(indices.end(), lodIndices.begin(), lodIndices.end());
+    }
+
+    return lods;
+}
@@ -0,0 +1,49 @@
+#pragma once
+#ifndef MESH_SIMPLIFIER_H
+#define MESH_SIMPLIFIER_H
+
+#include <cstdint>
+#include <vector>
+
+#include "VertexLayout.h"
+
+// One level of detail of a mesh, a range of the mesh's index buffer drawn against the mesh's vertices
+struct MeshLod
+{
+    // Relative to the mesh's first index
+    uint32_t firstIndex = 0;
+    uint32_t indexCount = 0;
+
+    // How far the level's surface may lie from the full detail surface, in model space units
+    float error = 0.0f;
+};
+
+// Reduces triangle lists by collapsing edges in the order of their quadric error (Garland and Heckbert,
+// "Surface Simplification Using Quadric Error Metrics"). Vertices are only ever merged into existing ones,
+// so every level keeps indexing the original vertex buffer
+class MeshSimplifier
+{
+public:
+    // Levels per mesh, including the full detail one
+    static constexpr uint32_t MAX_LODS = 8;
+
+    // Each level aims for this fraction of the previous level's triangles
+    static constexpr float LOD_REDUCTION = 0.4f;
+
+    // No level is generated below this many triangles
+    static constexpr uint32_t MIN_LOD_TRIANGLES = 8;
+
+    // Largest error a level may reach, relative to the largest dimension of the mesh's bounds
+    static constexpr float MAX_LOD_ERROR = 0.5f;
+
+    // Collapses edges until no more than targetIndexCount indices remain, or until the next collapse would
+    // move the surface further than maxError model space units. Open borders only shrink along themselves and
+    // vertices on attribute seams stay where they are. Returns the error reached
+    static float Simplify(const std::vector<Vertex>& vertices, std::vector<uint32_t>& indices,
+        uint32_t targetIndexCount, float maxError);
+
+    // Appends successively simplified copies of indices to it and returns the resulting chain, full detail
+    // first. Stops early once a level no longer removes a meaningful share of triangles
+    static std::vector<MeshLod> GenerateLods(const std::vector<Vertex>& vertices, std::vector<uint32_t>& indices);
+};
+#endif // MESH_SIMPLIFIER_H
@@ -0,0 +1,128 @@
+#include "PipelineCache.h"
+
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+
+PipelineCache::PipelineCache(VkPhysicalDevice physicalDevice, VkDevice device, const std::string& path)
+    : device_(device), path_(path)
+{
+    std::vector<char> data;
+
+    std::ifstream file(path_, std::ios::binary | std::ios::ate);
+    if (file.is_open())
+    {
+        data.resize((size_t)file.tellg());
+        file.seekg(0);
+        file.read(data.data(), data.size());
+    }
+
+    if (!data.empty() && !IsCompatible(physicalDevice, data))
+    {
+        printf("Discarding pipeline cache %s, it was created for another device or driver\n", path_.c_str());
+        data.clear();
+    }
+
+    VkPipelineCacheCreateInfo createInfo{};
+    createInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    createInfo.initialDataSize = data.size();
+    createInfo.pInitialData = data.empty() ? nullptr : data.data();
+
+    VkResult result = vkCreatePipelineCache(device_, &createInfo, nullptr, &cache_);
+    if (result != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create a Pipeline Cache!");
+    }
+
+    loaded_ = !data.empty();
+    persistedData_ = std::move(data);
+}
+
+PipelineCache::~PipelineCache()
+{
+    vkDestroyPipelineCache(device_, cache_, nullptr);
+}
+
+bool PipelineCache::IsCompatible(VkPhysicalDevice physicalDevice, const std::vector<char>& data)
+{
+    VkPipelineCacheHeaderVersionOne header;
+    if (data.size() < sizeof(header))
+    {
+        return false;
+    }
+    memcpy(&header, data.data(), sizeof(header));
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+
+    return header.headerSize >= sizeof(header) && header.headerSize <= data.size()
+        && header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE
+        && header.vendorID == properties.vendorID
+        && header.deviceID == properties.deviceID
+        && memcmp(header.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+}
+
+void PipelineCache::Save()
+{
+    // Saving is best effort, a failure only costs the next run a cold start
+    size_t size = 0;
+    VkResult result = vkGetPipelineCacheData(device_, cache_, &size, nullptr);
+    if (result != VK_SUCCESS)
+    {
+        printf("Failed to get pipeline cache data\n");
+        return;
+    }
+
+    std::vector<char> data(size);
+    result = vkGetPipelineCacheData(device_, cache_, &size, data.data());
+    if (result != VK_SUCCESS && result != VK_INCOMPLETE)
+    {
+        printf("Failed to get pipeline cache data\n");
+        return;
+    }
+    data.resize(size);
+
+    if (data.empty() || data == persistedData_)
+    {
+        return;
+    }
+
+    // Renaming over the old file is atomic, readers see either the old blob or the new one
+    std::string tempPath = path_ + ".tmp";
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        file.write(data.data(), data.size());
+        if (!file.good())
+        {
+            printf("Failed to write pipeline cache %s\n", tempPath.c_str());
+            return;
+        }
+    }
+
+    std::error_code error;
+    std::filesystem::rename(tempPath, path_, error);
+    if (error)
+    {
+        printf("Failed to replace pipeline cache %s: %s\n", path_.c_str(), error.message().c_str());
+        std::filesystem::remove(tempPath, error);
+        return;
+    }
+
+    persistedData_ = std::move(data);
+}
+
+void PipelineCache::ReportCreation(const char* name, double milliseconds,
+    const VkPipelineCreationFeedbackEXT* feedback)
+{
+    const char* outcome = "unknown";
+    if (feedback && (feedback->flags & VK_PIPELINE_CREATION_FEEDBACK_VALID_BIT_EXT))
+    {
+        outcome = (feedback->flags & VK_PIPELINE_CREATION_FEEDBACK_APPLICATION_PIPELINE_CACHE_HIT_BIT_EXT)
+            ? "hit" : "miss";
+    }
+
+    printf("Pipeline %s created in %.3f ms (cache %s, %s)\n", name, milliseconds, outcome,
+        loaded_ ? "warm" : "cold");
+}
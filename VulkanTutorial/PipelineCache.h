@@ -0,0 +1,44 @@
+#pragma once
+#ifndef PIPELINE_CACHE_H
+#define PIPELINE_CACHE_H
+
+#include <vulkan/vulkan.h>
+#include <string>
+#include <vector>
+
+// Wraps a VkPipelineCache that persists between runs. The blob on disk is only used when its header
+// matches the current device, since drivers may reject or misbehave on data from another GPU or driver.
+class PipelineCache
+{
+public:
+    PipelineCache(VkPhysicalDevice physicalDevice, VkDevice device, const std::string& path);
+    ~PipelineCache();
+
+    PipelineCache(const PipelineCache&) = delete;
+    PipelineCache& operator=(const PipelineCache&) = delete;
+
+    // Writes the cache back to disk through a temporary file, so a crash never leaves a truncated blob.
+    // Nothing is written when the contents have not changed since the last load or save. Failures are
+    // logged rather than thrown, since this also runs during shutdown
+    void Save();
+
+    // Logs how long a pipeline took to create and, when the driver reports it, whether the cache was hit
+    void ReportCreation(const char* name, double milliseconds, const VkPipelineCreationFeedbackEXT* feedback);
+
+    VkPipelineCache Get() const { return cache_; }
+
+    // True when a valid blob was found on disk at startup
+    bool WasLoaded() const { return loaded_; }
+
+private:
+    VkDevice device_;
+    VkPipelineCache cache_ = VK_NULL_HANDLE;
+    std::string path_;
+    bool loaded_ = false;
+
+    // Contents as they were last read from or written to disk
+    std::vector<char> persistedData_;
+
+    bool IsCompatible(VkPhysicalDevice physicalDevice, const std::vector<char>& data);
+};
+#endif // PIPELINE_CACHE_H
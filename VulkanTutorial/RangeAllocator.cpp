@@ -0,0 +1,100 @@
+#include "RangeAllocator.h"
+
+#include <stdexcept>
+
+RangeAllocator::RangeAllocator(VkDeviceSize size) : size_(size)
+{
+    freeRanges_[0] = size;
+}
+
+VkDeviceSize RangeAllocator::Allocate(VkDeviceSize size, VkDeviceSize alignment)
+{
+    if (size == 0)
+    {
+        return INVALID_OFFSET;
+    }
+
+    alignment = alignment > 0 ? alignment : 1;
+
+    // Best fit keeps the large free ranges intact for large requests
+    auto bestRange = freeRanges_.end();
+    VkDeviceSize bestWaste = INVALID_OFFSET;
+
+    for (auto range = freeRanges_.begin(); range != freeRanges_.end(); ++range)
+    {
+        VkDeviceSize alignedOffset = (range->first + alignment - 1) / alignment * alignment;
+        VkDeviceSize rangeEnd = range->first + range->second;
+
+        if (alignedOffset + size <= rangeEnd && range->second - size < bestWaste)
+        {
+            bestRange = range;
+            bestWaste = range->second - size;
+
+            if (bestWaste == 0)
+            {
+                break;
+            }
+        }
+    }
+
+    if (bestRange == freeRanges_.end())
+    {
+        return INVALID_OFFSET;
+    }
+
+    VkDeviceSize rangeOffset = bestRange->first;
+    VkDeviceSize rangeEnd = rangeOffset + bestRange->second;
+    VkDeviceSize alignedOffset = (rangeOffset + alignment - 1) / alignment * alignment;
+    freeRanges_.erase(bestRange);
+
+    // Padding in front of the aligned offset and the tail of the range both stay free
+    if (alignedOffset > rangeOffset)
+    {
+        freeRanges_[rangeOffset] = alignedOffset - rangeOffset;
+    }
+
+    if (alignedOffset + size < rangeEnd)
+    {
+        freeRanges_[alignedOffset + size] = rangeEnd - (alignedOffset + size);
+    }
+
+    used_ += size;
+    return alignedOffset;
+}
+
+void RangeAllocator::Free(VkDeviceSize offset, VkDeviceSize size)
+{
+    if (size == 0 || offset == INVALID_OFFSET)
+    {
+        return;
+    }
+
+    if (offset + size > size_ || size > used_)
+    {
+        throw std::runtime_error("Attempted to free a range that was not allocated!");
+    }
+
+    used_ -= size;
+
+    auto next = freeRanges_.lower_bound(offset);
+
+    // Merge with the following free range
+    if (next != freeRanges_.end() && next->first == offset + size)
+    {
+        size += next->second;
+        next = freeRanges_.erase(next);
+    }
+
+    // Merge with the preceding free range
+    if (next != freeRanges_.begin())
+    {
+        auto previous = std::prev(next);
+        if (previous->first + previous->second == offset)
+        {
+            previous->second += size;
+            return;
+        }
+    }
+
+    freeRanges_[offset] = size;
+}
@@ -0,0 +1,33 @@
+#pragma once
+#ifndef RANGE_ALLOCATOR_H
+#define RANGE_ALLOCATOR_H
+
+#include <vulkan/vulkan.h>
+#include <map>
+
+// Free-list sub-allocator for ranges inside a fixed size region. Freed ranges are merged with
+// their neighbours so that the region does not fragment as allocations come and go.
+class RangeAllocator
+{
+public:
+    static constexpr VkDeviceSize INVALID_OFFSET = ~0ULL;
+
+    RangeAllocator() = default;
+    RangeAllocator(VkDeviceSize size);
+
+    // Returns INVALID_OFFSET when no free range is large enough
+    VkDeviceSize Allocate(VkDeviceSize size, VkDeviceSize alignment);
+    void Free(VkDeviceSize offset, VkDeviceSize size);
+
+    VkDeviceSize GetSize() const { return size_; }
+    VkDeviceSize GetUsed() const { return used_; }
+    bool IsEmpty() const { return used_ == 0; }
+
+private:
+    VkDeviceSize size_ = 0;
+    VkDeviceSize used_ = 0;
+
+    // Free ranges keyed by their offset
+    std::map<VkDeviceSize, VkDeviceSize> freeRanges_;
+};
+#endif // RANGE_ALLOCATOR_H
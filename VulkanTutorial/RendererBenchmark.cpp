@@ -0,0 +1,417 @@
+#include "RendererBenchmark.h"
+#include "renderer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <stdio.h>
+
+namespace p3d
+{
+    // Buffer sizes measured by the buffer cases, from a small uniform block up to a large vertex buffer
+    static const VkDeviceSize BENCHMARK_BUFFER_SIZES[] = { 256, 64 * 1024, 1024 * 1024, 16 * 1024 * 1024 };
+
+    // Caps the memory a single repetition touches, so that large sizes still fit on software drivers
+    static const VkDeviceSize BENCHMARK_BYTES_PER_REPETITION = 64 * 1024 * 1024;
+
+    static const uint32_t BENCHMARK_MESH_VERTEX_COUNTS[] = { 4, 1024, 16 * 1024 };
+    static const uint32_t BENCHMARK_VERTICES_PER_REPETITION = 256 * 1024;
+
+    static const uint32_t BENCHMARK_UNIFORM_UPDATES = 100000;
+
+    static const uint32_t BENCHMARK_DESCRIPTOR_SETS = 1024;
+    static const uint32_t BENCHMARK_DESCRIPTOR_BATCH_SIZES[] = { 1, 64 };
+
+    // How many operations a repetition runs when each one handles unitSize of the budget
+    static uint32_t OperationCount(uint64_t unitSize, uint64_t budget, uint32_t minCount, uint32_t maxCount)
+    {
+        return (uint32_t)std::clamp<uint64_t>(budget / unitSize, minCount, maxCount);
+    }
+
+    static std::string Parameter(const char* name, uint64_t value)
+    {
+        return std::string(name) + "=" + std::to_string(value);
+    }
+
+    // A row of quads with the given number of vertices, four per quad
+    static void BuildQuadGrid(uint32_t vertexCount, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+    {
+        uint32_t quadCount = std::max(vertexCount / 4, 1U);
+        vertices.clear();
+        indices.clear();
+        vertices.reserve(quadCount * 4);
+        indices.reserve(quadCount * 6);
+
+        for (uint32_t i = 0; i < quadCount; ++i)
+        {
+            float x = (float)(i % 256);
+            float y = (float)(i / 256);
+            vertices.push_back({{ x, y, 0.0f }, { 1.0f, 0.0f, 0.0f }});
+            vertices.push_back({{ x + 1.0f, y, 0.0f }, { 0.0f, 1.0f, 0.0f }});
+            vertices.push_back({{ x + 1.0f, y + 1.0f, 0.0f }, { 0.0f, 0.0f, 1.0f }});
+            vertices.push_back({{ x, y + 1.0f, 0.0f }, { 1.0f, 1.0f, 0.0f }});
+
+            uint32_t first = i * 4;
+            indices.insert(indices.end(), { first, first + 1, first + 2, first + 2, first + 3, first });
+        }
+    }
+
+    // Throughput of the median sample, zero for cases that do not move data
+    static double BytesPerSecond(const BenchmarkResult& result)
+    {
+        return result.medianNs > 0.0 ? result.bytesPerOperation / (result.medianNs * 1e-9) : 0.0;
+    }
+
+    RendererBenchmark::RendererBenchmark(Renderer& renderer, const BenchmarkConfig& config) : renderer_(renderer),
+        config_(config)
+    {
+        if (config_.repetitions == 0)
+        {
+            throw std::runtime_error("Benchmarks need at least one repetition!");
+        }
+    }
+
+    std::vector<BenchmarkResult> RendererBenchmark::Run()
+    {
+        results_.clear();
+
+        // Nothing the renderer submitted may still be running while the cases use its queues
+        renderer_.WaitIdle();
+        renderer_.uploadManager_->WaitIdle();
+
+        BenchmarkCreateBuffer();
+        BenchmarkCopyBuffer();
+        BenchmarkMeshConstruction();
+        BenchmarkMeshFileLoad();
+        BenchmarkUpdateUniformBuffer();
+        BenchmarkDescriptorSetAllocation();
+
+        return results_;
+    }
+
+    void RendererBenchmark::WriteResults(const std::vector<BenchmarkResult>& results, const std::string& path)
+    {
+        std::ofstream file(path, std::ios::trunc);
+        if (!file.is_open())
+        {
+            throw std::runtime_error("Failed to open file: " + path);
+        }
+
+        bool json = path.size() >= 5 && path.compare(path.size() - 5, 5, ".json") == 0;
+        if (!json)
+        {
+            file << "name,parameters,repetitions,operations,mean_ns,median_ns,stddev_ns,min_ns,max_ns,bytes_per_second\n";
+        }
+
+        for (const BenchmarkResult& result : results)
+        {
+            if (json)
+            {
+                // Names and parameters are chosen by the benchmark and never need escaping
+                file << "{\"name\":\"" << result.name << "\",\"parameters\":\"" << result.parameters
+                    << "\",\"operations\":" << result.operationsPerRepetition << ",\"mean_ns\":" << result.meanNs
+                    << ",\"median_ns\":" << result.medianNs << ",\"stddev_ns\":" << result.stddevNs
+                    << ",\"min_ns\":" << result.minNs << ",\"max_ns\":" << result.maxNs
+                    << ",\"bytes_per_second\":" << BytesPerSecond(result) << ",\"samples_ns\":[";
+                for (size_t i = 0; i < result.samplesNs.size(); ++i)
+                {
+                    file << (i > 0 ? "," : "") << result.samplesNs[i];
+                }
+                file << "]}\n";
+            }
+            else
+            {
+                file << result.name << "," << result.parameters << "," << result.samplesNs.size() << ","
+                    << result.operationsPerRepetition << "," << result.meanNs << "," << result.medianNs << ","
+                    << result.stddevNs << "," << result.minNs << "," << result.maxNs << ","
+                    << BytesPerSecond(result) << "\n";
+            }
+        }
+    }
+
+    void RendererBenchmark::Measure(const std::string& name, const std::string& parameters, uint32_t operations,
+        uint64_t bytesPerOperation, const std::function<void()>& setup, const std::function<void()>& run,
+        const std::function<void()>& teardown)
+    {
+        if (!config_.filter.empty() && name.find(config_.filter) == std::string::npos)
+        {
+            return;
+        }
+
+        BenchmarkResult result;
+        result.name = name;
+        result.parameters = parameters;
+        result.operationsPerRepetition = operations;
+        result.bytesPerOperation = bytesPerOperation;
+
+        for (uint32_t i = 0; i < config_.warmupRepetitions + config_.repetitions; ++i)
+        {
+            if (setup)
+            {
+                setup();
+            }
+
+            auto start = std::chrono::steady_clock::now();
+            run();
+            auto end = std::chrono::steady_clock::now();
+
+            if (teardown)
+            {
+                teardown();
+            }
+
+            if (i >= config_.warmupRepetitions)
+            {
+                result.samplesNs.push_back(std::chrono::duration<double, std::nano>(end - start).count() / operations);
+            }
+        }
+
+        std::vector<double> sorted = result.samplesNs;
+        std::sort(sorted.begin(), sorted.end());
+        size_t count = sorted.size();
+
+        double sum = 0.0;
+        for (double sample : sorted)
+        {
+            sum += sample;
+        }
+        result.meanNs = sum / count;
+        result.medianNs = count % 2 == 1 ? sorted[count / 2] : (sorted[count / 2 - 1] + sorted[count / 2]) * 0.5;
+        result.minNs = sorted.front();
+        result.maxNs = sorted.back();
+
+        // Sample standard deviation, a single repetition has none
+        double squaredError = 0.0;
+        for (double sample : sorted)
+        {
+            squaredError += (sample - result.meanNs) * (sample - result.meanNs);
+        }
+        result.stddevNs = count > 1 ? std::sqrt(squaredError / (count - 1)) : 0.0;
+
+        printf("%-24s %-12s median %12.1f ns  mean %12.1f ns  stddev %10.1f ns\n", name.c_str(), parameters.c_str(),
+            result.medianNs, result.meanNs, result.stddevNs);
+
+        results_.push_back(std::move(result));
+    }
+
+    void RendererBenchmark::BenchmarkCreateBuffer()
+    {
+        MemoryAllocator& allocator = *renderer_.allocator_;
+        const VkBufferUsageFlags usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+
+        for (VkDeviceSize size : BENCHMARK_BUFFER_SIZES)
+        {
+            uint32_t count = OperationCount(size, BENCHMARK_BYTES_PER_REPETITION, 4, 256);
+            std::vector<VkBuffer> buffers(count, VK_NULL_HANDLE);
+            std::vector<MemoryAllocation> allocations(count);
+
+            auto createAll = [&]()
+            {
+                for (uint32_t i = 0; i < count; ++i)
+                {
+                    allocator.CreateBuffer(size, usage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, buffers[i], allocations[i]);
+                }
+            };
+            auto destroyAll = [&]()
+            {
+                for (uint32_t i = 0; i < count; ++i)
+                {
+                    allocator.DestroyBuffer(buffers[i], allocations[i]);
+                }
+            };
+
+            // Every buffer is alive at once, as when a scene is loaded, so blocks are not simply recycled
+            Measure("CreateBuffer", Parameter("size", size), count, 0, nullptr, createAll, destroyAll);
+            Measure("DestroyBuffer", Parameter("size", size), count, 0, createAll, destroyAll, nullptr);
+        }
+    }
+
+    void RendererBenchmark::BenchmarkCopyBuffer()
+    {
+        MemoryAllocator& allocator = *renderer_.allocator_;
+
+        for (VkDeviceSize size : BENCHMARK_BUFFER_SIZES)
+        {
+            VkBuffer srcBuffer;
+            MemoryAllocation srcAllocation;
+            allocator.CreateBuffer(size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, srcBuffer, srcAllocation);
+
+            VkBuffer dstBuffer;
+            MemoryAllocation dstAllocation;
+            allocator.CreateBuffer(size, VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                dstBuffer, dstAllocation);
+
+            // Every copy is submitted on its own and waited for, as CopyBuffer always does
+            uint32_t count = OperationCount(size, BENCHMARK_BYTES_PER_REPETITION, 4, 64);
+            Measure("CopyBuffer", Parameter("size", size), count, size, nullptr,
+                [&]()
+                {
+                    for (uint32_t i = 0; i < count; ++i)
+                    {
+                        CopyBuffer(renderer_.logicalDevice_, renderer_.graphicsQueue_, renderer_.commandPool_,
+                            srcBuffer, dstBuffer, size);
+                    }
+                },
+                nullptr);
+
+            allocator.DestroyBuffer(dstBuffer, dstAllocation);
+            allocator.DestroyBuffer(srcBuffer, srcAllocation);
+        }
+    }
+
+    void RendererBenchmark::BenchmarkMeshConstruction()
+    {
+        GeometryPool& geometryPool = *renderer_.geometryPool_;
+        UploadManager& uploadManager = *renderer_.uploadManager_;
+
+        std::vector<Vertex> vertices;
+        std::vector<uint32_t> indices;
+
+        for (uint32_t vertexCount : BENCHMARK_MESH_VERTEX_COUNTS)
+        {
+            BuildQuadGrid(vertexCount, vertices, indices);
+
+            uint32_t count = OperationCount(vertices.size(), BENCHMARK_VERTICES_PER_REPETITION, 4, 256);
+            uint64_t indexSize = vertices.size() <= GeometryPool::MAX_16BIT_INDEXED_VERTICES ? sizeof(uint16_t)
+                : sizeof(uint32_t);
+            uint64_t meshBytes = vertices.size() * renderer_.vertexLayout_.GetStride() + indices.size() * indexSize;
+            std::vector<Mesh> meshes;
+            meshes.reserve(count);
+
+            // Includes the upload, a mesh is only usable once its data has reached the device
+            Measure("MeshConstruction", Parameter("vertices", vertices.size()), count, meshBytes, nullptr,
+                [&]()
+                {
+                    for (uint32_t i = 0; i < count; ++i)
+                    {
+                        meshes.emplace_back(geometryPool, renderer_.vertexLayout_, vertices, indices);
+                    }
+                    uploadManager.Flush();
+                    uploadManager.WaitIdle();
+                },
+                [&]()
+                {
+                    meshes.clear();
+                });
+        }
+    }
+
+    void RendererBenchmark::BenchmarkMeshFileLoad()
+    {
+        GeometryPool& geometryPool = *renderer_.geometryPool_;
+        UploadManager& uploadManager = *renderer_.uploadManager_;
+
+        std::vector<Vertex> vertices;
+        std::vector<uint32_t> indices;
+
+        for (uint32_t vertexCount : BENCHMARK_MESH_VERTEX_COUNTS)
+        {
+            BuildQuadGrid(vertexCount, vertices, indices);
+
+            std::string path = (std::filesystem::temp_directory_path()
+                / ("p3d_benchmark_" + std::to_string(vertices.size()) + ".p3dm")).string();
+            MeshFile::Write(path, renderer_.vertexLayout_, vertices, indices);
+
+            uint32_t count = OperationCount(vertices.size(), BENCHMARK_VERTICES_PER_REPETITION, 4, 256);
+            uint64_t fileBytes = std::filesystem::file_size(path);
+            std::vector<Mesh> meshes;
+            meshes.reserve(count);
+
+            // Same work as MeshConstruction, but the data comes from a mapped file that is already in the page
+            // cache, so the difference is the cost of encoding the vertices on every load
+            Measure("MeshFileLoad", Parameter("vertices", vertices.size()), count, fileBytes, nullptr,
+                [&]()
+                {
+                    for (uint32_t i = 0; i < count; ++i)
+                    {
+                        MeshFile meshFile(path);
+                        meshes.emplace_back(geometryPool, renderer_.vertexLayout_, meshFile);
+                    }
+                    uploadManager.Flush();
+                    uploadManager.WaitIdle();
+                },
+                [&]()
+                {
+                    meshes.clear();
+                });
+
+            std::filesystem::remove(path);
+        }
+    }
+
+    void RendererBenchmark::BenchmarkUpdateUniformBuffer()
+    {
+        uint32_t frameCount = (uint32_t)renderer_.frames_.size();
+
+        // Cycles through the frames in flight like Render does, nothing reads the ring while the device is idle
+        Measure("UpdateUniformBuffer", Parameter("frames", frameCount), BENCHMARK_UNIFORM_UPDATES,
+            sizeof(Renderer::ProjectionMatrices), nullptr,
+            [&]()
+            {
+                for (uint32_t i = 0; i < BENCHMARK_UNIFORM_UPDATES; ++i)
+                {
+                    renderer_.UpdateUniformBuffer(i % frameCount);
+                }
+            },
+            nullptr);
+    }
+
+    void RendererBenchmark::BenchmarkDescriptorSetAllocation()
+    {
+        VkDevice device = renderer_.logicalDevice_;
+
+        // Matches the renderer's own pool, scaled up to hold every set a repetition allocates
+        VkDescriptorPoolSize poolSize {};
+        poolSize.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+        poolSize.descriptorCount = BENCHMARK_DESCRIPTOR_SETS;
+
+        VkDescriptorPoolCreateInfo poolCreateInfo {};
+        poolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+        poolCreateInfo.poolSizeCount = 1;
+        poolCreateInfo.pPoolSizes = &poolSize;
+        poolCreateInfo.maxSets = BENCHMARK_DESCRIPTOR_SETS;
+
+        VkDescriptorPool descriptorPool;
+        VkResult result = vkCreateDescriptorPool(device, &poolCreateInfo, nullptr, &descriptorPool);
+        if (result != VK_SUCCESS)
+        {
+            throw std::runtime_error("Failed to create a Descriptor Pool!");
+        }
+
+        std::vector<VkDescriptorSet> descriptorSets(BENCHMARK_DESCRIPTOR_SETS);
+
+        for (uint32_t batchSize : BENCHMARK_DESCRIPTOR_BATCH_SIZES)
+        {
+            std::vector<VkDescriptorSetLayout> layouts(batchSize, renderer_.descriptorSetLayout_);
+
+            VkDescriptorSetAllocateInfo allocateInfo {};
+            allocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+            allocateInfo.descriptorPool = descriptorPool;
+            allocateInfo.descriptorSetCount = batchSize;
+            allocateInfo.pSetLayouts = layouts.data();
+
+            // Resetting the pool releases every set at once, which is how per-frame pools would be recycled
+            Measure("AllocateDescriptorSets", Parameter("batch", batchSize), BENCHMARK_DESCRIPTOR_SETS, 0, nullptr,
+                [&]()
+                {
+                    for (uint32_t i = 0; i < BENCHMARK_DESCRIPTOR_SETS; i += batchSize)
+                    {
+                        if (vkAllocateDescriptorSets(device, &allocateInfo, &descriptorSets[i]) != VK_SUCCESS)
+                        {
+                            throw std::runtime_error("Failed to allocate Descriptor Sets!");
+                        }
+                    }
+                },
+                [&]()
+                {
+                    vkResetDescriptorPool(device, descriptorPool, 0);
+                });
+        }
+
+        vkDestroyDescriptorPool(device, descriptorPool, nullptr);
+    }
+}
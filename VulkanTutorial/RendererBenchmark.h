@@ -0,0 +1,76 @@
+#pragma once
+#ifndef RENDERER_BENCHMARK_H
+#define RENDERER_BENCHMARK_H
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace p3d
+{
+    class Renderer;
+
+    struct BenchmarkConfig
+    {
+        // Timed repetitions per case, each one runs the case's operations back to back
+        uint32_t repetitions = 10;
+
+        // Untimed repetitions run first, so that memory blocks and driver caches are already warm
+        uint32_t warmupRepetitions = 1;
+
+        // Only cases whose name contains this string are run
+        std::string filter;
+    };
+
+    // Timings of one benchmark case, every sample is the mean time of one operation in a repetition
+    struct BenchmarkResult
+    {
+        std::string name;
+        std::string parameters;
+        uint32_t operationsPerRepetition = 0;
+
+        // Bytes moved by one operation, zero when throughput is meaningless for the case
+        uint64_t bytesPerOperation = 0;
+
+        std::vector<double> samplesNs;
+        double meanNs = 0.0;
+        double medianNs = 0.0;
+        double stddevNs = 0.0;
+        double minNs = 0.0;
+        double maxNs = 0.0;
+    };
+
+    // Measures the renderer's resource creation and per-frame update paths on an otherwise idle device.
+    // Must run before the renderer submits any frames, the cases use its queues and pools directly.
+    class RendererBenchmark
+    {
+    public:
+        RendererBenchmark(Renderer& renderer, const BenchmarkConfig& config);
+
+        std::vector<BenchmarkResult> Run();
+
+        // CSV unless the path ends in .json, in which case every result is one JSON object per line
+        static void WriteResults(const std::vector<BenchmarkResult>& results, const std::string& path);
+
+    private:
+        Renderer& renderer_;
+        BenchmarkConfig config_;
+        std::vector<BenchmarkResult> results_;
+
+        // Times run() once per repetition. setup() and teardown() surround every repetition outside of the
+        // timed region and may be empty
+        void Measure(const std::string& name, const std::string& parameters, uint32_t operations,
+            uint64_t bytesPerOperation, const std::function<void()>& setup, const std::function<void()>& run,
+            const std::function<void()>& teardown);
+
+        void BenchmarkCreateBuffer();
+        void BenchmarkCopyBuffer();
+        void BenchmarkMeshConstruction();
+        void BenchmarkMeshFileLoad();
+        void BenchmarkUpdateUniformBuffer();
+        void BenchmarkDescriptorSetAllocation();
+    };
+}
+
+#endif // RENDERER_BENCHMARK_H
@@ -12,7 +12,7 @@ function ScanDirectory()
 {
     local targetDirectory=$1
     echo "Scanning target directory ${targetDirectory}"
-    local files=`find ${targetDirectory} -type f -name '*.frag' -or -name '*.vert'`
+    local files=`find ${targetDirectory} -type f -name '*.frag' -or -name '*.vert' -or -name '*.comp'`
     
     for i in $files 
     do
@@ -0,0 +1,66 @@
+#version 450
+#extension GL_ARB_shader_draw_parameters : require
+
+// simple_shader.vert for draws built by the cull pass, the object comes from the culling buffers
+// instead of push constants
+
+layout(location = 0) in vec3 pos;
+layout(location = 1) in vec3 col;
+
+// Location 7 is reserved for the optional octahedral normal of the vertex layout
+
+// Per-instance attributes, a mat4 takes up four consecutive locations
+layout(location = 2) in mat4 instanceModel;
+layout(location = 6) in vec4 instanceColour;
+
+layout(set = 0, binding = 0) uniform ProjectionMatrices
+{
+    mat4 perspective;
+    mat4 view;
+} projMat;
+
+// Must match GpuObjectData in renderer.h
+struct GpuObject
+{
+    mat4 model;
+    vec4 positionScale;
+    vec4 positionOffset;
+    vec4 boundsMin;
+    vec4 boundsMax;
+
+    uint indexCount;
+    uint firstIndex;
+    int vertexOffset;
+    uint firstInstance;
+    uint instanceCount;
+    uint drawList;
+    uint drawSlot;
+    uint padding;
+};
+
+layout(std430, set = 1, binding = 0) readonly buffer Objects
+{
+    GpuObject objects[];
+};
+
+layout(std430, set = 1, binding = 2) readonly buffer DrawObjectIds
+{
+    uint drawObjectIds[];
+};
+
+// Index of the first draw of the list being drawn, gl_DrawIDARB counts from there
+layout(push_constant) uniform DrawList
+{
+    uint firstDraw;
+} drawList;
+
+layout(location = 0) out vec3 fragCol;
+
+void main() 
+{
+    GpuObject object = objects[drawObjectIds[drawList.firstDraw + uint(gl_DrawIDARB)]];
+
+    vec3 position = object.positionOffset.xyz + object.positionScale.xyz * pos;
+    gl_Position = projMat.perspective * projMat.view * object.model * instanceModel * vec4(position, 1.0);
+    fragCol = col * instanceColour.rgb;
+}
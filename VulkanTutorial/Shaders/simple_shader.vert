@@ -3,17 +3,35 @@
 layout(location = 0) in vec3 pos;
 layout(location = 1) in vec3 col;
 
+// Location 7 is reserved for the optional octahedral normal of the vertex layout
+
+// Per-instance attributes, a mat4 takes up four consecutive locations
+layout(location = 2) in mat4 instanceModel;
+layout(location = 6) in vec4 instanceColour;
+
 layout(binding = 0) uniform ProjectionMatrices
 {
     mat4 perspective;
     mat4 view;
-    mat4 model;
 } projMat;
 
+// Pushed before each draw, must match ObjectPushConstants in renderer.h
+layout(push_constant) uniform ObjectData
+{
+    mat4 model;
+
+    // Compact vertex formats store positions relative to the mesh's bounds
+    vec4 positionScale;
+    vec4 positionOffset;
+
+    uint objectId;
+} object;
+
 layout(location = 0) out vec3 fragCol;
 
 void main() 
 {
-    gl_Position = projMat.perspective * projMat.view * projMat.model * vec4(pos, 1.0);
-    fragCol = col;
+    vec3 position = object.positionOffset.xyz + object.positionScale.xyz * pos;
+    gl_Position = projMat.perspective * projMat.view * object.model * instanceModel * vec4(position, 1.0);
+    fragCol = col * instanceColour.rgb;
 }
\ No newline at end of file
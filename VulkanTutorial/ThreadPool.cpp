@@ -0,0 +1,106 @@
+#include "ThreadPool.h"
+
+ThreadPool::ThreadPool(uint32_t workerCount)
+{
+    for (uint32_t i = 0; i < workerCount; ++i)
+    {
+        workers_.emplace_back(&ThreadPool::WorkerLoop, this);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    workAvailable_.notify_all();
+
+    for (std::thread& worker : workers_)
+    {
+        worker.join();
+    }
+}
+
+uint32_t ThreadPool::DefaultWorkerCount()
+{
+    uint32_t hardwareThreads = std::thread::hardware_concurrency();
+    return hardwareThreads > 1 ? hardwareThreads - 1 : 0;
+}
+
+void ThreadPool::ParallelFor(uint32_t taskCount, const std::function<void(uint32_t)>& task)
+{
+    if (taskCount == 0)
+    {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        task_ = &task;
+        taskCount_ = taskCount;
+        nextTask_ = 0;
+        error_ = nullptr;
+        activeWorkers_ = (uint32_t)workers_.size();
+        ++generation_;
+    }
+    workAvailable_.notify_all();
+
+    RunTasks();
+
+    // Workers keep a pointer to the task, so it must not go out of scope before they are all done
+    std::unique_lock<std::mutex> lock(mutex_);
+    workFinished_.wait(lock, [this] { return activeWorkers_ == 0; });
+    task_ = nullptr;
+
+    if (error_)
+    {
+        std::rethrow_exception(error_);
+    }
+}
+
+void ThreadPool::RunTasks()
+{
+    // Tasks are claimed one at a time, so uneven tasks balance out across the threads
+    for (uint32_t taskIndex = nextTask_++; taskIndex < taskCount_; taskIndex = nextTask_++)
+    {
+        try
+        {
+            (*task_)(taskIndex);
+        }
+        catch (...)
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!error_)
+            {
+                error_ = std::current_exception();
+            }
+        }
+    }
+}
+
+void ThreadPool::WorkerLoop()
+{
+    uint64_t lastGeneration = 0;
+
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            workAvailable_.wait(lock, [&] { return stopping_ || generation_ != lastGeneration; });
+            if (stopping_)
+            {
+                return;
+            }
+            lastGeneration = generation_;
+        }
+
+        RunTasks();
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            --activeWorkers_;
+        }
+        workFinished_.notify_one();
+    }
+}
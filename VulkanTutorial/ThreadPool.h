@@ -0,0 +1,55 @@
+#pragma once
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads for fork/join work such as recording command buffers. The calling
+// thread takes part in the work, so a pool with no workers simply runs everything inline.
+class ThreadPool
+{
+public:
+    // Defaults to one worker per hardware thread, minus the calling thread
+    ThreadPool(uint32_t workerCount = DefaultWorkerCount());
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Runs task(0) .. task(taskCount - 1) across the workers and returns once all of them have finished.
+    // Each index is run exactly once. The first exception thrown by a task is rethrown here
+    void ParallelFor(uint32_t taskCount, const std::function<void(uint32_t)>& task);
+
+    // Number of threads that can run tasks at once, including the caller
+    uint32_t GetThreadCount() const { return (uint32_t)workers_.size() + 1; }
+
+    static uint32_t DefaultWorkerCount();
+
+private:
+    std::vector<std::thread> workers_;
+
+    std::mutex mutex_;
+    std::condition_variable workAvailable_;
+    std::condition_variable workFinished_;
+
+    // Bumped for every ParallelFor so that workers can tell a new job from the one they just ran
+    uint64_t generation_ = 0;
+    bool stopping_ = false;
+
+    const std::function<void(uint32_t)>* task_ = nullptr;
+    uint32_t taskCount_ = 0;
+    std::atomic<uint32_t> nextTask_{ 0 };
+    uint32_t activeWorkers_ = 0;
+    std::exception_ptr error_;
+
+    void WorkerLoop();
+    void RunTasks();
+};
+#endif // THREAD_POOL_H
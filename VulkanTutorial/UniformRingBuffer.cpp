@@ -0,0 +1,45 @@
+#include "UniformRingBuffer.h"
+
+#include <cstring>
+#include <stdexcept>
+
+static VkDeviceSize AlignUp(VkDeviceSize value, VkDeviceSize alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+UniformRingBuffer::UniformRingBuffer(MemoryAllocator& allocator, VkDeviceSize frameSize, uint32_t frameCount)
+    : allocator_(allocator), frameCount_(frameCount)
+{
+    alignment_ = allocator_.GetPhysicalDeviceProperties().limits.minUniformBufferOffsetAlignment;
+    alignment_ = alignment_ > 0 ? alignment_ : 1;
+    frameSize_ = AlignUp(frameSize, alignment_);
+
+    allocator_.CreateBuffer(frameSize_ * frameCount_, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, buffer_, bufferMemory_);
+}
+
+UniformRingBuffer::~UniformRingBuffer()
+{
+    allocator_.DestroyBuffer(buffer_, bufferMemory_);
+}
+
+void UniformRingBuffer::BeginFrame(uint32_t frameIndex)
+{
+    frameStart_ = (frameIndex % frameCount_) * frameSize_;
+    writeOffset_ = frameStart_;
+}
+
+uint32_t UniformRingBuffer::Push(const void* data, VkDeviceSize size)
+{
+    VkDeviceSize offset = AlignUp(writeOffset_, alignment_);
+    if (offset + size > frameStart_ + frameSize_)
+    {
+        throw std::runtime_error("Uniform ring buffer frame slice is full!");
+    }
+
+    memcpy(static_cast<char*>(bufferMemory_.mappedData) + offset, data, (size_t)size);
+    writeOffset_ = offset + size;
+
+    return (uint32_t)offset;
+}
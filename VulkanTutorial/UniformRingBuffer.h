@@ -0,0 +1,50 @@
+#pragma once
+#ifndef UNIFORM_RING_BUFFER_H
+#define UNIFORM_RING_BUFFER_H
+
+#include <vulkan/vulkan.h>
+#include "MemoryAllocator.h"
+
+// A single persistently mapped, host coherent uniform buffer split into one slice per frame.
+// Per-frame constants are bump-allocated from the current slice and bound with dynamic offsets,
+// so nothing is mapped or unmapped while rendering.
+class UniformRingBuffer
+{
+public:
+    UniformRingBuffer(MemoryAllocator& allocator, VkDeviceSize frameSize, uint32_t frameCount);
+    ~UniformRingBuffer();
+
+    UniformRingBuffer(const UniformRingBuffer&) = delete;
+    UniformRingBuffer& operator=(const UniformRingBuffer&) = delete;
+
+    // Starts writing into the slice owned by the given frame. The GPU must be done with that slice.
+    void BeginFrame(uint32_t frameIndex);
+
+    // Copies data into the current slice and returns the dynamic offset to bind it with
+    uint32_t Push(const void* data, VkDeviceSize size);
+
+    template <typename T>
+    uint32_t Push(const T& value)
+    {
+        return Push(&value, sizeof(T));
+    }
+
+    uint32_t GetFrameOffset(uint32_t frameIndex) const { return (uint32_t)(frameIndex * frameSize_); }
+    VkDeviceSize GetFrameSize() const { return frameSize_; }
+    VkBuffer GetBuffer() const { return buffer_; }
+
+private:
+    MemoryAllocator& allocator_;
+
+    VkBuffer buffer_ = VK_NULL_HANDLE;
+    MemoryAllocation bufferMemory_;
+
+    // Every dynamic offset has to be a multiple of minUniformBufferOffsetAlignment
+    VkDeviceSize alignment_;
+    VkDeviceSize frameSize_;
+    uint32_t frameCount_;
+
+    VkDeviceSize frameStart_ = 0;
+    VkDeviceSize writeOffset_ = 0;
+};
+#endif // UNIFORM_RING_BUFFER_H
@@ -0,0 +1,393 @@
+#include "UploadManager.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+// Staging allocations are rounded up so every copy starts on a nicely aligned offset
+static const VkDeviceSize STAGING_ALIGNMENT = 16;
+
+UploadManager::UploadManager(MemoryAllocator& allocator, VkQueue transferQueue, uint32_t transferFamilyIndex,
+    VkQueue dstQueue, uint32_t dstFamilyIndex, VkDeviceSize stagingSize) : allocator_(allocator),
+    device_(allocator.GetDevice()), transferQueue_(transferQueue), transferFamilyIndex_(transferFamilyIndex),
+    dstQueue_(dstQueue), dstFamilyIndex_(dstFamilyIndex), stagingSize_(stagingSize)
+{
+    transferCommandPool_ = CreateCommandPool(transferFamilyIndex_);
+    if (TransfersOwnership())
+    {
+        dstCommandPool_ = CreateCommandPool(dstFamilyIndex_);
+    }
+
+    allocator_.CreateBuffer(stagingSize_, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer_,
+        stagingBufferMemory_);
+}
+
+UploadManager::~UploadManager()
+{
+    WaitIdle();
+
+    for (Batch& batch : freeBatches_)
+    {
+        vkDestroyFence(device_, batch.fence, nullptr);
+        vkDestroySemaphore(device_, batch.transferComplete, nullptr);
+    }
+
+    // Destroying the pools also frees every batch command buffer
+    vkDestroyCommandPool(device_, transferCommandPool_, nullptr);
+    vkDestroyCommandPool(device_, dstCommandPool_, nullptr);
+    allocator_.DestroyBuffer(stagingBuffer_, stagingBufferMemory_);
+}
+
+VkCommandPool UploadManager::CreateCommandPool(uint32_t queueFamilyIndex)
+{
+    VkCommandPoolCreateInfo poolCreateInfo{};
+    poolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolCreateInfo.queueFamilyIndex = queueFamilyIndex;
+    // Batch command buffers are short lived and re-recorded once their fence has signalled
+    poolCreateInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+
+    VkCommandPool commandPool;
+    VkResult result = vkCreateCommandPool(device_, &poolCreateInfo, nullptr, &commandPool);
+    if (result != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create an upload Command Pool!");
+    }
+
+    return commandPool;
+}
+
+void UploadManager::BeginBatch()
+{
+    Batch batch;
+
+    if (!freeBatches_.empty())
+    {
+        batch = freeBatches_.back();
+        freeBatches_.pop_back();
+    }
+    else
+    {
+        VkCommandBufferAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocInfo.commandPool = transferCommandPool_;
+        allocInfo.commandBufferCount = 1;
+
+        VkFenceCreateInfo fenceCreateInfo = {};
+        fenceCreateInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+        if (vkAllocateCommandBuffers(device_, &allocInfo, &batch.commandBuffer) != VK_SUCCESS ||
+            vkCreateFence(device_, &fenceCreateInfo, nullptr, &batch.fence) != VK_SUCCESS)
+        {
+            throw std::runtime_error("Failed to create an upload batch!");
+        }
+
+        if (TransfersOwnership())
+        {
+            allocInfo.commandPool = dstCommandPool_;
+
+            VkSemaphoreCreateInfo semaphoreCreateInfo = {};
+            semaphoreCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+            if (vkAllocateCommandBuffers(device_, &allocInfo, &batch.acquireCommandBuffer) != VK_SUCCESS ||
+                vkCreateSemaphore(device_, &semaphoreCreateInfo, nullptr, &batch.transferComplete) != VK_SUCCESS)
+            {
+                throw std::runtime_error("Failed to create an upload batch!");
+            }
+        }
+    }
+
+    batch.ticket = nextTicket_++;
+    batch.ownershipBarriers.clear();
+    batch.stagingBytes = 0;
+    batch.stagingEnd = head_;
+
+    VkCommandBufferBeginInfo beginInfo = {};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+    vkBeginCommandBuffer(batch.commandBuffer, &beginInfo);
+
+    currentBatch_ = batch;
+    recording_ = true;
+}
+
+VkDeviceSize UploadManager::AllocateStaging(VkDeviceSize size)
+{
+    size = (size + STAGING_ALIGNMENT - 1) / STAGING_ALIGNMENT * STAGING_ALIGNMENT;
+
+    while (true)
+    {
+        if (usedBytes_ == 0)
+        {
+            head_ = 0;
+            tail_ = 0;
+        }
+
+        bool full = usedBytes_ > 0 && head_ == tail_;
+        bool fits = false;
+        VkDeviceSize offset = 0;
+        VkDeviceSize padding = 0;
+
+        if (!full && head_ >= tail_)
+        {
+            // Free space is the end of the ring plus the start of the ring up to the oldest batch
+            if (head_ + size <= stagingSize_)
+            {
+                offset = head_;
+                fits = true;
+            }
+            else if (size <= tail_)
+            {
+                // Skip the unusable end of the ring, it is released together with this batch
+                padding = stagingSize_ - head_;
+                offset = 0;
+                fits = true;
+            }
+        }
+        else if (!full && head_ + size <= tail_)
+        {
+            offset = head_;
+            fits = true;
+        }
+
+        if (fits)
+        {
+            head_ = offset + size;
+            usedBytes_ += size + padding;
+            currentBatch_.stagingBytes += size + padding;
+            currentBatch_.stagingEnd = head_;
+            return offset;
+        }
+
+        // Out of staging space: wait for the oldest batch, or submit the current one so it can retire
+        if (!inFlightBatches_.empty())
+        {
+            RetireBatches(true);
+        }
+        else if (currentBatch_.stagingBytes > 0)
+        {
+            Flush();
+            BeginBatch();
+        }
+        else
+        {
+            throw std::runtime_error("Upload does not fit in the staging ring!");
+        }
+    }
+}
+
+uint64_t UploadManager::Upload(const void* data, VkDeviceSize size, VkBuffer dstBuffer, VkDeviceSize dstOffset)
+{
+    const char* source = static_cast<const char*>(data);
+
+    // Uploads larger than half the ring are split so each chunk can be staged while others are in flight
+    const VkDeviceSize maxChunkSize = stagingSize_ / 2;
+
+    while (size > 0)
+    {
+        if (!recording_)
+        {
+            BeginBatch();
+        }
+
+        VkDeviceSize chunkSize = std::min(size, maxChunkSize);
+        VkDeviceSize stagingOffset = AllocateStaging(chunkSize);
+
+        memcpy(static_cast<char*>(stagingBufferMemory_.mappedData) + stagingOffset, source, (size_t)chunkSize);
+
+        VkBufferCopy bufferCopyRegion{};
+        bufferCopyRegion.srcOffset = stagingOffset;
+        bufferCopyRegion.dstOffset = dstOffset;
+        bufferCopyRegion.size = chunkSize;
+
+        vkCmdCopyBuffer(currentBatch_.commandBuffer, stagingBuffer_, dstBuffer, 1, &bufferCopyRegion);
+
+        if (TransfersOwnership())
+        {
+            // The release and the acquire must describe exactly the same range
+            VkBufferMemoryBarrier ownershipBarrier{};
+            ownershipBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+            ownershipBarrier.srcQueueFamilyIndex = transferFamilyIndex_;
+            ownershipBarrier.dstQueueFamilyIndex = dstFamilyIndex_;
+            ownershipBarrier.buffer = dstBuffer;
+            ownershipBarrier.offset = dstOffset;
+            ownershipBarrier.size = chunkSize;
+
+            currentBatch_.ownershipBarriers.push_back(ownershipBarrier);
+        }
+
+        source += chunkSize;
+        dstOffset += chunkSize;
+        size -= chunkSize;
+    }
+
+    return recording_ ? currentBatch_.ticket : completedTicket_;
+}
+
+void UploadManager::Flush()
+{
+    if (!recording_)
+    {
+        return;
+    }
+
+    const VkAccessFlags readAccess = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT
+        | VK_ACCESS_UNIFORM_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+    const VkPipelineStageFlags readStages = VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT;
+
+    if (!TransfersOwnership())
+    {
+        // Make the copies visible to everything submitted to the queue after this batch
+        VkMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = readAccess;
+
+        vkCmdPipelineBarrier(currentBatch_.commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, readStages, 0, 1, &barrier,
+            0, nullptr, 0, nullptr);
+
+        vkEndCommandBuffer(currentBatch_.commandBuffer);
+
+        VkSubmitInfo submitInfo = {};
+        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submitInfo.commandBufferCount = 1;
+        submitInfo.pCommandBuffers = &currentBatch_.commandBuffer;
+
+        VkResult result = vkQueueSubmit(transferQueue_, 1, &submitInfo, currentBatch_.fence);
+        if (result != VK_SUCCESS)
+        {
+            throw std::runtime_error("Failed to submit an upload batch!");
+        }
+    }
+    else
+    {
+        std::vector<VkBufferMemoryBarrier>& barriers = currentBatch_.ownershipBarriers;
+
+        // Release: flush the copies and hand the buffers over. Access on the other family is ignored here
+        for (VkBufferMemoryBarrier& barrier : barriers)
+        {
+            barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            barrier.dstAccessMask = 0;
+        }
+
+        vkCmdPipelineBarrier(currentBatch_.commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+            VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, (uint32_t)barriers.size(), barriers.data(), 0,
+            nullptr);
+
+        vkEndCommandBuffer(currentBatch_.commandBuffer);
+
+        // Acquire: the matching barriers make the data visible to reads on the destination family
+        for (VkBufferMemoryBarrier& barrier : barriers)
+        {
+            barrier.srcAccessMask = 0;
+            barrier.dstAccessMask = readAccess;
+        }
+
+        VkCommandBufferBeginInfo beginInfo = {};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+        vkBeginCommandBuffer(currentBatch_.acquireCommandBuffer, &beginInfo);
+        // The source scope must cover the semaphore wait's stages, otherwise the barrier, and every read
+        // ordered after it, does not chain to the copies
+        vkCmdPipelineBarrier(currentBatch_.acquireCommandBuffer, readStages, readStages, 0, 0, nullptr,
+            (uint32_t)barriers.size(), barriers.data(), 0, nullptr);
+        vkEndCommandBuffer(currentBatch_.acquireCommandBuffer);
+
+        VkSubmitInfo releaseSubmitInfo = {};
+        releaseSubmitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        releaseSubmitInfo.commandBufferCount = 1;
+        releaseSubmitInfo.pCommandBuffers = &currentBatch_.commandBuffer;
+        releaseSubmitInfo.signalSemaphoreCount = 1;
+        releaseSubmitInfo.pSignalSemaphores = &currentBatch_.transferComplete;
+
+        VkResult result = vkQueueSubmit(transferQueue_, 1, &releaseSubmitInfo, VK_NULL_HANDLE);
+        if (result != VK_SUCCESS)
+        {
+            throw std::runtime_error("Failed to submit an upload batch!");
+        }
+
+        // The acquire runs after the copies, so its fence retires the whole batch
+        VkPipelineStageFlags waitStage = readStages;
+
+        VkSubmitInfo acquireSubmitInfo = {};
+        acquireSubmitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        acquireSubmitInfo.waitSemaphoreCount = 1;
+        acquireSubmitInfo.pWaitSemaphores = &currentBatch_.transferComplete;
+        acquireSubmitInfo.pWaitDstStageMask = &waitStage;
+        acquireSubmitInfo.commandBufferCount = 1;
+        acquireSubmitInfo.pCommandBuffers = &currentBatch_.acquireCommandBuffer;
+
+        result = vkQueueSubmit(dstQueue_, 1, &acquireSubmitInfo, currentBatch_.fence);
+        if (result != VK_SUCCESS)
+        {
+            throw std::runtime_error("Failed to submit an upload acquire batch!");
+        }
+    }
+
+    inFlightBatches_.push_back(currentBatch_);
+    currentBatch_ = Batch{};
+    recording_ = false;
+}
+
+void UploadManager::RetireBatches(bool waitForOldest)
+{
+    constexpr uint64_t maxWait = std::numeric_limits<uint64_t>::max();
+
+    // Batches are submitted to a single queue, so they always retire in submission order
+    while (!inFlightBatches_.empty())
+    {
+        Batch& batch = inFlightBatches_.front();
+
+        if (waitForOldest)
+        {
+            vkWaitForFences(device_, 1, &batch.fence, VK_TRUE, maxWait);
+            waitForOldest = false;
+        }
+        else if (vkGetFenceStatus(device_, batch.fence) != VK_SUCCESS)
+        {
+            break;
+        }
+
+        vkResetFences(device_, 1, &batch.fence);
+
+        completedTicket_ = batch.ticket;
+        tail_ = batch.stagingEnd;
+        usedBytes_ -= batch.stagingBytes;
+
+        freeBatches_.push_back(batch);
+        inFlightBatches_.pop_front();
+    }
+}
+
+bool UploadManager::IsComplete(uint64_t ticket)
+{
+    RetireBatches(false);
+    return ticket <= completedTicket_;
+}
+
+void UploadManager::Wait(uint64_t ticket)
+{
+    if (recording_ && ticket >= currentBatch_.ticket)
+    {
+        Flush();
+    }
+
+    while (completedTicket_ < ticket && !inFlightBatches_.empty())
+    {
+        RetireBatches(true);
+    }
+}
+
+void UploadManager::WaitIdle()
+{
+    Flush();
+
+    while (!inFlightBatches_.empty())
+    {
+        RetireBatches(true);
+    }
+}
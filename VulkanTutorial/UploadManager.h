@@ -0,0 +1,95 @@
+#pragma once
+#ifndef UPLOAD_MANAGER_H
+#define UPLOAD_MANAGER_H
+
+#include <vulkan/vulkan.h>
+#include <deque>
+#include <vector>
+
+#include "MemoryAllocator.h"
+
+// Streams data into device local buffers through a persistently mapped staging ring. Copies are
+// gathered into one command buffer per batch and each batch is tracked with a fence, so callers
+// never wait for the queue to drain. Uploads are identified by the ticket of the batch they belong to.
+//
+// Copies may run on a dedicated transfer queue. The destination buffers are then released by the
+// transfer family and acquired by the family that reads them with a second, tiny submission on
+// the reading queue, which waits on a semaphore signalled by the copies.
+class UploadManager
+{
+public:
+    static constexpr VkDeviceSize DEFAULT_STAGING_SIZE = 32ULL * 1024 * 1024;
+
+    // transferQueue records the copies, dstQueue is where the uploaded buffers are consumed
+    UploadManager(MemoryAllocator& allocator, VkQueue transferQueue, uint32_t transferFamilyIndex,
+        VkQueue dstQueue, uint32_t dstFamilyIndex, VkDeviceSize stagingSize = DEFAULT_STAGING_SIZE);
+    ~UploadManager();
+
+    UploadManager(const UploadManager&) = delete;
+    UploadManager& operator=(const UploadManager&) = delete;
+
+    // Copies data into the staging ring and records a copy into dstBuffer. The data may be
+    // released as soon as this returns. Returns the ticket of the batch the copy was recorded into.
+    uint64_t Upload(const void* data, VkDeviceSize size, VkBuffer dstBuffer, VkDeviceSize dstOffset = 0);
+
+    // Submits the batch currently being recorded, if it holds any copies
+    void Flush();
+
+    // Tickets complete in order, so a ticket is complete once its batch's fence has signalled
+    bool IsComplete(uint64_t ticket);
+    void Wait(uint64_t ticket);
+    void WaitIdle();
+
+private:
+    struct Batch
+    {
+        VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+        VkFence fence = VK_NULL_HANDLE;
+        uint64_t ticket = 0;
+
+        // Only used when ownership moves between queue families
+        VkCommandBuffer acquireCommandBuffer = VK_NULL_HANDLE;
+        VkSemaphore transferComplete = VK_NULL_HANDLE;
+        std::vector<VkBufferMemoryBarrier> ownershipBarriers;
+
+        // Staging bytes consumed by the batch and the ring position once it was recorded
+        VkDeviceSize stagingBytes = 0;
+        VkDeviceSize stagingEnd = 0;
+    };
+
+    MemoryAllocator& allocator_;
+    VkDevice device_;
+
+    VkQueue transferQueue_;
+    uint32_t transferFamilyIndex_;
+    VkCommandPool transferCommandPool_;
+
+    VkQueue dstQueue_;
+    uint32_t dstFamilyIndex_;
+    VkCommandPool dstCommandPool_ = VK_NULL_HANDLE;
+
+    VkBuffer stagingBuffer_ = VK_NULL_HANDLE;
+    MemoryAllocation stagingBufferMemory_;
+    VkDeviceSize stagingSize_;
+
+    // Ring state: data is written at head_, the oldest in-flight batch starts at tail_
+    VkDeviceSize head_ = 0;
+    VkDeviceSize tail_ = 0;
+    VkDeviceSize usedBytes_ = 0;
+
+    bool recording_ = false;
+    Batch currentBatch_;
+    std::deque<Batch> inFlightBatches_;
+    std::vector<Batch> freeBatches_;
+
+    uint64_t nextTicket_ = 1;
+    uint64_t completedTicket_ = 0;
+
+    bool TransfersOwnership() const { return transferFamilyIndex_ != dstFamilyIndex_; }
+
+    VkCommandPool CreateCommandPool(uint32_t queueFamilyIndex);
+    VkDeviceSize AllocateStaging(VkDeviceSize size);
+    void BeginBatch();
+    void RetireBatches(bool waitForOldest);
+};
+#endif // UPLOAD_MANAGER_H
@@ -31,7 +31,8 @@ static uint32_t FindMemoryTypeIndex(VkPhysicalDevice physicalDevice, uint32_t al
 
     for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++)
     {
-        if ((allowedTypes & (1 << i)) && (memoryProperties.memoryTypes[i].propertyFlags & properties))
+        // Every requested property must be present, not just one of them
+        if ((allowedTypes & (1 << i)) && (memoryProperties.memoryTypes[i].propertyFlags & properties) == properties)
         {
             return i;
         }
@@ -40,80 +41,60 @@ static uint32_t FindMemoryTypeIndex(VkPhysicalDevice physicalDevice, uint32_t al
     throw std::runtime_error("Failed to find suitable memory type!");
 }
 
-static void CreateBuffer(VkPhysicalDevice physicalDevice, VkDevice device, VkDeviceSize bufferSize, 
-    VkBufferUsageFlags bufferUsage,	VkMemoryPropertyFlags bufferProperties, VkBuffer& buffer,
-    VkDeviceMemory& bufferMemory)
+static VkCommandBuffer BeginCommandBuffer(VkDevice device, VkCommandPool commandPool)
 {
-    VkBufferCreateInfo bufferInfo {};
-    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-    bufferInfo.size = bufferSize;
-    bufferInfo.usage = bufferUsage;
-    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-
-    VkResult result = vkCreateBuffer(device, &bufferInfo, nullptr, &buffer);
-    if (result != VK_SUCCESS)
-    {
-        throw std::runtime_error("Failed to create a Vertex Buffer!");
-    }
-
-    VkMemoryRequirements memRequirements;
-    vkGetBufferMemoryRequirements(device, buffer, &memRequirements);
-
-    VkMemoryAllocateInfo memoryAllocInfo = {};
-    memoryAllocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    memoryAllocInfo.allocationSize = memRequirements.size;
-    memoryAllocInfo.memoryTypeIndex = FindMemoryTypeIndex(physicalDevice, memRequirements.memoryTypeBits,
-        bufferProperties);
-
-    result = vkAllocateMemory(device, &memoryAllocInfo, nullptr, &bufferMemory);
-    if (result != VK_SUCCESS)
-    {
-        throw std::runtime_error("Failed to allocate Vertex Buffer Memory!");
-    }
-
-    // Allocate memory to given buffer
-    vkBindBufferMemory(device, buffer, bufferMemory, 0);
-}
-
-static void CopyBuffer(VkDevice device, VkQueue transferQueue, VkCommandPool transferCommandPool,
-    VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize bufferSize)
-{
-    VkCommandBuffer transferCommandBuffer;
+    VkCommandBuffer commandBuffer;
 
     VkCommandBufferAllocateInfo allocInfo{};
     allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
     allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-    allocInfo.commandPool = transferCommandPool;
+    allocInfo.commandPool = commandPool;
     allocInfo.commandBufferCount = 1;
 
     // Allocate command buffer from pool
-    vkAllocateCommandBuffers(device, &allocInfo, &transferCommandBuffer);
+    vkAllocateCommandBuffers(device, &allocInfo, &commandBuffer);
 
     // Information to begin the command buffer record
     VkCommandBufferBeginInfo beginInfo = {};
     beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
     beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
 
-    // Region of data to copy from and to
-    VkBufferCopy bufferCopyRegion{};
-    bufferCopyRegion.srcOffset = 0;
-    bufferCopyRegion.dstOffset = 0;
-    bufferCopyRegion.size = bufferSize;
+    vkBeginCommandBuffer(commandBuffer, &beginInfo);
 
-    vkBeginCommandBuffer(transferCommandBuffer, &beginInfo);
-    vkCmdCopyBuffer(transferCommandBuffer, srcBuffer, dstBuffer, 1, &bufferCopyRegion);
-    vkEndCommandBuffer(transferCommandBuffer);
+    return commandBuffer;
+}
+
+static void EndAndSubmitCommandBuffer(VkDevice device, VkQueue queue, VkCommandPool commandPool,
+    VkCommandBuffer commandBuffer)
+{
+    vkEndCommandBuffer(commandBuffer);
 
     // Queue submission information
     VkSubmitInfo submitInfo = {};
     submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
     submitInfo.commandBufferCount = 1;
-    submitInfo.pCommandBuffers = &transferCommandBuffer;
+    submitInfo.pCommandBuffers = &commandBuffer;
+
+    vkQueueSubmit(queue, 1, &submitInfo, VK_NULL_HANDLE);
+    vkQueueWaitIdle(queue);
+
+    vkFreeCommandBuffers(device, commandPool, 1, &commandBuffer);
+}
+
+static void CopyBuffer(VkDevice device, VkQueue transferQueue, VkCommandPool transferCommandPool,
+    VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize bufferSize)
+{
+    VkCommandBuffer transferCommandBuffer = BeginCommandBuffer(device, transferCommandPool);
 
-    vkQueueSubmit(transferQueue, 1, &submitInfo, VK_NULL_HANDLE);
-    vkQueueWaitIdle(transferQueue);
+    // Region of data to copy from and to
+    VkBufferCopy bufferCopyRegion{};
+    bufferCopyRegion.srcOffset = 0;
+    bufferCopyRegion.dstOffset = 0;
+    bufferCopyRegion.size = bufferSize;
+
+    vkCmdCopyBuffer(transferCommandBuffer, srcBuffer, dstBuffer, 1, &bufferCopyRegion);
 
-    vkFreeCommandBuffers(device, transferCommandPool, 1, &transferCommandBuffer);
+    EndAndSubmitCommandBuffer(device, transferQueue, transferCommandPool, transferCommandBuffer);
 }
 
 #endif // UTILITIES_H
@@ -0,0 +1,153 @@
+#include "VertexLayout.h"
+
+#include <glm/gtc/packing.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+// Bytes taken by the position and colour of each format, positions are padded to four components
+static const uint32_t FLOAT32_POSITION_SIZE = 3 * sizeof(float);
+static const uint32_t FLOAT32_COLOUR_SIZE = 3 * sizeof(float);
+static const uint32_t PACKED_POSITION_SIZE = 4 * sizeof(uint16_t);
+static const uint32_t PACKED_COLOUR_SIZE = sizeof(uint32_t);
+static const uint32_t PACKED_NORMAL_SIZE = sizeof(uint32_t);
+
+static int16_t PackSnorm16(float value)
+{
+    return (int16_t)std::round(std::clamp(value, -1.0f, 1.0f) * 32767.0f);
+}
+
+VertexLayout::VertexLayout(VertexFormat format, bool normals) : format_(format), normals_(normals)
+{
+    bool packed = format_ != VertexFormat::Float32;
+    colourOffset_ = packed ? PACKED_POSITION_SIZE : FLOAT32_POSITION_SIZE;
+    normalOffset_ = colourOffset_ + (packed ? PACKED_COLOUR_SIZE : FLOAT32_COLOUR_SIZE);
+    stride_ = normalOffset_ + (normals_ ? PACKED_NORMAL_SIZE : 0);
+}
+
+std::vector<VkVertexInputAttributeDescription> VertexLayout::GetAttributeDescriptions(uint32_t binding) const
+{
+    std::vector<VkVertexInputAttributeDescription> attributes;
+
+    // Normalised and half float formats are expanded to floats by the vertex fetch, the shader is unaffected
+    VkVertexInputAttributeDescription position{};
+    position.binding = binding;
+    position.location = POSITION_LOCATION;
+    position.offset = 0;
+    switch (format_)
+    {
+    case VertexFormat::Float32:
+        position.format = VK_FORMAT_R32G32B32_SFLOAT;
+        break;
+    case VertexFormat::Snorm16:
+        position.format = VK_FORMAT_R16G16B16A16_SNORM;
+        break;
+    case VertexFormat::Float16:
+        position.format = VK_FORMAT_R16G16B16A16_SFLOAT;
+        break;
+    }
+    attributes.push_back(position);
+
+    VkVertexInputAttributeDescription colour{};
+    colour.binding = binding;
+    colour.location = COLOUR_LOCATION;
+    colour.format = format_ == VertexFormat::Float32 ? VK_FORMAT_R32G32B32_SFLOAT : VK_FORMAT_R8G8B8A8_UNORM;
+    colour.offset = colourOffset_;
+    attributes.push_back(colour);
+
+    if (normals_)
+    {
+        VkVertexInputAttributeDescription normal{};
+        normal.binding = binding;
+        normal.location = NORMAL_LOCATION;
+        normal.format = VK_FORMAT_R16G16_SNORM;
+        normal.offset = normalOffset_;
+        attributes.push_back(normal);
+    }
+
+    return attributes;
+}
+
+VertexDequantization VertexLayout::Encode(const std::vector<Vertex>& vertices, std::vector<uint8_t>& encoded) const
+{
+    VertexDequantization dequantization;
+    encoded.assign(vertices.size() * stride_, 0);
+
+    if (format_ != VertexFormat::Float32 && !vertices.empty())
+    {
+        glm::vec3 minimum = vertices[0].pos;
+        glm::vec3 maximum = vertices[0].pos;
+        for (const Vertex& vertex : vertices)
+        {
+            minimum = glm::min(minimum, vertex.pos);
+            maximum = glm::max(maximum, vertex.pos);
+        }
+
+        // Centring keeps half floats precise for meshes placed far from the origin. Normalised positions are
+        // also stretched over the full range on every axis, flat axes keep a scale of one to avoid dividing by zero
+        dequantization.offset = (minimum + maximum) * 0.5f;
+        if (format_ == VertexFormat::Snorm16)
+        {
+            glm::vec3 halfExtent = (maximum - minimum) * 0.5f;
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                dequantization.scale[axis] = halfExtent[axis] > 0.0f ? halfExtent[axis] : 1.0f;
+            }
+        }
+    }
+
+    for (size_t i = 0; i < vertices.size(); ++i)
+    {
+        const Vertex& vertex = vertices[i];
+        uint8_t* destination = encoded.data() + i * stride_;
+
+        if (format_ == VertexFormat::Float32)
+        {
+            std::memcpy(destination, &vertex.pos, FLOAT32_POSITION_SIZE);
+            std::memcpy(destination + colourOffset_, &vertex.col, FLOAT32_COLOUR_SIZE);
+        }
+        else
+        {
+            glm::vec3 stored = (vertex.pos - dequantization.offset) / dequantization.scale;
+
+            uint16_t position[4] = {};
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                position[axis] = format_ == VertexFormat::Snorm16 ? (uint16_t)PackSnorm16(stored[axis])
+                    : glm::packHalf1x16(stored[axis]);
+            }
+            std::memcpy(destination, position, PACKED_POSITION_SIZE);
+
+            uint32_t colour = glm::packUnorm4x8(glm::vec4(glm::clamp(vertex.col, 0.0f, 1.0f), 1.0f));
+            std::memcpy(destination + colourOffset_, &colour, PACKED_COLOUR_SIZE);
+        }
+
+        if (normals_)
+        {
+            uint32_t normal = glm::packSnorm2x16(EncodeOctahedral(vertex.normal));
+            std::memcpy(destination + normalOffset_, &normal, PACKED_NORMAL_SIZE);
+        }
+    }
+
+    return dequantization;
+}
+
+glm::vec2 VertexLayout::EncodeOctahedral(const glm::vec3& normal)
+{
+    float sum = std::fabs(normal.x) + std::fabs(normal.y) + std::fabs(normal.z);
+    if (sum == 0.0f)
+    {
+        return glm::vec2(0.0f, 0.0f);
+    }
+
+    // Project onto the octahedron, then fold the lower hemisphere over the diagonals
+    glm::vec2 projected(normal.x / sum, normal.y / sum);
+    if (normal.z < 0.0f)
+    {
+        glm::vec2 folded((1.0f - std::fabs(projected.y)) * (projected.x >= 0.0f ? 1.0f : -1.0f),
+            (1.0f - std::fabs(projected.x)) * (projected.y >= 0.0f ? 1.0f : -1.0f));
+        projected = folded;
+    }
+
+    return projected;
+}
@@ -0,0 +1,69 @@
+#pragma once
+#ifndef VERTEX_LAYOUT_H
+#define VERTEX_LAYOUT_H
+
+#include <glm/glm.hpp>
+#include <vulkan/vulkan.h>
+#include <vector>
+
+// Vertex as meshes are authored. It is converted into the renderer's VertexLayout before it is uploaded
+struct Vertex
+{
+    glm::vec3 pos;
+    glm::vec3 col;
+    glm::vec3 normal = glm::vec3(0.0f, 0.0f, 1.0f);
+};
+
+// How positions are stored on the GPU. The compact formats also pack colours into RGBA8
+enum class VertexFormat
+{
+    // 32-bit float position and colour, 24 bytes per vertex
+    Float32,
+
+    // 16-bit normalised position scaled to the mesh's bounds, 12 bytes per vertex
+    Snorm16,
+
+    // Half float position relative to the mesh's centre, 12 bytes per vertex
+    Float16,
+};
+
+// Maps a stored position back into model space: position = offset + scale * stored
+struct VertexDequantization
+{
+    glm::vec3 scale = glm::vec3(1.0f);
+    glm::vec3 offset = glm::vec3(0.0f);
+};
+
+// Describes how vertices are laid out in the geometry pool and generates the matching vertex input state.
+// Normals are optional and stored octahedral encoded in two 16-bit normalised components
+class VertexLayout
+{
+public:
+    // Attribute locations of the vertex binding. The instance attributes occupy locations 2 to 6
+    static constexpr uint32_t POSITION_LOCATION = 0;
+    static constexpr uint32_t COLOUR_LOCATION = 1;
+    static constexpr uint32_t NORMAL_LOCATION = 7;
+
+    VertexLayout(VertexFormat format = VertexFormat::Float32, bool normals = false);
+
+    VertexFormat GetFormat() const { return format_; }
+    bool HasNormals() const { return normals_; }
+    uint32_t GetStride() const { return stride_; }
+
+    std::vector<VkVertexInputAttributeDescription> GetAttributeDescriptions(uint32_t binding) const;
+
+    // Converts the vertices into this layout, GetStride() bytes each. Returns how to undo the quantisation
+    VertexDequantization Encode(const std::vector<Vertex>& vertices, std::vector<uint8_t>& encoded) const;
+
+    // Maps a unit vector onto the [-1, 1] square of an octahedron unfolded into the plane
+    static glm::vec2 EncodeOctahedral(const glm::vec3& normal);
+
+private:
+    VertexFormat format_;
+    bool normals_;
+
+    uint32_t stride_;
+    uint32_t colourOffset_;
+    uint32_t normalOffset_;
+};
+#endif // VERTEX_LAYOUT_H
@@ -1,27 +1,398 @@
 #include "renderer.h"
+#include "FramePacer.h"
+#include "MeshImporter.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+#include "RendererBenchmark.h"
 #include "p3d_window.h"
 
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
+#include <string>
 
-int main()
+// Maps a --present-mode value onto the Vulkan presentation mode
+static VkPresentModeKHR ParsePresentMode(const std::string& name)
 {
-    try 
+    if (name == "fifo")
     {
+        return VK_PRESENT_MODE_FIFO_KHR;
+    }
+    else if (name == "fifo_relaxed")
+    {
+        return VK_PRESENT_MODE_FIFO_RELAXED_KHR;
+    }
+    else if (name == "mailbox")
+    {
+        return VK_PRESENT_MODE_MAILBOX_KHR;
+    }
+    else if (name == "immediate")
+    {
+        return VK_PRESENT_MODE_IMMEDIATE_KHR;
+    }
+
+    throw std::runtime_error("Unknown presentation mode: " + name);
+}
+
+// Maps a --vertex-format value onto the vertex storage format
+static VertexFormat ParseVertexFormat(const std::string& name)
+{
+    if (name == "float32")
+    {
+        return VertexFormat::Float32;
+    }
+    else if (name == "snorm16")
+    {
+        return VertexFormat::Snorm16;
+    }
+    else if (name == "float16")
+    {
+        return VertexFormat::Float16;
+    }
+
+    throw std::runtime_error("Unknown vertex format: " + name);
+}
+
+// Writes an RGBA8 image as a binary PPM, dropping the alpha channel
+static void WritePPM(const std::string& filename, const std::vector<uint8_t>& pixels, uint32_t width, uint32_t height)
+{
+    std::ofstream file(filename, std::ios::binary);
+    if (!file.is_open())
+    {
+        throw std::runtime_error("Failed to open file: " + filename);
+    }
+
+    file << "P6\n" << width << " " << height << "\n255\n";
+    for (size_t i = 0; i < (size_t)width * height; ++i)
+    {
+        file.write(reinterpret_cast<const char*>(&pixels[i * 4]), 3);
+    }
+}
+
+// Where the scene's meshes come from besides the built-in ones
+struct SceneFiles
+{
+    // Mesh files, streamed to the device as they are stored
+    std::vector<std::string> meshFiles;
+
+    // OBJ and glTF files, parsed on every hardware thread
+    std::vector<std::string> importFiles;
+};
+
+static std::vector<ImportedMesh> ImportMeshes(const std::vector<std::string>& paths)
+{
+    auto start = std::chrono::steady_clock::now();
+    ThreadPool threadPool;
+    std::vector<ImportedMesh> meshes = MeshImporter(threadPool).Import(paths);
+    auto end = std::chrono::steady_clock::now();
+
+    std::cout << "Imported " << meshes.size() << " meshes from " << paths.size() << " files in "
+        << std::chrono::duration<double>(end - start).count() << "s on " << threadPool.GetThreadCount()
+        << " threads" << std::endl;
+    return meshes;
+}
+
+// Adds every mesh file and imported file to the scene and reports how long streaming them to the device took
+static void LoadScene(p3d::Renderer& renderer, const SceneFiles& sceneFiles)
+{
+    if (!sceneFiles.importFiles.empty())
+    {
+        for (const ImportedMesh& mesh : ImportMeshes(sceneFiles.importFiles))
+        {
+            if (!mesh.indices.empty())
+            {
+                renderer.AddInstancedMesh(mesh.vertices, mesh.indices);
+            }
+        }
+    }
+
+    if (sceneFiles.meshFiles.empty())
+    {
+        return;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    uint64_t bytes = 0;
+    for (const std::string& path : sceneFiles.meshFiles)
+    {
+        renderer.AddMeshFile(path);
+        bytes += std::filesystem::file_size(path);
+    }
+    renderer.WaitIdle();
+    auto end = std::chrono::steady_clock::now();
+
+    double seconds = std::chrono::duration<double>(end - start).count();
+    std::cout << "Loaded " << sceneFiles.meshFiles.size() << " mesh files (" << bytes / (1024.0 * 1024.0)
+        << " MiB) in " << seconds << "s (" << (seconds > 0.0 ? bytes / (1024.0 * 1024.0) / seconds : 0.0)
+        << " MiB/s)" << std::endl;
+}
+
+// Imports OBJ and glTF files and writes every mesh as a mesh file for the given geometry config
+static void ConvertMeshes(const std::vector<std::string>& importFiles, const p3d::GeometryConfig& geometryConfig,
+    const std::string& outputDirectory)
+{
+    VertexLayout layout(geometryConfig.vertexFormat, geometryConfig.vertexNormals);
+    std::filesystem::create_directories(outputDirectory);
+
+    for (ImportedMesh& mesh : ImportMeshes(importFiles))
+    {
+        if (geometryConfig.optimizeMeshes)
+        {
+            MeshOptimizer::Optimize(mesh.vertices, mesh.indices);
+        }
+
+        std::vector<MeshLod> lods;
+        if (geometryConfig.generateLods)
+        {
+            lods = MeshSimplifier::GenerateLods(mesh.vertices, mesh.indices);
+        }
+
+        // Mesh names come from the files and may hold characters that are not valid in a file name
+        std::string fileName = mesh.name;
+        std::replace_if(fileName.begin(), fileName.end(),
+            [](unsigned char c) { return !std::isalnum(c) && c != '-' && c != '_'; }, '_');
+
+        std::string path = (std::filesystem::path(outputDirectory) / (fileName + ".p3dm")).string();
+        MeshFile::Write(path, layout, mesh.vertices, mesh.indices, lods);
+        std::cout << "Wrote " << path << std::endl;
+    }
+}
+
+// Renders a fixed number of frames without a window and reports the frame throughput
+static void RunHeadless(const p3d::HeadlessConfig& config, const p3d::PresentationConfig& presentationConfig,
+    const p3d::GeometryConfig& geometryConfig, const SceneFiles& sceneFiles, uint32_t frameCount,
+    const std::string& readbackFile, const std::string& profileFile)
+{
+    p3d::Renderer renderer(config, presentationConfig, geometryConfig);
+    LoadScene(renderer, sceneFiles);
+    if (!profileFile.empty())
+    {
+        renderer.SetProfileOutput(profileFile);
+    }
+
+    // Use a fixed time step so that every run renders the same frames
+    const float deltaTime = 1.0f / 60.0f;
+
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < frameCount; ++i)
+    {
+        renderer.Render(deltaTime);
+    }
+    renderer.WaitIdle();
+    auto end = std::chrono::steady_clock::now();
+
+    double seconds = std::chrono::duration<double>(end - start).count();
+    std::cout << "Rendered " << frameCount << " frames in " << seconds << "s ("
+        << (seconds > 0.0 ? frameCount / seconds : 0.0) << " frames/s)" << std::endl;
+    renderer.GetMemoryAllocator().PrintStats();
+
+    if (!readbackFile.empty())
+    {
+        WritePPM(readbackFile, renderer.ReadbackImage(), config.width, config.height);
+    }
+}
+
+// Runs the microbenchmarks on a headless renderer and writes their results to outputFile
+static void RunBenchmarks(const p3d::HeadlessConfig& config, const p3d::GeometryConfig& geometryConfig,
+    const p3d::BenchmarkConfig& benchmarkConfig, const std::string& outputFile)
+{
+    p3d::Renderer renderer(config, {}, geometryConfig);
+    p3d::RendererBenchmark benchmark(renderer, benchmarkConfig);
+
+    std::vector<p3d::BenchmarkResult> results = benchmark.Run();
+    p3d::RendererBenchmark::WriteResults(results, outputFile);
+    std::cout << "Wrote " << results.size() << " benchmark results to " << outputFile << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+    bool headless = false;
+    uint32_t frameCount = 1000;
+    std::string readbackFile;
+    std::string profileFile;
+    p3d::HeadlessConfig headlessConfig;
+    p3d::PresentationConfig presentationConfig;
+    std::string presentMode;
+    p3d::GeometryConfig geometryConfig;
+    std::string vertexFormat;
+    double targetFrameRate = 0.0;
+    SceneFiles sceneFiles;
+    std::string convertDirectory;
+
+    bool benchmark = false;
+    std::string benchmarkFile = "benchmark_results.csv";
+    p3d::BenchmarkConfig benchmarkConfig;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if (arg == "--headless")
+        {
+            headless = true;
+        }
+        else if (arg == "--frames" && hasValue)
+        {
+            frameCount = (uint32_t)std::stoul(argv[++i]);
+        }
+        else if (arg == "--width" && hasValue)
+        {
+            headlessConfig.width = (uint32_t)std::stoul(argv[++i]);
+        }
+        else if (arg == "--height" && hasValue)
+        {
+            headlessConfig.height = (uint32_t)std::stoul(argv[++i]);
+        }
+        else if (arg == "--readback" && hasValue)
+        {
+            readbackFile = argv[++i];
+            headlessConfig.enableReadback = true;
+        }
+        else if (arg == "--profile" && hasValue)
+        {
+            profileFile = argv[++i];
+        }
+        else if (arg == "--present-mode" && hasValue)
+        {
+            presentMode = argv[++i];
+        }
+        else if (arg == "--swapchain-images" && hasValue)
+        {
+            presentationConfig.swapchainImageCount = (uint32_t)std::stoul(argv[++i]);
+        }
+        else if (arg == "--frames-in-flight" && hasValue)
+        {
+            presentationConfig.framesInFlight = (uint32_t)std::stoul(argv[++i]);
+        }
+        else if (arg == "--fps" && hasValue)
+        {
+            targetFrameRate = std::stod(argv[++i]);
+        }
+        else if (arg == "--vertex-format" && hasValue)
+        {
+            vertexFormat = argv[++i];
+        }
+        else if (arg == "--vertex-normals")
+        {
+            geometryConfig.vertexNormals = true;
+        }
+        else if (arg == "--optimize-meshes")
+        {
+            geometryConfig.optimizeMeshes = true;
+        }
+        else if (arg == "--gpu-culling")
+        {
+            geometryConfig.gpuCulling = true;
+        }
+        else if (arg == "--lods")
+        {
+            geometryConfig.generateLods = true;
+        }
+        else if (arg == "--lod-pixel-error" && hasValue)
+        {
+            geometryConfig.lodPixelError = std::stof(argv[++i]);
+        }
+        else if (arg == "--mesh" && hasValue)
+        {
+            sceneFiles.meshFiles.push_back(argv[++i]);
+        }
+        else if (arg == "--import" && hasValue)
+        {
+            sceneFiles.importFiles.push_back(argv[++i]);
+        }
+        else if (arg == "--convert-to" && hasValue)
+        {
+            convertDirectory = argv[++i];
+        }
+        else if (arg == "--benchmark")
+        {
+            benchmark = true;
+        }
+        else if (arg == "--benchmark-output" && hasValue)
+        {
+            benchmarkFile = argv[++i];
+        }
+        else if (arg == "--benchmark-filter" && hasValue)
+        {
+            benchmarkConfig.filter = argv[++i];
+        }
+        else if (arg == "--repetitions" && hasValue)
+        {
+            benchmarkConfig.repetitions = (uint32_t)std::stoul(argv[++i]);
+        }
+        else
+        {
+            std::cerr << "Unknown argument: " << arg << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    try
+    {
+        if (!presentMode.empty())
+        {
+            presentationConfig.presentMode = ParsePresentMode(presentMode);
+        }
+        if (!vertexFormat.empty())
+        {
+            geometryConfig.vertexFormat = ParseVertexFormat(vertexFormat);
+        }
+
+        if (!convertDirectory.empty())
+        {
+            ConvertMeshes(sceneFiles.importFiles, geometryConfig, convertDirectory);
+            return EXIT_SUCCESS;
+        }
+
+        if (benchmark)
+        {
+            RunBenchmarks(headlessConfig, geometryConfig, benchmarkConfig, benchmarkFile);
+            return EXIT_SUCCESS;
+        }
+
+        if (headless)
+        {
+            RunHeadless(headlessConfig, presentationConfig, geometryConfig, sceneFiles, frameCount, readbackFile,
+                profileFile);
+            return EXIT_SUCCESS;
+        }
+
         p3d::Window window{ 1024, 768, "Potato 3d" };
-        p3d::Renderer renderer(window.GetWindow());
+        p3d::Renderer renderer(window.GetWindow(), presentationConfig, geometryConfig);
+        LoadScene(renderer, sceneFiles);
+        FramePacer pacer(targetFrameRate);
+        if (!profileFile.empty())
+        {
+            renderer.SetProfileOutput(profileFile);
+        }
 
         float deltaTime = 0.0f, prevTime = 0.0f;
 
         while (!window.ShouldClose())
         {
+            // Waiting before polling keeps the input used for the frame as fresh as possible
+            pacer.Wait();
             glfwPollEvents();
 
+            if (window.WasResized())
+            {
+                renderer.NotifyFramebufferResized();
+                window.ResetResizedFlag();
+            }
+
             float now = (float)glfwGetTime();
             deltaTime = now - prevTime;
             prevTime = now;
 
             renderer.Render(deltaTime);
         }
+
+        // Lets the frames still in flight finish so that they are profiled too
+        renderer.WaitIdle();
     }
     catch (const std::exception &e)
     {
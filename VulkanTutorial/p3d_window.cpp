@@ -17,8 +17,16 @@ namespace p3d
     {
         glfwInit();
         glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
-        glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
+        glfwWindowHint(GLFW_RESIZABLE, GLFW_TRUE);
 
         window_ = glfwCreateWindow(width_, height_, window_name_.c_str(), nullptr, nullptr);
+        glfwSetWindowUserPointer(window_, this);
+        glfwSetFramebufferSizeCallback(window_, FramebufferResizeCallback);
+    }
+
+    void Window::FramebufferResizeCallback(GLFWwindow* window, int, int)
+    {
+        Window* owner = static_cast<Window*>(glfwGetWindowUserPointer(window));
+        owner->framebufferResized_ = true;
     }
 }  // namespace p3d 
\ No newline at end of file
@@ -19,15 +19,22 @@ namespace p3d
 
         bool ShouldClose() { return glfwWindowShouldClose(window_); }
 
+        // Set by GLFW whenever the framebuffer changes size, cleared by the caller once handled
+        bool WasResized() const { return framebufferResized_; }
+        void ResetResizedFlag() { framebufferResized_ = false; }
+
         GLFWwindow* GetWindow() { return window_; }
 
     private:
         void InitWindow();
 
+        static void FramebufferResizeCallback(GLFWwindow* window, int width, int height);
+
         const int width_;
         const int height_;
 
         std::string window_name_;
         GLFWwindow* window_;
+        bool framebufferResized_ = false;
     };
 }
\ No newline at end of file
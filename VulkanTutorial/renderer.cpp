@@ -1,14 +1,135 @@
 #include "renderer.h"
+#include "MeshOptimizer.h"
 #include <functional>
 #include <iostream>
 #include <set>
 #include <stdio.h>
 #include <vector>
+#include <algorithm>
 #include <array>
+#include <chrono>
+#include <cstring>
+#include <limits>
 
 namespace p3d
 {
-    const int MAX_FRAME_DRAWS = 3;
+    // Space reserved in the uniform ring for each frame's constants
+    const VkDeviceSize UNIFORM_RING_FRAME_SIZE = 64 * 1024;
+
+    // Capacity of the shared geometry buffers, in vertices and indices
+    const uint32_t GEOMETRY_POOL_VERTEX_CAPACITY = 1024 * 1024;
+    const uint32_t GEOMETRY_POOL_INDEX_CAPACITY = 3 * 1024 * 1024;
+
+    // Capacity of the shared instance buffer, in instances
+    const uint32_t INSTANCE_POOL_CAPACITY = 64 * 1024;
+
+    // Draws recorded per secondary command buffer before another recording thread is worth using
+    const uint32_t MIN_DRAWS_PER_RECORDING_TASK = 64;
+
+    // Written next to the executable's working directory
+    const char* PIPELINE_CACHE_PATH = "pipeline_cache.bin";
+
+    // A coarser level of detail is only switched to once its error is this much below the threshold, so that
+    // an object resting near a switching distance does not alternate between two levels
+    const float LOD_HYSTERESIS = 0.25f;
+
+    // Objects the GPU culling buffers are sized for, each draw list can hold all of them
+    const uint32_t GPU_CULLING_OBJECT_CAPACITY = 128 * 1024;
+
+    // Must match local_size_x in Shaders/cull.comp
+    const uint32_t CULL_GROUP_SIZE = 64;
+
+    // Depth formats in order of preference. Stencil is never used, so the formats without it come first
+    const VkFormat DEPTH_FORMAT_CANDIDATES[] = { VK_FORMAT_D32_SFLOAT, VK_FORMAT_X8_D24_UNORM_PACK32,
+        VK_FORMAT_D24_UNORM_S8_UINT, VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D16_UNORM };
+
+    // Where the parts of a frame's draw buffer start. Every part is bound as a storage buffer of its own
+    struct DrawBufferLayout
+    {
+        VkDeviceSize countsOffset = 0;
+        VkDeviceSize commandsOffset = 0;
+        VkDeviceSize objectIdsOffset = 0;
+        VkDeviceSize size = 0;
+    };
+
+    static VkDeviceSize AlignUp(VkDeviceSize value, VkDeviceSize alignment)
+    {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    static DrawBufferLayout GetDrawBufferLayout(VkDeviceSize storageAlignment, uint32_t listCount)
+    {
+        VkDeviceSize drawCount = (VkDeviceSize)GPU_CULLING_OBJECT_CAPACITY * listCount;
+
+        DrawBufferLayout layout;
+        layout.countsOffset = 0;
+        layout.commandsOffset = AlignUp(listCount * sizeof(uint32_t), storageAlignment);
+        layout.objectIdsOffset = AlignUp(layout.commandsOffset + drawCount * sizeof(VkDrawIndexedIndirectCommand),
+            storageAlignment);
+        layout.size = layout.objectIdsOffset + drawCount * sizeof(uint32_t);
+        return layout;
+    }
+
+    // Coarsest level of the mesh whose error stays within maxPixels on screen. Errors grow with every level
+    static uint32_t GetCoarsestLodWithin(Mesh& mesh, float pixelsPerModelUnit, float maxPixels)
+    {
+        uint32_t lod = 0;
+        while (lod + 1 < mesh.GetLodCount() && mesh.GetLodError(lod + 1) * pixelsPerModelUnit <= maxPixels)
+        {
+            ++lod;
+        }
+        return lod;
+    }
+
+    // Maps a float onto an unsigned integer with the same order, negative values included
+    static uint32_t GetOrderedFloatBits(float value)
+    {
+        uint32_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        return (bits & 0x80000000u) ? ~bits : bits | 0x80000000u;
+    }
+
+    static bool HasStencilComponent(VkFormat format)
+    {
+        return format == VK_FORMAT_D24_UNORM_S8_UINT || format == VK_FORMAT_D32_SFLOAT_S8_UINT;
+    }
+
+    static const char* GetDepthFormatName(VkFormat format)
+    {
+        switch (format)
+        {
+        case VK_FORMAT_D32_SFLOAT:
+            return "D32_SFLOAT";
+        case VK_FORMAT_X8_D24_UNORM_PACK32:
+            return "X8_D24_UNORM";
+        case VK_FORMAT_D24_UNORM_S8_UINT:
+            return "D24_UNORM_S8_UINT";
+        case VK_FORMAT_D32_SFLOAT_S8_UINT:
+            return "D32_SFLOAT_S8_UINT";
+        case VK_FORMAT_D16_UNORM:
+            return "D16_UNORM";
+        default:
+            return "UNKNOWN";
+        }
+    }
+
+    static bool IsDeviceExtensionAvailable(VkPhysicalDevice device, const char* extensionName)
+    {
+        uint32_t extensionCount = 0;
+        vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
+        std::vector<VkExtensionProperties> extensions(extensionCount);
+        vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, extensions.data());
+
+        for (const VkExtensionProperties& extension : extensions)
+        {
+            if (strcmp(extension.extensionName, extensionName) == 0)
+            {
+                return true;
+            }
+        }
+
+        return false;
+    }
 
 #ifdef VALIDATION_LAYERS_ENABLED 
     static VkResult CreateDebugReportCallbackEXT(VkInstance instance, const VkDebugReportCallbackCreateInfoEXT* pCreateInfo,
@@ -142,11 +263,15 @@ namespace p3d
         createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
         createInfo.pApplicationInfo = &appInfo;
 
-        // Retrieve list of extensions required by glfw
-        uint32_t glfwExtensionCount = 0;
-        const char** glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+        std::vector<const char*> requiredExtensions;
 
-        std::vector<const char*> requiredExtensions(glfwExtensions, glfwExtensions + glfwExtensionCount);
+        // Retrieve list of extensions required by glfw. Headless rendering never creates a surface.
+        if (!headless_)
+        {
+            uint32_t glfwExtensionCount = 0;
+            const char** glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+            requiredExtensions.assign(glfwExtensions, glfwExtensions + glfwExtensionCount);
+        }
 
 #ifdef VALIDATION_LAYERS_ENABLED
         requiredExtensions.push_back(VK_EXT_DEBUG_REPORT_EXTENSION_NAME);
@@ -190,14 +315,22 @@ namespace p3d
                 indices.graphicsFamily = i;
             }
 
-            // Check if Queue Family supports presentation
-            VkBool32 presentationSupport = false;
-            vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface_, &presentationSupport);
+            if (surface_ != VK_NULL_HANDLE)
+            {
+                // Check if Queue Family supports presentation
+                VkBool32 presentationSupport = false;
+                vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface_, &presentationSupport);
 
-            // Check if queue is presentation type (can be both graphics and presentation)
-            if (queueFamily.queueCount > 0 && presentationSupport)
+                // Check if queue is presentation type (can be both graphics and presentation)
+                if (queueFamily.queueCount > 0 && presentationSupport)
+                {
+                    indices.presentationFamily = i;
+                }
+            }
+            else if (indices.graphicsFamily.has_value())
             {
-                indices.presentationFamily = i;
+                // Nothing is presented when running headless, so the graphics queue stands in
+                indices.presentationFamily = indices.graphicsFamily;
             }
 
             if (indices.AreValid())
@@ -206,6 +339,34 @@ namespace p3d
             }
         }
 
+        // Prefer a family that can only transfer, these usually map to the copy engines and let uploads
+        // run alongside rendering. Fall back to any non-graphics family that can transfer
+        for (uint32_t i = 0; i < queueFamilyCount; ++i)
+        {
+            VkQueueFlags flags = queueFamilyList[i].queueFlags;
+            if (queueFamilyList[i].queueCount == 0 || !(flags & VK_QUEUE_TRANSFER_BIT) || (flags & VK_QUEUE_GRAPHICS_BIT))
+            {
+                continue;
+            }
+
+            if (!(flags & VK_QUEUE_COMPUTE_BIT))
+            {
+                indices.transferFamily = i;
+                break;
+            }
+
+            if (!indices.transferFamily.has_value())
+            {
+                indices.transferFamily = i;
+            }
+        }
+
+        // Graphics queues always support transfers, even when they do not advertise it
+        if (!indices.transferFamily.has_value())
+        {
+            indices.transferFamily = indices.graphicsFamily;
+        }
+
         return indices;
     }
 
@@ -299,12 +460,12 @@ namespace p3d
             
             bool extensionsSupported = CheckDeviceExtensionSupport(device);
 
-            if (extensionsSupported)
+            if (extensionsSupported && !headless_)
             {
                 swapChainDetails_ = GetSwapChainDetails(device);
             }
 
-            if (indices.AreValid() && extensionsSupported && swapChainDetails_.IsValid())
+            if (indices.AreValid() && extensionsSupported && (headless_ || swapChainDetails_.IsValid()))
             {
                 physicalDevice_ = device;
                 queueFamilyIndices_ = indices;
@@ -323,32 +484,90 @@ namespace p3d
         // Use a set to ensure that each index is unique. This is important because the same queue can
         // be used for both graphics and presentation
         std::set<uint32_t> queueFamilyIndices = { *(queueFamilyIndices_.graphicsFamily),
-            *(queueFamilyIndices_.presentationFamily) };
+            *(queueFamilyIndices_.presentationFamily), *(queueFamilyIndices_.transferFamily) };
         
+        // Must outlive vkCreateDevice, the create infos only point at it
+        const float queuePriority = 1.0f;
+
         std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
         // Queues the logical device needs to create and info to do so
         for (uint32_t queueFamilyIndex : queueFamilyIndices)
         {
             VkDeviceQueueCreateInfo queueCreateInfo{};
             queueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
-            queueCreateInfo.queueFamilyIndex = *(queueFamilyIndices_.graphicsFamily);
+            queueCreateInfo.queueFamilyIndex = queueFamilyIndex;
             queueCreateInfo.queueCount = 1;
-            float queuePriority = 1.0f;
             queueCreateInfo.pQueuePriorities = &queuePriority;
 
             queueCreateInfos.push_back(queueCreateInfo);
         }
 
-        VkPhysicalDeviceFeatures deviceFeatures{};
+        VkPhysicalDeviceFeatures supportedFeatures{};
+        vkGetPhysicalDeviceFeatures(physicalDevice_, &supportedFeatures);
+
+        // Pipeline statistics are optional, they are only collected when secondary command buffers can
+        // inherit the query, since all draws are recorded into those
+        enabledFeatures_ = {};
+        if (supportedFeatures.pipelineStatisticsQuery && supportedFeatures.inheritedQueries)
+        {
+            enabledFeatures_.pipelineStatisticsQuery = VK_TRUE;
+            enabledFeatures_.inheritedQueries = VK_TRUE;
+        }
 
         VkDeviceCreateInfo createInfo{};
         createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
         createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
         createInfo.pQueueCreateInfos = queueCreateInfos.data();
-        createInfo.pEnabledFeatures = &deviceFeatures;
-        createInfo.enabledExtensionCount = 0;
-        createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
-        createInfo.ppEnabledExtensionNames = deviceExtensions.data();
+        createInfo.pEnabledFeatures = &enabledFeatures_;
+        // The swapchain extension is only needed when presenting to a surface
+        std::vector<const char*> enabledExtensions;
+        if (!headless_)
+        {
+            enabledExtensions = deviceExtensions;
+        }
+
+        // Optional, only used to report pipeline cache hits
+        pipelineFeedbackSupported_ = IsDeviceExtensionAvailable(physicalDevice_,
+            VK_EXT_PIPELINE_CREATION_FEEDBACK_EXTENSION_NAME);
+        if (pipelineFeedbackSupported_)
+        {
+            enabledExtensions.push_back(VK_EXT_PIPELINE_CREATION_FEEDBACK_EXTENSION_NAME);
+        }
+
+        // GPU culling finds each draw's object through gl_DrawIDARB, and issues many indirect draws at once
+        // that start at the object's first instance
+        bool drawIndirectCountSupported = false;
+        if (gpuCulling_)
+        {
+            VkPhysicalDeviceProperties deviceProperties;
+            vkGetPhysicalDeviceProperties(physicalDevice_, &deviceProperties);
+
+            if (!IsDeviceExtensionAvailable(physicalDevice_, VK_KHR_SHADER_DRAW_PARAMETERS_EXTENSION_NAME) ||
+                !supportedFeatures.multiDrawIndirect || !supportedFeatures.drawIndirectFirstInstance ||
+                deviceProperties.limits.maxDrawIndirectCount < GPU_CULLING_OBJECT_CAPACITY)
+            {
+                std::printf("GPU culling is not supported by this device, culling on the CPU instead\n");
+                gpuCulling_ = false;
+            }
+        }
+
+        if (gpuCulling_)
+        {
+            enabledFeatures_.multiDrawIndirect = VK_TRUE;
+            enabledFeatures_.drawIndirectFirstInstance = VK_TRUE;
+            enabledExtensions.push_back(VK_KHR_SHADER_DRAW_PARAMETERS_EXTENSION_NAME);
+
+            // Optional, lets the draws stop at the number of visible objects
+            drawIndirectCountSupported = IsDeviceExtensionAvailable(physicalDevice_,
+                VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+            if (drawIndirectCountSupported)
+            {
+                enabledExtensions.push_back(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+            }
+        }
+
+        createInfo.enabledExtensionCount = static_cast<uint32_t>(enabledExtensions.size());
+        createInfo.ppEnabledExtensionNames = enabledExtensions.empty() ? nullptr : enabledExtensions.data();
         
         VkResult result = vkCreateDevice(physicalDevice_, &createInfo, nullptr, 
             &logicalDevice_);
@@ -359,6 +578,13 @@ namespace p3d
 
         vkGetDeviceQueue(logicalDevice_, *(queueFamilyIndices_.graphicsFamily), 0, &graphicsQueue_);
         vkGetDeviceQueue(logicalDevice_, *(queueFamilyIndices_.presentationFamily), 0, &presentationQueue_);
+        vkGetDeviceQueue(logicalDevice_, *(queueFamilyIndices_.transferFamily), 0, &transferQueue_);
+
+        if (drawIndirectCountSupported)
+        {
+            drawIndexedIndirectCount_ = (PFN_vkCmdDrawIndexedIndirectCountKHR)vkGetDeviceProcAddr(logicalDevice_,
+                "vkCmdDrawIndexedIndirectCountKHR");
+        }
     }
 
     void Renderer::CreateSurface(GLFWwindow* window)
@@ -391,18 +617,36 @@ namespace p3d
         return formats[0];
     }
     
-    VkPresentModeKHR ChooseBestPresentationMode(const std::vector<VkPresentModeKHR> presentationModes)
+    static const char* GetPresentModeName(VkPresentModeKHR presentMode)
+    {
+        switch (presentMode)
+        {
+        case VK_PRESENT_MODE_IMMEDIATE_KHR:
+            return "IMMEDIATE";
+        case VK_PRESENT_MODE_MAILBOX_KHR:
+            return "MAILBOX";
+        case VK_PRESENT_MODE_FIFO_KHR:
+            return "FIFO";
+        case VK_PRESENT_MODE_FIFO_RELAXED_KHR:
+            return "FIFO_RELAXED";
+        default:
+            return "UNKNOWN";
+        }
+    }
+
+    VkPresentModeKHR ChooseBestPresentationMode(const std::vector<VkPresentModeKHR> presentationModes,
+        VkPresentModeKHR requestedMode)
     {
-        // Look for Mailbox presentation mode
         for (const auto &presentationMode : presentationModes)
         {
-            if (presentationMode == VK_PRESENT_MODE_MAILBOX_KHR)
+            if (presentationMode == requestedMode)
             {
                 return presentationMode;
             }
         }
     
         // If can't find, use FIFO as Vulkan spec says it must be present
+        printf("Presentation mode %s is not supported, falling back to FIFO\n", GetPresentModeName(requestedMode));
         return VK_PRESENT_MODE_FIFO_KHR;
     }
     
@@ -443,7 +687,8 @@ namespace p3d
 
         VkSurfaceFormatKHR surfaceFormat = ChooseBestSurfaceFormat(swapChainDetails_.formats);
         selectedSwapChainImageFormat_ = surfaceFormat.format;
-        VkPresentModeKHR presentMode = ChooseBestPresentationMode(swapChainDetails_.presentationModes);
+        VkPresentModeKHR presentMode = ChooseBestPresentationMode(swapChainDetails_.presentationModes,
+            presentationConfig_.presentMode);
         selectedSwapChainExtent_ = ChooseSwapExtent(swapChainDetails_.surfaceCapabilities, window);
 
         VkSwapchainCreateInfoKHR swapChainCreateInfo = {};
@@ -459,9 +704,16 @@ namespace p3d
         swapChainCreateInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
         swapChainCreateInfo.clipped = VK_TRUE;
 
-        uint32_t imageCount = swapChainDetails_.surfaceCapabilities.minImageCount + 1;
+        // One image more than the minimum unless configured otherwise. A max of zero means there is no limit
+        uint32_t minImageCount = swapChainDetails_.surfaceCapabilities.minImageCount;
         uint32_t maxImageCount = swapChainDetails_.surfaceCapabilities.maxImageCount;
-        imageCount = std::max(imageCount, maxImageCount > 0 ? maxImageCount : imageCount);
+        uint32_t imageCount = presentationConfig_.swapchainImageCount > 0 ? presentationConfig_.swapchainImageCount
+            : minImageCount + 1;
+        imageCount = std::max(imageCount, minImageCount);
+        if (maxImageCount > 0)
+        {
+            imageCount = std::min(imageCount, maxImageCount);
+        }
         swapChainCreateInfo.minImageCount = imageCount;
 
         // Swapchain images must be shared between families when graphics/presentation indices are different
@@ -483,8 +735,9 @@ namespace p3d
             swapChainCreateInfo.pQueueFamilyIndices = nullptr;
         }
 
-        // If old swap chain is no longer valid, then set to null handle
-        swapChainCreateInfo.oldSwapchain = VK_NULL_HANDLE;
+        // Handing over the swap chain being replaced lets the implementation reuse its resources
+        VkSwapchainKHR oldSwapchain = swapchain_;
+        swapChainCreateInfo.oldSwapchain = oldSwapchain;
 
         VkResult result = vkCreateSwapchainKHR(logicalDevice_, &swapChainCreateInfo, nullptr, &swapchain_);
         if (result != VK_SUCCESS)
@@ -492,6 +745,14 @@ namespace p3d
             throw std::runtime_error("Failed to create a Swapchain!");
         }
 
+        // The old swap chain is retired by the call above, whatever it still presents is unaffected
+        if (oldSwapchain != VK_NULL_HANDLE)
+        {
+            vkDestroySwapchainKHR(logicalDevice_, oldSwapchain, nullptr);
+        }
+
+        swapChainImages_.clear();
+
         uint32_t swapChainImageCount;
         vkGetSwapchainImagesKHR(logicalDevice_, swapchain_, &swapChainImageCount, nullptr);
         std::vector<VkImage> images(swapChainImageCount);
@@ -505,9 +766,243 @@ namespace p3d
         }
     }
 
+    void Renderer::CreateOffscreenTargets()
+    {
+        selectedSwapChainImageFormat_ = headlessConfig_.format;
+        selectedSwapChainExtent_ = { headlessConfig_.width, headlessConfig_.height };
+
+        VkFormatProperties formatProperties;
+        vkGetPhysicalDeviceFormatProperties(physicalDevice_, selectedSwapChainImageFormat_, &formatProperties);
+        if (!(formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_COLOR_ATTACHMENT_BIT))
+        {
+            throw std::runtime_error("Offscreen format cannot be used as a colour attachment!");
+        }
+
+        VkImageUsageFlags usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+        if (headlessConfig_.enableReadback)
+        {
+            usage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+        }
+
+        // One render target per frame in flight, so the frame's fence also guards its target
+        offscreenImageMemory_.resize(presentationConfig_.framesInFlight);
+
+        for (size_t i = 0; i < presentationConfig_.framesInFlight; ++i)
+        {
+            VkImageCreateInfo imageCreateInfo{};
+            imageCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+            imageCreateInfo.imageType = VK_IMAGE_TYPE_2D;
+            imageCreateInfo.format = selectedSwapChainImageFormat_;
+            imageCreateInfo.extent = { selectedSwapChainExtent_.width, selectedSwapChainExtent_.height, 1 };
+            imageCreateInfo.mipLevels = 1;
+            imageCreateInfo.arrayLayers = 1;
+            imageCreateInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+            imageCreateInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+            imageCreateInfo.usage = usage;
+            imageCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+            imageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+            VkImage image;
+            allocator_->CreateImage(imageCreateInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, image,
+                offscreenImageMemory_[i]);
+
+            SwapchainImage offscreenImage{image, CreateImageView(image, selectedSwapChainImageFormat_,
+                VK_IMAGE_ASPECT_COLOR_BIT)};
+            swapChainImages_.push_back(offscreenImage);
+        }
+    }
+
+    void Renderer::ConfigureDepthBuffer()
+    {
+        // The format is picked once, swap chain rebuilds only recreate the image at the new size
+        bool firstCreation = depthFormat_ == VK_FORMAT_UNDEFINED;
+        if (firstCreation)
+        {
+            for (VkFormat candidate : DEPTH_FORMAT_CANDIDATES)
+            {
+                VkFormatProperties formatProperties;
+                vkGetPhysicalDeviceFormatProperties(physicalDevice_, candidate, &formatProperties);
+                if (formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT)
+                {
+                    depthFormat_ = candidate;
+                    break;
+                }
+            }
+
+            if (depthFormat_ == VK_FORMAT_UNDEFINED)
+            {
+                throw std::runtime_error("No supported depth attachment format!");
+            }
+        }
+
+        VkImageCreateInfo imageCreateInfo{};
+        imageCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        imageCreateInfo.imageType = VK_IMAGE_TYPE_2D;
+        imageCreateInfo.format = depthFormat_;
+        imageCreateInfo.extent = { selectedSwapChainExtent_.width, selectedSwapChainExtent_.height, 1 };
+        imageCreateInfo.mipLevels = 1;
+        imageCreateInfo.arrayLayers = 1;
+        imageCreateInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+        imageCreateInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+        // Only ever used inside the render pass, which lets the memory be allocated lazily
+        imageCreateInfo.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+        imageCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        imageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+        allocator_->CreateImage(imageCreateInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, depthImage_, depthImageMemory_,
+            VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT);
+
+        // Attachments of a combined format are viewed with both aspects
+        VkImageAspectFlags aspectFlags = VK_IMAGE_ASPECT_DEPTH_BIT;
+        if (HasStencilComponent(depthFormat_))
+        {
+            aspectFlags |= VK_IMAGE_ASPECT_STENCIL_BIT;
+        }
+        depthImageView_ = CreateImageView(depthImage_, depthFormat_, aspectFlags);
+
+        if (firstCreation)
+        {
+            VkPhysicalDeviceMemoryProperties memoryProperties;
+            vkGetPhysicalDeviceMemoryProperties(physicalDevice_, &memoryProperties);
+            bool lazilyAllocated = (memoryProperties.memoryTypes[depthImageMemory_.memoryTypeIndex].propertyFlags
+                & VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT) != 0;
+            printf("Depth buffer: %s%s\n", GetDepthFormatName(depthFormat_),
+                lazilyAllocated ? ", lazily allocated" : "");
+        }
+    }
+
+    void Renderer::DestroyDepthBuffer()
+    {
+        if (depthImage_ == VK_NULL_HANDLE)
+        {
+            return;
+        }
+
+        vkDestroyImageView(logicalDevice_, depthImageView_, nullptr);
+        depthImageView_ = VK_NULL_HANDLE;
+        allocator_->DestroyImage(depthImage_, depthImageMemory_);
+    }
+
     void Renderer::ConfigureGraphicsPipeline()
     {
-        std::vector<char> vertShader = ReadFile("Shaders/simple_shader.vert.spv");
+        // Pipeline Layout
+        VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo{};
+        pipelineLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+        pipelineLayoutCreateInfo.setLayoutCount = 1;
+        pipelineLayoutCreateInfo.pSetLayouts = &descriptorSetLayout_;
+        // Object data is pushed per draw rather than stored in a buffer
+        VkPushConstantRange pushConstantRange{};
+        pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+        pushConstantRange.offset = 0;
+        pushConstantRange.size = sizeof(ObjectPushConstants);
+
+        pipelineLayoutCreateInfo.pushConstantRangeCount = 1;
+        pipelineLayoutCreateInfo.pPushConstantRanges = &pushConstantRange;
+
+        VkResult result = vkCreatePipelineLayout(logicalDevice_, &pipelineLayoutCreateInfo, nullptr, 
+            &pipelineLayout_);
+        if (result != VK_SUCCESS)
+        {
+            throw std::runtime_error("Failed to create Pipeline Layout!");
+        }
+
+        graphicsPipeline_ = CreateGraphicsPipeline("Shaders/simple_shader.vert.spv", pipelineLayout_, "simple_shader");
+
+        if (!gpuCulling_)
+        {
+            return;
+        }
+
+        // Indirect draws read their object from the culling buffers in set 1. Only the offset of the draw
+        // list being drawn is pushed, gl_DrawIDARB counts from the start of the list
+        std::array<VkDescriptorSetLayout, 2> indirectSetLayouts = { descriptorSetLayout_, cullDescriptorSetLayout_ };
+
+        VkPushConstantRange drawListRange{};
+        drawListRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+        drawListRange.offset = 0;
+        drawListRange.size = sizeof(uint32_t);
+
+        VkPipelineLayoutCreateInfo indirectLayoutCreateInfo{};
+        indirectLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+        indirectLayoutCreateInfo.setLayoutCount = (uint32_t)indirectSetLayouts.size();
+        indirectLayoutCreateInfo.pSetLayouts = indirectSetLayouts.data();
+        indirectLayoutCreateInfo.pushConstantRangeCount = 1;
+        indirectLayoutCreateInfo.pPushConstantRanges = &drawListRange;
+
+        result = vkCreatePipelineLayout(logicalDevice_, &indirectLayoutCreateInfo, nullptr, &indirectPipelineLayout_);
+        if (result != VK_SUCCESS)
+        {
+            throw std::runtime_error("Failed to create the indirect Pipeline Layout!");
+        }
+
+        indirectPipeline_ = CreateGraphicsPipeline("Shaders/indirect_shader.vert.spv", indirectPipelineLayout_,
+            "indirect_shader");
+    }
+
+    void Renderer::ConfigureComputePipeline()
+    {
+        std::vector<char> cullShader = ReadFile("Shaders/cull.comp.spv");
+        VkShaderModule cullShaderModule = CreateShaderModule(cullShader);
+
+        // The cull pass reads the frame's projection matrices from set 0, exactly like the vertex shaders
+        std::array<VkDescriptorSetLayout, 2> setLayouts = { descriptorSetLayout_, cullDescriptorSetLayout_ };
+
+        VkPushConstantRange pushConstantRange{};
+        pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+        pushConstantRange.offset = 0;
+        pushConstantRange.size = sizeof(CullPushConstants);
+
+        VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo{};
+        pipelineLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+        pipelineLayoutCreateInfo.setLayoutCount = (uint32_t)setLayouts.size();
+        pipelineLayoutCreateInfo.pSetLayouts = setLayouts.data();
+        pipelineLayoutCreateInfo.pushConstantRangeCount = 1;
+        pipelineLayoutCreateInfo.pPushConstantRanges = &pushConstantRange;
+
+        VkResult result = vkCreatePipelineLayout(logicalDevice_, &pipelineLayoutCreateInfo, nullptr,
+            &cullPipelineLayout_);
+        if (result != VK_SUCCESS)
+        {
+            throw std::runtime_error("Failed to create the cull Pipeline Layout!");
+        }
+
+        VkComputePipelineCreateInfo pipelineCreateInfo{};
+        pipelineCreateInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+        pipelineCreateInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        pipelineCreateInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+        pipelineCreateInfo.stage.module = cullShaderModule;
+        pipelineCreateInfo.stage.pName = "main";
+        pipelineCreateInfo.layout = cullPipelineLayout_;
+        pipelineCreateInfo.basePipelineHandle = VK_NULL_HANDLE;
+
+        VkPipelineCreationFeedbackEXT creationFeedback{};
+        VkPipelineCreationFeedbackCreateInfoEXT creationFeedbackInfo{};
+        creationFeedbackInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CREATION_FEEDBACK_CREATE_INFO_EXT;
+        creationFeedbackInfo.pPipelineCreationFeedback = &creationFeedback;
+        if (pipelineFeedbackSupported_)
+        {
+            pipelineCreateInfo.pNext = &creationFeedbackInfo;
+        }
+
+        auto createStart = std::chrono::steady_clock::now();
+        result = vkCreateComputePipelines(logicalDevice_, pipelineCache_->Get(), 1, &pipelineCreateInfo, nullptr,
+            &cullPipeline_);
+        if (result != VK_SUCCESS)
+        {
+            throw std::runtime_error("Failed to create the cull Compute Pipeline!");
+        }
+
+        std::chrono::duration<double, std::milli> createTime = std::chrono::steady_clock::now() - createStart;
+        pipelineCache_->ReportCreation("cull", createTime.count(),
+            pipelineFeedbackSupported_ ? &creationFeedback : nullptr);
+
+        vkDestroyShaderModule(logicalDevice_, cullShaderModule, nullptr);
+    }
+
+    VkPipeline Renderer::CreateGraphicsPipeline(const std::string& vertexShaderPath, VkPipelineLayout layout,
+        const std::string& name)
+    {
+        std::vector<char> vertShader = ReadFile(vertexShaderPath);
         std::vector<char> fragShader = ReadFile("Shaders/simple_shader.frag.spv");
 
         VkShaderModule vertShaderModule = CreateShaderModule(vertShader);
@@ -527,29 +1022,43 @@ namespace p3d
 
         VkPipelineShaderStageCreateInfo shaderStages[] = { vertShaderStageInfo, fragShaderStageInfo };
 
-        VkVertexInputBindingDescription bindingDescription{};
-        bindingDescription.binding = 0;
-        bindingDescription.stride = sizeof(Vertex);
-        bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+        std::array<VkVertexInputBindingDescription, 2> bindingDescriptions{};
+        bindingDescriptions[0].binding = 0;
+        bindingDescriptions[0].stride = vertexLayout_.GetStride();
+        bindingDescriptions[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
 
-        // Position Attribute
-        std::array<VkVertexInputAttributeDescription, 2> attributeDescriptions;
-        attributeDescriptions[0].binding = 0;
-        attributeDescriptions[0].location = 0;
-        attributeDescriptions[0].format = VK_FORMAT_R32G32B32_SFLOAT;
-        attributeDescriptions[0].offset = offsetof(Vertex, pos);
+        // The instance binding advances once per instance instead of once per vertex
+        bindingDescriptions[1].binding = 1;
+        bindingDescriptions[1].stride = sizeof(InstanceData);
+        bindingDescriptions[1].inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
 
-        // Colour Attribute
-        attributeDescriptions[1].binding = 0;
-        attributeDescriptions[1].location = 1;
-        attributeDescriptions[1].format = VK_FORMAT_R32G32B32_SFLOAT;
-        attributeDescriptions[1].offset = offsetof(Vertex, col);
+        // Position, colour and optionally normal attributes, in whichever formats the vertex layout stores
+        std::vector<VkVertexInputAttributeDescription> attributeDescriptions = vertexLayout_.GetAttributeDescriptions(0);
+
+        // Instance model matrix, one location per column
+        for (uint32_t column = 0; column < 4; ++column)
+        {
+            VkVertexInputAttributeDescription modelColumn{};
+            modelColumn.binding = 1;
+            modelColumn.location = 2 + column;
+            modelColumn.format = VK_FORMAT_R32G32B32A32_SFLOAT;
+            modelColumn.offset = offsetof(InstanceData, model) + column * sizeof(glm::vec4);
+            attributeDescriptions.push_back(modelColumn);
+        }
+
+        // Instance colour
+        VkVertexInputAttributeDescription instanceColour{};
+        instanceColour.binding = 1;
+        instanceColour.location = 6;
+        instanceColour.format = VK_FORMAT_R32G32B32A32_SFLOAT;
+        instanceColour.offset = offsetof(InstanceData, colour);
+        attributeDescriptions.push_back(instanceColour);
 
         // -- VERTEX INPUT --
         VkPipelineVertexInputStateCreateInfo vertexInputCreateInfo{};
         vertexInputCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-        vertexInputCreateInfo.vertexBindingDescriptionCount = 1;
-        vertexInputCreateInfo.pVertexBindingDescriptions = &bindingDescription;
+        vertexInputCreateInfo.vertexBindingDescriptionCount = (uint32_t)bindingDescriptions.size();
+        vertexInputCreateInfo.pVertexBindingDescriptions = bindingDescriptions.data();
         vertexInputCreateInfo.vertexAttributeDescriptionCount = (uint32_t)attributeDescriptions.size();
         vertexInputCreateInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
 
@@ -560,19 +1069,18 @@ namespace p3d
         inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
         inputAssembly.primitiveRestartEnable = VK_FALSE;
 
-        // Viewport & Scissor
-        VkViewport viewport{0.0f, 0.0f, (float)selectedSwapChainExtent_.width,
-            (float)selectedSwapChainExtent_.height, 0.0f, 1.0f};
-        VkRect2D scissor{{0, 0}, selectedSwapChainExtent_};
-
+        // Viewport & Scissor are set while recording, so the pipeline survives swap chain resizes
         VkPipelineViewportStateCreateInfo viewportStateCreateInfo{};
         viewportStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
         viewportStateCreateInfo.viewportCount = 1;
-        viewportStateCreateInfo.pViewports = &viewport;
         viewportStateCreateInfo.scissorCount = 1;
-        viewportStateCreateInfo.pScissors = &scissor;
 
-        // NOTE: Look up VkDynamicState for dynamic viewport/scissor resizing
+        VkDynamicState dynamicStates[] = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+
+        VkPipelineDynamicStateCreateInfo dynamicStateCreateInfo{};
+        dynamicStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+        dynamicStateCreateInfo.dynamicStateCount = 2;
+        dynamicStateCreateInfo.pDynamicStates = dynamicStates;
 
         // Rasterizer
         VkPipelineRasterizationStateCreateInfo rasterizerCreateInfo{};
@@ -606,28 +1114,22 @@ namespace p3d
         colourState.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
         colourState.alphaBlendOp = VK_BLEND_OP_ADD;
 
+        // Depth testing, nearer fragments win. Draws are sorted front to back so most hidden fragments fail the
+        // test before their fragment shader runs
+        VkPipelineDepthStencilStateCreateInfo depthStencilCreateInfo{};
+        depthStencilCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+        depthStencilCreateInfo.depthTestEnable = VK_TRUE;
+        depthStencilCreateInfo.depthWriteEnable = VK_TRUE;
+        depthStencilCreateInfo.depthCompareOp = VK_COMPARE_OP_LESS;
+        depthStencilCreateInfo.depthBoundsTestEnable = VK_FALSE;
+        depthStencilCreateInfo.stencilTestEnable = VK_FALSE;
+
         VkPipelineColorBlendStateCreateInfo colourBlendingCreateInfo{};
         colourBlendingCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
         colourBlendingCreateInfo.logicOpEnable = VK_FALSE;
         colourBlendingCreateInfo.attachmentCount = 1;
         colourBlendingCreateInfo.pAttachments = &colourState;
 
-        // Pipeline Layout
-        VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo{};
-        pipelineLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-        pipelineLayoutCreateInfo.setLayoutCount = 1;
-        pipelineLayoutCreateInfo.pSetLayouts = &descriptorSetLayout_;
-        pipelineLayoutCreateInfo.pushConstantRangeCount = 0;
-        pipelineLayoutCreateInfo.pPushConstantRanges = nullptr;
-
-        // Create Pipeline Layout
-        VkResult result = vkCreatePipelineLayout(logicalDevice_, &pipelineLayoutCreateInfo, nullptr, 
-            &pipelineLayout_);
-        if (result != VK_SUCCESS)
-        {
-            throw std::runtime_error("Failed to create Pipeline Layout!");
-        }
-
         // Create Pipeline
         VkGraphicsPipelineCreateInfo pipelineCreateInfo{};
         pipelineCreateInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
@@ -636,24 +1138,43 @@ namespace p3d
         pipelineCreateInfo.pVertexInputState = &vertexInputCreateInfo;
         pipelineCreateInfo.pInputAssemblyState = &inputAssembly;
         pipelineCreateInfo.pViewportState = &viewportStateCreateInfo;
+        pipelineCreateInfo.pDynamicState = &dynamicStateCreateInfo;
         pipelineCreateInfo.pRasterizationState = &rasterizerCreateInfo;
         pipelineCreateInfo.pMultisampleState = &multisamplingCreateInfo;
+        pipelineCreateInfo.pDepthStencilState = &depthStencilCreateInfo;
         pipelineCreateInfo.pColorBlendState = &colourBlendingCreateInfo;
-        pipelineCreateInfo.layout = pipelineLayout_;
+        pipelineCreateInfo.layout = layout;
         pipelineCreateInfo.renderPass = renderPass_;
         pipelineCreateInfo.subpass = 0;
         pipelineCreateInfo.basePipelineHandle = VK_NULL_HANDLE;
 
-        result = vkCreateGraphicsPipelines(logicalDevice_, VK_NULL_HANDLE, 1, &pipelineCreateInfo, nullptr,
-            &graphicsPipeline_);
+        VkPipelineCreationFeedbackEXT creationFeedback{};
+        VkPipelineCreationFeedbackCreateInfoEXT creationFeedbackInfo{};
+        creationFeedbackInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CREATION_FEEDBACK_CREATE_INFO_EXT;
+        creationFeedbackInfo.pPipelineCreationFeedback = &creationFeedback;
+        if (pipelineFeedbackSupported_)
+        {
+            pipelineCreateInfo.pNext = &creationFeedbackInfo;
+        }
+
+        VkPipeline pipeline = VK_NULL_HANDLE;
+        auto createStart = std::chrono::steady_clock::now();
+        VkResult result = vkCreateGraphicsPipelines(logicalDevice_, pipelineCache_->Get(), 1, &pipelineCreateInfo,
+            nullptr, &pipeline);
         if (result != VK_SUCCESS)
         {
             throw std::runtime_error("Failed to create Graphics Pipeline!");
         }
+
+        std::chrono::duration<double, std::milli> createTime = std::chrono::steady_clock::now() - createStart;
+        pipelineCache_->ReportCreation(name.c_str(), createTime.count(),
+            pipelineFeedbackSupported_ ? &creationFeedback : nullptr);
         
         // NOTE: Shader modules are only required for pipeline creation and must be deleted afterwards
         vkDestroyShaderModule(logicalDevice_, fragShaderModule, nullptr);
         vkDestroyShaderModule(logicalDevice_, vertShaderModule, nullptr);
+
+        return pipeline;
     }
 
     void Renderer::ConfigureRenderPass()
@@ -672,17 +1193,42 @@ namespace p3d
         colourAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
         colourAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
 
+        // Offscreen targets are never presented, leave them ready to be copied or rendered again
+        if (headless_)
+        {
+            colourAttachment.finalLayout = headlessConfig_.enableReadback ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL
+                : VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+        }
+
+        // Depth is only needed while the subpass runs, it is cleared on load and never stored
+        VkAttachmentDescription depthAttachment{};
+        depthAttachment.format = depthFormat_;
+        depthAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+        depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+        depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+        depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        depthAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+        std::array<VkAttachmentDescription, 2> attachments = { colourAttachment, depthAttachment };
+
         // Attachment reference uses an attachment index that refers to index in the attachment
         // list passed to renderPassCreateInfo
         VkAttachmentReference colourAttachmentReference{};
         colourAttachmentReference.attachment = 0;
         colourAttachmentReference.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
 
+        VkAttachmentReference depthAttachmentReference{};
+        depthAttachmentReference.attachment = 1;
+        depthAttachmentReference.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
         // Information about a particular subpass the Render Pass is using
         VkSubpassDescription subpass{};
         subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
         subpass.colorAttachmentCount = 1;
         subpass.pColorAttachments = &colourAttachmentReference;
+        subpass.pDepthStencilAttachment = &depthAttachmentReference;
 
         // Need to determine when layout transitions occur using subpass dependencies
         std::array<VkSubpassDependency, 2> subpassDependencies{};
@@ -698,6 +1244,16 @@ namespace p3d
         subpassDependencies[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
         subpassDependencies[0].dependencyFlags = 0;
 
+        // Frames in flight share the depth image, so the previous frame's depth tests must also have finished
+        // before this frame clears it
+        subpassDependencies[0].srcStageMask |= VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT
+            | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+        subpassDependencies[0].srcAccessMask |= VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        subpassDependencies[0].dstStageMask |= VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT
+            | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+        subpassDependencies[0].dstAccessMask |= VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT
+            | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+
         // Conversion from VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL to VK_IMAGE_LAYOUT_PRESENT_SRC_KHR
         // Transition must happen after...
         subpassDependencies[1].srcSubpass = 0;
@@ -709,11 +1265,18 @@ namespace p3d
         subpassDependencies[1].dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
         subpassDependencies[1].dependencyFlags = 0;
 
+        // Readback copies the image on the transfer stage once the render pass has finished
+        if (headless_ && headlessConfig_.enableReadback)
+        {
+            subpassDependencies[1].dstStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT;
+            subpassDependencies[1].dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+        }
+
         // Create info for Render Pass
         VkRenderPassCreateInfo renderPassCreateInfo{};
         renderPassCreateInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-        renderPassCreateInfo.attachmentCount = 1;
-        renderPassCreateInfo.pAttachments = &colourAttachment;
+        renderPassCreateInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+        renderPassCreateInfo.pAttachments = attachments.data();
         renderPassCreateInfo.subpassCount = 1;
         renderPassCreateInfo.pSubpasses = &subpass;
         renderPassCreateInfo.dependencyCount = static_cast<uint32_t>(subpassDependencies.size());
@@ -732,13 +1295,13 @@ namespace p3d
 
         for (size_t i = 0; i < swapChainImages_.size(); ++i)
         {
-            VkImageView attachments[] = {swapChainImages_[i].imageView};
+            std::array<VkImageView, 2> attachments = { swapChainImages_[i].imageView, depthImageView_ };
 
             VkFramebufferCreateInfo framebufferCreateInfo{};
             framebufferCreateInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
             framebufferCreateInfo.renderPass = renderPass_;
-            framebufferCreateInfo.attachmentCount = 1;
-            framebufferCreateInfo.pAttachments = attachments;
+            framebufferCreateInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+            framebufferCreateInfo.pAttachments = attachments.data();
             framebufferCreateInfo.width = selectedSwapChainExtent_.width;
             framebufferCreateInfo.height = selectedSwapChainExtent_.height;
             framebufferCreateInfo.layers = 1;
@@ -759,7 +1322,8 @@ namespace p3d
         VkCommandPoolCreateInfo poolCreateInfo{};
         poolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
         poolCreateInfo.queueFamilyIndex = *queueFamilyIndices.graphicsFamily;
-        poolCreateInfo.flags = 0;
+        // Only used for short lived one-off work, frames record from their own pools
+        poolCreateInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
 
         VkResult result = vkCreateCommandPool(logicalDevice_, &poolCreateInfo, nullptr, &commandPool_);
         if (result != VK_SUCCESS)
@@ -770,23 +1334,58 @@ namespace p3d
 
     void Renderer::ConfigureCommandBuffers()
     {
-        commandBuffers_.resize(swapChainFramebuffers_.size());
+        // Each frame in flight records into pools of its own, which are reset as a whole once the frame's
+        // fence has signalled. Recording threads need separate pools, command pools are not thread safe
+        VkCommandPoolCreateInfo poolCreateInfo{};
+        poolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+        poolCreateInfo.queueFamilyIndex = *queueFamilyIndices_.graphicsFamily;
+        poolCreateInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
 
         VkCommandBufferAllocateInfo allocateInfo{};
         allocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-        allocateInfo.commandPool = commandPool_;
-        // 'Primary' indicates that the command buffer will be submitted directly to a queue
-        allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-        allocateInfo.commandBufferCount = (uint32_t)commandBuffers_.size();
+        allocateInfo.commandBufferCount = 1;
 
-        VkResult result = vkAllocateCommandBuffers(logicalDevice_, &allocateInfo, commandBuffers_.data());
-        if (result != VK_SUCCESS)
+        frames_.resize(presentationConfig_.framesInFlight);
+        for (FrameContext& frame : frames_)
         {
-            throw std::runtime_error("Failed to allocate Command Buffers!");
+            VkResult result = vkCreateCommandPool(logicalDevice_, &poolCreateInfo, nullptr, &frame.commandPool);
+            if (result != VK_SUCCESS)
+            {
+                throw std::runtime_error("Failed to create a frame Command Pool!");
+            }
+
+            allocateInfo.commandPool = frame.commandPool;
+            // 'Primary' indicates that the command buffer will be submitted directly to a queue
+            allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+
+            result = vkAllocateCommandBuffers(logicalDevice_, &allocateInfo, &frame.commandBuffer);
+            if (result != VK_SUCCESS)
+            {
+                throw std::runtime_error("Failed to allocate Command Buffers!");
+            }
+
+            frame.secondaryRecorders.resize(threadPool_->GetThreadCount());
+            for (SecondaryRecorder& recorder : frame.secondaryRecorders)
+            {
+                result = vkCreateCommandPool(logicalDevice_, &poolCreateInfo, nullptr, &recorder.commandPool);
+                if (result != VK_SUCCESS)
+                {
+                    throw std::runtime_error("Failed to create a recording Command Pool!");
+                }
+
+                allocateInfo.commandPool = recorder.commandPool;
+                allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+
+                result = vkAllocateCommandBuffers(logicalDevice_, &allocateInfo, &recorder.commandBuffer);
+                if (result != VK_SUCCESS)
+                {
+                    throw std::runtime_error("Failed to allocate a secondary Command Buffer!");
+                }
+            }
         }
     }
 
-    void Renderer::RecordCommands()
+    void Renderer::RecordCommands(uint32_t imageIndex)
     {
         VkCommandBufferBeginInfo bufferBeginInfo = {};
         bufferBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
@@ -796,108 +1395,580 @@ namespace p3d
         renderPassInfo.renderPass = renderPass_;
         renderPassInfo.renderArea.offset = {0, 0};
         renderPassInfo.renderArea.extent = selectedSwapChainExtent_;
-        VkClearValue clearColour = {0.0f, 0.0f, 0.0f, 1.0f};
-        renderPassInfo.clearValueCount = 1;
-        renderPassInfo.pClearValues = &clearColour;
+        std::array<VkClearValue, 2> clearValues{};
+        clearValues[0].color = {0.0f, 0.0f, 0.0f, 1.0f};
+        clearValues[1].depthStencil = {1.0f, 0};
+        renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
+        renderPassInfo.pClearValues = clearValues.data();
+        renderPassInfo.framebuffer = swapChainFramebuffers_[imageIndex];
+
+        FrameContext& frame = frames_[currentFrame_];
+        profiler_->BeginRecording((uint32_t)currentFrame_);
+
+        // Split the draws into contiguous slices, one secondary command buffer each. Small scenes use fewer
+        // slices since a thread recording a handful of draws costs more than it saves. With GPU culling the
+        // draws are a couple of indirect calls, which a single secondary holds
+        std::vector<SecondaryRecorder>& recorders = frame.secondaryRecorders;
+        uint32_t objectCount = gpuCulling_ ? 0 : (uint32_t)visibleObjects_.size();
+        uint32_t taskCount = std::min((uint32_t)recorders.size(),
+            (objectCount + MIN_DRAWS_PER_RECORDING_TASK - 1) / MIN_DRAWS_PER_RECORDING_TASK);
+        uint32_t drawsPerTask = taskCount > 0 ? (objectCount + taskCount - 1) / taskCount : 0;
+        if (gpuCulling_)
+        {
+            taskCount = objects_.empty() ? 0 : 1;
+        }
 
-        for (size_t i = 0; i < commandBuffers_.size(); ++i)
+        threadPool_->ParallelFor(taskCount, [&](uint32_t taskIndex)
         {
-            renderPassInfo.framebuffer = swapChainFramebuffers_[i];
-            VkCommandBuffer& commandBuffer = commandBuffers_[i];
+            uint32_t firstVisible = taskIndex * drawsPerTask;
+            uint32_t lastVisible = std::min(firstVisible + drawsPerTask, objectCount);
+            RecordSecondaryCommands(recorders[taskIndex], taskIndex, renderPassInfo.framebuffer, firstVisible,
+                lastVisible);
+        });
 
-            VkResult result = vkBeginCommandBuffer(commandBuffer, &bufferBeginInfo);
-            if (result != VK_SUCCESS)
-            {
-                throw std::runtime_error("Failed to begin recording Command Buffer!");
-            }
+        // The frame's fence has signalled, so nothing recorded from its pool is still executing
+        vkResetCommandPool(logicalDevice_, frame.commandPool, 0);
 
-            vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
-            vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline_);
+        VkCommandBuffer& commandBuffer = frame.commandBuffer;
 
-            for (Mesh& mesh : meshes_)
-            {
-                VkBuffer vertexBuffers[] = { mesh.GetVertexBuffer() };
-                VkDeviceSize offsets[] = { 0 };
-                vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
-                vkCmdBindIndexBuffer(commandBuffer, mesh.GetIndexBuffer(), 0, VK_INDEX_TYPE_UINT32);
-                vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout_, 0, 1, 
-                    &descriptorSets_[i], 0, nullptr);
-                vkCmdDrawIndexed(commandBuffer, (uint32_t)(mesh.GetIndexCount()), 1, 0, 0, 0);
+        VkResult result = vkBeginCommandBuffer(commandBuffer, &bufferBeginInfo);
+        if (result != VK_SUCCESS)
+        {
+            throw std::runtime_error("Failed to begin recording Command Buffer!");
+        }
+
+        profiler_->ResetQueries(commandBuffer);
+
+        if (gpuCulling_ && !objects_.empty())
+        {
+            uint32_t cullScope = profiler_->BeginGpuScope(commandBuffer, "Cull");
+            RecordCullPass(commandBuffer, frame);
+            profiler_->EndGpuScope(commandBuffer, cullScope);
+        }
+
+        uint32_t renderPassScope = profiler_->BeginGpuScope(commandBuffer, "RenderPass");
+        profiler_->BeginStatistics(commandBuffer);
+
+        // The subpass contents come entirely from the secondary command buffers
+        vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+
+        if (taskCount > 0)
+        {
+            std::vector<VkCommandBuffer> secondaryCommandBuffers(taskCount);
+            for (uint32_t i = 0; i < taskCount; ++i)
+            {
+                secondaryCommandBuffers[i] = recorders[i].commandBuffer;
             }
-            
-            vkCmdEndRenderPass(commandBuffer);
+            vkCmdExecuteCommands(commandBuffer, taskCount, secondaryCommandBuffers.data());
+        }
 
-            result = vkEndCommandBuffer(commandBuffer);
-            if (result != VK_SUCCESS)
+        vkCmdEndRenderPass(commandBuffer);
+
+        profiler_->EndStatistics(commandBuffer);
+        profiler_->EndGpuScope(commandBuffer, renderPassScope);
+
+        result = vkEndCommandBuffer(commandBuffer);
+        if (result != VK_SUCCESS)
+        {
+            throw std::runtime_error("Failed to record Command Buffer!");
+        }
+
+        frame.recordedSceneVersion = sceneVersion_;
+        frame.recordedImage = imageIndex;
+    }
+
+    void Renderer::RecordSecondaryCommands(SecondaryRecorder& recorder, uint32_t taskIndex, VkFramebuffer framebuffer,
+        uint32_t firstVisible, uint32_t lastVisible)
+    {
+        // Each recorder has a pool of its own, so no other thread touches it while it is reset and recorded.
+        // The buffer may be replayed on later frames, so it is not recorded for one time submission
+        vkResetCommandPool(logicalDevice_, recorder.commandPool, 0);
+
+        VkCommandBufferInheritanceInfo inheritanceInfo{};
+        inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+        inheritanceInfo.renderPass = renderPass_;
+        inheritanceInfo.subpass = 0;
+        inheritanceInfo.framebuffer = framebuffer;
+        // The primary keeps a pipeline statistics query active across the render pass
+        inheritanceInfo.pipelineStatistics = profiler_->GetStatisticsFlags();
+
+        VkCommandBufferBeginInfo beginInfo{};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+        beginInfo.pInheritanceInfo = &inheritanceInfo;
+
+        VkCommandBuffer commandBuffer = recorder.commandBuffer;
+
+        VkResult result = vkBeginCommandBuffer(commandBuffer, &beginInfo);
+        if (result != VK_SUCCESS)
+        {
+            throw std::runtime_error("Failed to begin recording a secondary Command Buffer!");
+        }
+
+        // Bound state does not carry over between command buffers, so every slice binds it again
+        VkPipelineLayout pipelineLayout = gpuCulling_ ? indirectPipelineLayout_ : pipelineLayout_;
+        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+            gpuCulling_ ? indirectPipeline_ : graphicsPipeline_);
+
+        VkViewport viewport{0.0f, 0.0f, (float)selectedSwapChainExtent_.width,
+            (float)selectedSwapChainExtent_.height, 0.0f, 1.0f};
+        VkRect2D scissor{{0, 0}, selectedSwapChainExtent_};
+        vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+        vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+
+        VkBuffer vertexBuffers[] = { geometryPool_->GetVertexBuffer(), instancePool_->GetBuffer() };
+        VkDeviceSize offsets[] = { 0, 0 };
+        vkCmdBindVertexBuffers(commandBuffer, 0, 2, vertexBuffers, offsets);
+        // The projection matrices are the first block written into each frame's slice of the ring
+        uint32_t dynamicOffset = frames_[currentFrame_].uniformOffset;
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, 
+            &descriptorSet_, 1, &dynamicOffset);
+
+        uint32_t batchScope = profiler_->BeginGpuScope(commandBuffer, "DrawBatch" + std::to_string(taskIndex));
+
+        if (gpuCulling_)
+        {
+            RecordIndirectDraws(commandBuffer, frames_[currentFrame_]);
+        }
+        else
+        {
+            // Small meshes use 16-bit indices, the shared index buffer is only rebound when the type changes
+            bool indexBufferBound = false;
+            VkIndexType boundIndexType = VK_INDEX_TYPE_UINT32;
+
+            for (uint32_t visibleIndex = firstVisible; visibleIndex < lastVisible; ++visibleIndex)
+            {
+                uint32_t objectId = visibleObjects_[visibleIndex];
+                RenderObject& object = objects_[objectId];
+
+                VkIndexType indexType = object.mesh.GetIndexType();
+                if (!indexBufferBound || indexType != boundIndexType)
+                {
+                    vkCmdBindIndexBuffer(commandBuffer, geometryPool_->GetIndexBuffer(), 0, indexType);
+                    indexBufferBound = true;
+                    boundIndexType = indexType;
+                }
+
+                VertexDequantization dequantization = object.mesh.GetDequantization();
+                ObjectPushConstants pushConstants{ object.model, glm::vec4(dequantization.scale, 0.0f),
+                    glm::vec4(dequantization.offset, 0.0f), objectId };
+                vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0,
+                    sizeof(ObjectPushConstants), &pushConstants);
+
+                vkCmdDrawIndexed(commandBuffer, (uint32_t)(object.mesh.GetIndexCount(object.lod)),
+                    object.instances.instanceCount, object.mesh.GetFirstIndex(object.lod),
+                    object.mesh.GetVertexOffset(), object.instances.firstInstance);
+            }
+        }
+
+        profiler_->EndGpuScope(commandBuffer, batchScope);
+
+        result = vkEndCommandBuffer(commandBuffer);
+        if (result != VK_SUCCESS)
+        {
+            throw std::runtime_error("Failed to record a secondary Command Buffer!");
+        }
+    }
+
+    void Renderer::RecordCullPass(VkCommandBuffer commandBuffer, FrameContext& frame)
+    {
+        DrawBufferLayout drawLayout = GetDrawBufferLayout(
+            allocator_->GetPhysicalDeviceProperties().limits.minStorageBufferOffsetAlignment, DRAW_LIST_COUNT);
+
+        // Visible objects are appended to their list through the counts, which start every frame at zero
+        bool compact = drawIndexedIndirectCount_ != nullptr;
+        if (compact)
+        {
+            vkCmdFillBuffer(commandBuffer, frame.drawBuffer, drawLayout.countsOffset,
+                DRAW_LIST_COUNT * sizeof(uint32_t), 0);
+
+            VkMemoryBarrier clearBarrier{};
+            clearBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+            clearBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            clearBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+            vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                0, 1, &clearBarrier, 0, nullptr, 0, nullptr);
+        }
+
+        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, cullPipeline_);
+
+        // The frustum comes from the uniform ring rather than being pushed, so a replayed command buffer
+        // still culls against the current camera
+        std::array<VkDescriptorSet, 2> descriptorSets = { descriptorSet_, frame.cullDescriptorSet };
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, cullPipelineLayout_, 0,
+            (uint32_t)descriptorSets.size(), descriptorSets.data(), 1, &frame.uniformOffset);
+
+        CullPushConstants pushConstants{};
+        pushConstants.objectCount = (uint32_t)objects_.size();
+        pushConstants.listCapacity = GPU_CULLING_OBJECT_CAPACITY;
+        pushConstants.compact = compact ? 1 : 0;
+#ifdef GLM_FORCE_DEPTH_ZERO_TO_ONE
+        pushConstants.depthZeroToOne = 1;
+#endif
+        vkCmdPushConstants(commandBuffer, cullPipelineLayout_, VK_SHADER_STAGE_COMPUTE_BIT, 0,
+            sizeof(CullPushConstants), &pushConstants);
+
+        vkCmdDispatch(commandBuffer, (pushConstants.objectCount + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE, 1, 1);
+
+        // The draws read the commands and counts as indirect arguments and the object ids from the vertex shader
+        VkMemoryBarrier cullBarrier{};
+        cullBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        cullBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+        cullBarrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT, 0, 1, &cullBarrier, 0, nullptr,
+            0, nullptr);
+    }
+
+    void Renderer::RecordIndirectDraws(VkCommandBuffer commandBuffer, FrameContext& frame)
+    {
+        DrawBufferLayout drawLayout = GetDrawBufferLayout(
+            allocator_->GetPhysicalDeviceProperties().limits.minStorageBufferOffsetAlignment, DRAW_LIST_COUNT);
+
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, indirectPipelineLayout_, 1, 1,
+            &frame.cullDescriptorSet, 0, nullptr);
+
+        // List 0 holds the meshes with 16-bit indices, list 1 those with 32-bit indices
+        const VkIndexType listIndexTypes[DRAW_LIST_COUNT] = { VK_INDEX_TYPE_UINT16, VK_INDEX_TYPE_UINT32 };
+
+        for (uint32_t list = 0; list < DRAW_LIST_COUNT; ++list)
+        {
+            if (drawListSizes_[list] == 0)
+            {
+                continue;
+            }
+
+            vkCmdBindIndexBuffer(commandBuffer, geometryPool_->GetIndexBuffer(), 0, listIndexTypes[list]);
+
+            uint32_t firstDraw = list * GPU_CULLING_OBJECT_CAPACITY;
+            vkCmdPushConstants(commandBuffer, indirectPipelineLayout_, VK_SHADER_STAGE_VERTEX_BIT, 0,
+                sizeof(uint32_t), &firstDraw);
+
+            VkDeviceSize commandsOffset = drawLayout.commandsOffset
+                + firstDraw * sizeof(VkDrawIndexedIndirectCommand);
+
+            // Without a count every object of the list is drawn, the culled ones with no instances
+            if (drawIndexedIndirectCount_ != nullptr)
+            {
+                drawIndexedIndirectCount_(commandBuffer, frame.drawBuffer, commandsOffset, frame.drawBuffer,
+                    drawLayout.countsOffset + list * sizeof(uint32_t), drawListSizes_[list],
+                    sizeof(VkDrawIndexedIndirectCommand));
+            }
+            else
             {
-                throw std::runtime_error("Failed to record Command Buffer!");
+                vkCmdDrawIndexedIndirect(commandBuffer, frame.drawBuffer, commandsOffset, drawListSizes_[list],
+                    sizeof(VkDrawIndexedIndirectCommand));
             }
         }
     }
 
-    void Renderer::UpdateUniformBuffer(uint32_t imageIndex)
+    void Renderer::UpdateUniformBuffer(uint32_t frameIndex)
     {
-        void* data;
-        size_t projectionMatrixSize = sizeof(ProjectionMatrices);
-        vkMapMemory(logicalDevice_, uniformBufferMemory_[imageIndex], 0, projectionMatrixSize, 0, &data);
-        memcpy(data, &projectionMatrices_, projectionMatrixSize);
-        vkUnmapMemory(logicalDevice_, uniformBufferMemory_[imageIndex]);
+        // The ring stays mapped, so updating the frame's constants is a plain copy
+        uniformRing_->BeginFrame(frameIndex);
+        uniformRing_->Push(projectionMatrices_);
     }
 
     void Renderer::Render(float dt)
     {
-        VkFence* drawFence = &drawFences_[currentFrame_];
-        VkSemaphore* imageAvailable = &imageAvailable_[currentFrame_];
-        VkSemaphore* renderFinished = &renderFinished_[currentFrame_];
+        FrameContext& frame = frames_[currentFrame_];
         constexpr uint64_t maxWait = std::numeric_limits<uint64_t>::max();
 
-        vkWaitForFences(logicalDevice_, 1, drawFence, VK_TRUE, maxWait);
-        vkResetFences(logicalDevice_, 1, drawFence);
+        vkWaitForFences(logicalDevice_, 1, &frame.inFlight, VK_TRUE, maxWait);
 
         uint32_t imageIndex;
-        vkAcquireNextImageKHR(logicalDevice_, swapchain_, maxWait, *imageAvailable, VK_NULL_HANDLE, &imageIndex);
+        if (headless_)
+        {
+            // There is no swapchain to acquire from, each frame in flight owns one offscreen target
+            imageIndex = (uint32_t)currentFrame_;
+        }
+        else
+        {
+            // A suboptimal image can still be presented, the swap chain is rebuilt after presenting it
+            VkResult acquireResult = vkAcquireNextImageKHR(logicalDevice_, swapchain_, maxWait, frame.imageAvailable,
+                VK_NULL_HANDLE, &imageIndex);
+            if (acquireResult == VK_ERROR_OUT_OF_DATE_KHR)
+            {
+                // The fence is left signalled, so the frame can simply be tried again
+                RecreateSwapChain();
+                return;
+            }
+            else if (acquireResult != VK_SUCCESS && acquireResult != VK_SUBOPTIMAL_KHR)
+            {
+                throw std::runtime_error("Failed to acquire a Swapchain Image!");
+            }
+        }
+
+        // Another frame may still be rendering into the image, wait for it before this frame claims it
+        VkFence& imageFence = imagesInFlight_[imageIndex];
+        if (imageFence != VK_NULL_HANDLE && imageFence != frame.inFlight)
+        {
+            vkWaitForFences(logicalDevice_, 1, &imageFence, VK_TRUE, maxWait);
+        }
+        imageFence = frame.inFlight;
+
+        vkResetFences(logicalDevice_, 1, &frame.inFlight);
+
+        // The frame's previous results are ready now that its fence has signalled
+        profiler_->BeginFrame((uint32_t)currentFrame_);
+        uint32_t frameScope = profiler_->BeginCpuScope("Frame");
+
+        // Submit uploads requested since the last frame ahead of this frame's draws
+        uint32_t uploadScope = profiler_->BeginCpuScope("Uploads");
+        uploadManager_->Flush();
+        profiler_->EndCpuScope(uploadScope);
 
         static float rotation = 0.0f;
         rotation += 36.f * dt;
         rotation = std::fmod(rotation, 360.0f);
-        projectionMatrices_.model = glm::rotate(glm::mat4(1.0f), glm::radians(rotation), glm::vec3(0.0f, 0.0f, 1.0f));
-        UpdateUniformBuffer(imageIndex);
+        SetObjectTransform(0, glm::rotate(glm::mat4(1.0f), glm::radians(rotation), glm::vec3(0.0f, 0.0f, 1.0f)));
+
+        if (!gpuCulling_)
+        {
+            uint32_t cullScope = profiler_->BeginCpuScope("Cull");
+            CullObjects();
+            profiler_->EndCpuScope(cullScope);
+
+            uint32_t sortScope = profiler_->BeginCpuScope("SortDraws");
+            SortVisibleObjects();
+            profiler_->EndCpuScope(sortScope);
+        }
+
+        uint32_t lodScope = profiler_->BeginCpuScope("SelectLods");
+        SelectLods();
+        profiler_->EndCpuScope(lodScope);
+
+        if (gpuCulling_)
+        {
+            // Culling happens in the frame's cull pass, the CPU only copies the objects that changed
+            uint32_t syncScope = profiler_->BeginCpuScope("SyncObjects");
+            SyncGpuObjects(frame);
+            profiler_->EndCpuScope(syncScope);
+        }
+
+        // The frame's fence has signalled, so its slice of the ring and its command buffers are free to reuse.
+        // Commands recorded for an unchanged scene and the same image are submitted again as they are
+        UpdateUniformBuffer((uint32_t)currentFrame_);
+        if (frame.recordedSceneVersion != sceneVersion_ || frame.recordedImage != imageIndex)
+        {
+            uint32_t recordScope = profiler_->BeginCpuScope("RecordCommands");
+            RecordCommands(imageIndex);
+            profiler_->EndCpuScope(recordScope);
+        }
 
         VkSubmitInfo submitInfo = {};
         submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
         submitInfo.waitSemaphoreCount = 1;
-        submitInfo.pWaitSemaphores = imageAvailable;
+        submitInfo.pWaitSemaphores = &frame.imageAvailable;
         VkPipelineStageFlags waitStages[] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
         submitInfo.pWaitDstStageMask = waitStages;
         submitInfo.commandBufferCount = 1;
-        submitInfo.pCommandBuffers = &commandBuffers_[imageIndex];
+        submitInfo.pCommandBuffers = &frame.commandBuffer;
         submitInfo.signalSemaphoreCount = 1;
-        submitInfo.pSignalSemaphores = &renderFinished_[currentFrame_];
+        submitInfo.pSignalSemaphores = &frame.renderFinished;
+
+        // Nothing is acquired or presented when headless, so there are no semaphores to wait on or signal
+        if (headless_)
+        {
+            submitInfo.waitSemaphoreCount = 0;
+            submitInfo.signalSemaphoreCount = 0;
+        }
 
         // Submit command buffer to queue
-        VkResult result = vkQueueSubmit(graphicsQueue_, 1, &submitInfo, *drawFence);
+        VkResult result = vkQueueSubmit(graphicsQueue_, 1, &submitInfo, frame.inFlight);
         if (result != VK_SUCCESS)
         {
             throw std::runtime_error("Failed to submit Command Buffer to Queue!");
         }
 
+        lastRenderedImage_ = imageIndex;
+
+        profiler_->EndCpuScope(frameScope);
+        profiler_->EndFrame();
+
+        if (headless_)
+        {
+            currentFrame_ = (currentFrame_ + 1) % presentationConfig_.framesInFlight;
+            return;
+        }
+
         // -- PRESENT RENDERED IMAGE TO SCREEN --
         VkPresentInfoKHR presentInfo = {};
         presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
         presentInfo.waitSemaphoreCount = 1;
-        presentInfo.pWaitSemaphores = renderFinished;
+        presentInfo.pWaitSemaphores = &frame.renderFinished;
         presentInfo.swapchainCount = 1;
         presentInfo.pSwapchains = &swapchain_;
         presentInfo.pImageIndices = &imageIndex;
 
         // Present image
         result = vkQueuePresentKHR(presentationQueue_, &presentInfo);
-        if (result != VK_SUCCESS)
+        currentFrame_ = (currentFrame_ + 1) % presentationConfig_.framesInFlight;
+
+        if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || framebufferResized_)
+        {
+            RecreateSwapChain();
+        }
+        else if (result != VK_SUCCESS)
         {
             throw std::runtime_error("Failed to present Image!");
         }
+    }
+
+    void Renderer::NotifyFramebufferResized()
+    {
+        framebufferResized_ = true;
+    }
+
+    void Renderer::RecreateSwapChain()
+    {
+        if (headless_)
+        {
+            return;
+        }
+
+        // A minimised window has no area to present to, wait until it is restored
+        int width = 0, height = 0;
+        glfwGetFramebufferSize(window_, &width, &height);
+        while (width == 0 || height == 0)
+        {
+            glfwWaitEvents();
+            glfwGetFramebufferSize(window_, &width, &height);
+        }
+
+        framebufferResized_ = false;
+
+        // The framebuffers and image views may still be in use by frames in flight
+        vkDeviceWaitIdle(logicalDevice_);
+
+        for (VkFramebuffer& framebuffer : swapChainFramebuffers_)
+        {
+            vkDestroyFramebuffer(logicalDevice_, framebuffer, nullptr);
+        }
+        for (SwapchainImage& image : swapChainImages_)
+        {
+            vkDestroyImageView(logicalDevice_, image.imageView, nullptr);
+        }
+        DestroyDepthBuffer();
+
+        // Only the size dependent objects are rebuilt. The surface and depth formats do not change with the
+        // size, so the render pass and the pipeline, whose viewport is dynamic, stay valid
+        swapChainDetails_ = GetSwapChainDetails(physicalDevice_);
+        CreateSwapChain(window_);
+        ConfigureDepthBuffer();
+        ConfigureFrameBuffers();
+        UpdateProjection();
+
+        // The new images have not been rendered to, and the device is idle so no fence is pending
+        imagesInFlight_.assign(swapChainImages_.size(), VK_NULL_HANDLE);
+
+        // Recorded command buffers reference the old framebuffers and extent
+        ++sceneVersion_;
+    }
+
+    void Renderer::UpdateProjection()
+    {
+        float aspectRatio = ((float)selectedSwapChainExtent_.width / (float)selectedSwapChainExtent_.height);
+        // GLM_FORCE_DEPTH_ZERO_TO_ONE is defined for the whole project, so depth maps to Vulkan's [0, 1] range
+        // rather than OpenGL's [-1, 1], which Vulkan would clip in half
+        projectionMatrices_.perspective = glm::perspective(glm::radians(45.0f), aspectRatio, 0.1f, 100.0f);
+        // Vulkan's Y coordinate is inverted
+        projectionMatrices_.perspective[1][1] *= -1;
+    }
+
+    void Renderer::WaitIdle()
+    {
+        // Uploads recorded since the last frame are submitted first, so waiting also covers them
+        uploadManager_->Flush();
+        vkDeviceWaitIdle(logicalDevice_);
+
+        // Frames still in flight have finished too, so their results can be reported
+        profiler_->CollectPending();
+    }
+
+    void Renderer::SetProfileOutput(const std::string& path)
+    {
+        profiler_->SetOutput(path);
+    }
+
+    static uint32_t GetFormatPixelSize(VkFormat format)
+    {
+        switch (format)
+        {
+        case VK_FORMAT_R8G8B8A8_UNORM:
+        case VK_FORMAT_R8G8B8A8_SRGB:
+        case VK_FORMAT_B8G8R8A8_UNORM:
+        case VK_FORMAT_B8G8R8A8_SRGB:
+        case VK_FORMAT_A2B10G10R10_UNORM_PACK32:
+            return 4;
+        case VK_FORMAT_R16G16B16A16_UNORM:
+        case VK_FORMAT_R16G16B16A16_SFLOAT:
+            return 8;
+        case VK_FORMAT_R32G32B32A32_SFLOAT:
+            return 16;
+        default:
+            throw std::runtime_error("Readback is not supported for the offscreen format!");
+        }
+    }
+
+    std::vector<uint8_t> Renderer::ReadbackImage()
+    {
+        if (!headless_ || !headlessConfig_.enableReadback)
+        {
+            throw std::runtime_error("Readback requires a headless Renderer with readback enabled!");
+        }
 
-        currentFrame_ = (currentFrame_ + 1) % MAX_FRAME_DRAWS;
+        // Make sure the frame that rendered the image has finished
+        vkQueueWaitIdle(graphicsQueue_);
+
+        VkDeviceSize imageSize = (VkDeviceSize)selectedSwapChainExtent_.width * selectedSwapChainExtent_.height
+            * GetFormatPixelSize(selectedSwapChainImageFormat_);
+
+        VkBuffer readbackBuffer;
+        MemoryAllocation readbackBufferMemory;
+        allocator_->CreateBuffer(imageSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, readbackBuffer,
+            readbackBufferMemory);
+
+        VkCommandBuffer commandBuffer = BeginCommandBuffer(logicalDevice_, commandPool_);
+
+        // Zero row length/height means the rows are tightly packed
+        VkBufferImageCopy copyRegion{};
+        copyRegion.bufferOffset = 0;
+        copyRegion.bufferRowLength = 0;
+        copyRegion.bufferImageHeight = 0;
+        copyRegion.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        copyRegion.imageSubresource.mipLevel = 0;
+        copyRegion.imageSubresource.baseArrayLayer = 0;
+        copyRegion.imageSubresource.layerCount = 1;
+        copyRegion.imageOffset = { 0, 0, 0 };
+        copyRegion.imageExtent = { selectedSwapChainExtent_.width, selectedSwapChainExtent_.height, 1 };
+
+        vkCmdCopyImageToBuffer(commandBuffer, swapChainImages_[lastRenderedImage_].image,
+            VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, readbackBuffer, 1, &copyRegion);
+
+        // Make the copied data visible to the host
+        VkBufferMemoryBarrier hostBarrier{};
+        hostBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+        hostBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        hostBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+        hostBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        hostBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        hostBarrier.buffer = readbackBuffer;
+        hostBarrier.offset = 0;
+        hostBarrier.size = VK_WHOLE_SIZE;
+
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0,
+            0, nullptr, 1, &hostBarrier, 0, nullptr);
+
+        EndAndSubmitCommandBuffer(logicalDevice_, graphicsQueue_, commandPool_, commandBuffer);
+
+        std::vector<uint8_t> pixels((size_t)imageSize);
+        memcpy(pixels.data(), readbackBufferMemory.mappedData, (size_t)imageSize);
+
+        allocator_->DestroyBuffer(readbackBuffer, readbackBufferMemory);
+
+        return pixels;
     }
 
     VkShaderModule Renderer::CreateShaderModule(const std::vector<char>& code)
@@ -923,9 +1994,11 @@ namespace p3d
     {
         VkDescriptorSetLayoutBinding projectionMatrixBinding {};
         projectionMatrixBinding.binding = 0;
-        projectionMatrixBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+        projectionMatrixBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
         projectionMatrixBinding.descriptorCount = 1;
-        projectionMatrixBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+        // The cull pass extracts its frustum planes from the same matrices
+        projectionMatrixBinding.stageFlags = gpuCulling_ ? VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_COMPUTE_BIT
+            : VK_SHADER_STAGE_VERTEX_BIT;
         projectionMatrixBinding.pImmutableSamplers = nullptr;
 
         VkDescriptorSetLayoutCreateInfo layoutCreateInfo {};
@@ -939,80 +2012,227 @@ namespace p3d
         {
             throw std::runtime_error("Failed to create a Descriptor Set Layout!");
         }
+
+        if (!gpuCulling_)
+        {
+            return;
+        }
+
+        // Objects, draw commands, the object each draw belongs to and the draw counts. The vertex shader
+        // only reads the objects and which one each draw belongs to
+        std::array<VkDescriptorSetLayoutBinding, 4> cullBindings{};
+        for (uint32_t i = 0; i < (uint32_t)cullBindings.size(); ++i)
+        {
+            cullBindings[i].binding = i;
+            cullBindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            cullBindings[i].descriptorCount = 1;
+            cullBindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+        }
+        cullBindings[0].stageFlags |= VK_SHADER_STAGE_VERTEX_BIT;
+        cullBindings[2].stageFlags |= VK_SHADER_STAGE_VERTEX_BIT;
+
+        VkDescriptorSetLayoutCreateInfo cullLayoutCreateInfo {};
+        cullLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+        cullLayoutCreateInfo.bindingCount = (uint32_t)cullBindings.size();
+        cullLayoutCreateInfo.pBindings = cullBindings.data();
+
+        result = vkCreateDescriptorSetLayout(logicalDevice_, &cullLayoutCreateInfo, nullptr, &cullDescriptorSetLayout_);
+        if (result != VK_SUCCESS)
+        {
+            throw std::runtime_error("Failed to create the culling Descriptor Set Layout!");
+        }
     }
 
     void Renderer::ConfigureUniformBuffers()
     {
-        VkDeviceSize bufferSize = sizeof(ProjectionMatrices);
+        uniformRing_ = std::make_unique<UniformRingBuffer>(*allocator_, UNIFORM_RING_FRAME_SIZE,
+            presentationConfig_.framesInFlight);
 
-        uniformBuffer_.resize(swapChainImages_.size());
-        uniformBufferMemory_.resize(swapChainImages_.size());
-
-        for (size_t i = 0; i < swapChainImages_.size(); ++i)
+        for (uint32_t i = 0; i < (uint32_t)frames_.size(); ++i)
         {
-            CreateBuffer(physicalDevice_, logicalDevice_, bufferSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, uniformBuffer_[i],
-                uniformBufferMemory_[i]);
+            frames_[i].uniformOffset = uniformRing_->GetFrameOffset(i);
         }
     }
 
     void Renderer::ConfigureDescriptorPool()
     {
         VkDescriptorPoolSize poolSize {};
-        poolSize.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-        poolSize.descriptorCount = (uint32_t)swapChainImages_.size();
+        poolSize.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+        poolSize.descriptorCount = 1;
 
         VkDescriptorPoolCreateInfo poolCreateInfo {};
         poolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
         poolCreateInfo.poolSizeCount = 1;
         poolCreateInfo.pPoolSizes = &poolSize;
-        poolCreateInfo.maxSets = (uint32_t)swapChainImages_.size();
+        poolCreateInfo.maxSets = 1;
 
         VkResult result = vkCreateDescriptorPool(logicalDevice_, &poolCreateInfo, nullptr, &descriptorPool_);
         if (result != VK_SUCCESS)
         {
             throw std::runtime_error("Failed to create a Descriptor Pool!");
         }
+
+        if (!gpuCulling_)
+        {
+            return;
+        }
+
+        // One culling set per frame in flight, each pointing at the frame's own buffers
+        VkDescriptorPoolSize cullPoolSize {};
+        cullPoolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        cullPoolSize.descriptorCount = 4 * (uint32_t)frames_.size();
+
+        VkDescriptorPoolCreateInfo cullPoolCreateInfo {};
+        cullPoolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+        cullPoolCreateInfo.poolSizeCount = 1;
+        cullPoolCreateInfo.pPoolSizes = &cullPoolSize;
+        cullPoolCreateInfo.maxSets = (uint32_t)frames_.size();
+
+        result = vkCreateDescriptorPool(logicalDevice_, &cullPoolCreateInfo, nullptr, &cullDescriptorPool_);
+        if (result != VK_SUCCESS)
+        {
+            throw std::runtime_error("Failed to create the culling Descriptor Pool!");
+        }
     }
 
     void Renderer::ConfigureDescriptorSets()
     {
-        size_t uniformBufferSize = uniformBuffer_.size();
-
-        std::vector<VkDescriptorSetLayout> layouts(uniformBufferSize, descriptorSetLayout_);
         VkDescriptorSetAllocateInfo allocateInfo {};
         allocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
         allocateInfo.descriptorPool = descriptorPool_;
-        allocateInfo.descriptorSetCount = (uint32_t)uniformBufferSize;
-        allocateInfo.pSetLayouts = layouts.data();
+        allocateInfo.descriptorSetCount = 1;
+        allocateInfo.pSetLayouts = &descriptorSetLayout_;
 
-        descriptorSets_.resize(uniformBufferSize);
-        VkResult result = vkAllocateDescriptorSets(logicalDevice_, &allocateInfo, descriptorSets_.data());
+        VkResult result = vkAllocateDescriptorSets(logicalDevice_, &allocateInfo, &descriptorSet_);
         if (result != VK_SUCCESS)
         {
             throw std::runtime_error("Failed to allocate Descriptor Sets!");
         }
 
-        for (size_t i = 0; i < uniformBufferSize; ++i)
+        // The range covers one block, the dynamic offset supplied at bind time selects which one
+        VkDescriptorBufferInfo bufferInfo {};
+        bufferInfo.buffer = uniformRing_->GetBuffer();
+        bufferInfo.offset = 0;
+        bufferInfo.range = sizeof(ProjectionMatrices);
+
+        VkWriteDescriptorSet descriptorWrite {};
+        descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        descriptorWrite.dstSet = descriptorSet_;
+        descriptorWrite.dstBinding = 0;
+        descriptorWrite.dstArrayElement = 0;
+        descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+        descriptorWrite.descriptorCount = 1;
+        descriptorWrite.pBufferInfo = &bufferInfo;
+
+        vkUpdateDescriptorSets(logicalDevice_, 1, &descriptorWrite, 0, nullptr);
+
+        if (!gpuCulling_)
+        {
+            return;
+        }
+
+        DrawBufferLayout drawLayout = GetDrawBufferLayout(
+            allocator_->GetPhysicalDeviceProperties().limits.minStorageBufferOffsetAlignment, DRAW_LIST_COUNT);
+
+        for (FrameContext& frame : frames_)
+        {
+            VkDescriptorSetAllocateInfo cullAllocateInfo {};
+            cullAllocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+            cullAllocateInfo.descriptorPool = cullDescriptorPool_;
+            cullAllocateInfo.descriptorSetCount = 1;
+            cullAllocateInfo.pSetLayouts = &cullDescriptorSetLayout_;
+
+            result = vkAllocateDescriptorSets(logicalDevice_, &cullAllocateInfo, &frame.cullDescriptorSet);
+            if (result != VK_SUCCESS)
+            {
+                throw std::runtime_error("Failed to allocate a culling Descriptor Set!");
+            }
+
+            std::array<VkDescriptorBufferInfo, 4> cullBufferInfos {};
+            cullBufferInfos[0] = { frame.objectBuffer, 0, VK_WHOLE_SIZE };
+            cullBufferInfos[1] = { frame.drawBuffer, drawLayout.commandsOffset,
+                drawLayout.objectIdsOffset - drawLayout.commandsOffset };
+            cullBufferInfos[2] = { frame.drawBuffer, drawLayout.objectIdsOffset,
+                drawLayout.size - drawLayout.objectIdsOffset };
+            cullBufferInfos[3] = { frame.drawBuffer, drawLayout.countsOffset, DRAW_LIST_COUNT * sizeof(uint32_t) };
+
+            std::array<VkWriteDescriptorSet, 4> cullWrites {};
+            for (uint32_t i = 0; i < (uint32_t)cullWrites.size(); ++i)
+            {
+                cullWrites[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+                cullWrites[i].dstSet = frame.cullDescriptorSet;
+                cullWrites[i].dstBinding = i;
+                cullWrites[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+                cullWrites[i].descriptorCount = 1;
+                cullWrites[i].pBufferInfo = &cullBufferInfos[i];
+            }
+
+            vkUpdateDescriptorSets(logicalDevice_, (uint32_t)cullWrites.size(), cullWrites.data(), 0, nullptr);
+        }
+    }
+
+    void Renderer::ConfigureCullingBuffers()
+    {
+        DrawBufferLayout drawLayout = GetDrawBufferLayout(
+            allocator_->GetPhysicalDeviceProperties().limits.minStorageBufferOffsetAlignment, DRAW_LIST_COUNT);
+
+        // Objects are written by the CPU as they change, so every frame in flight has a mapped copy. The draw
+        // lists are only ever written by the cull pass
+        for (FrameContext& frame : frames_)
         {
-            VkDescriptorBufferInfo bufferInfo {};
-            bufferInfo.buffer = uniformBuffer_[i];
-            bufferInfo.offset = 0;
-            bufferInfo.range = sizeof(ProjectionMatrices);
+            allocator_->CreateBuffer(GPU_CULLING_OBJECT_CAPACITY * sizeof(GpuObjectData),
+                VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT
+                | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, frame.objectBuffer, frame.objectMemory);
 
-            VkWriteDescriptorSet descriptorWrite {};
-            descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-            descriptorWrite.dstSet = descriptorSets_[i];
-            descriptorWrite.dstBinding = 0;
-            descriptorWrite.dstArrayElement = 0;
-            descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-            descriptorWrite.descriptorCount = 1;
-            descriptorWrite.pBufferInfo = &bufferInfo;
+            allocator_->CreateBuffer(drawLayout.size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT
+                | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, frame.drawBuffer, frame.drawMemory);
 
-            vkUpdateDescriptorSets(logicalDevice_, 1, &descriptorWrite, 0, nullptr);
+            // Every object logged so far still has to be written
+            frame.syncedObjectChange = objectChangesBase_;
         }
     }
 
+    void Renderer::SyncGpuObjects(FrameContext& frame)
+    {
+        GpuObjectData* gpuObjects = static_cast<GpuObjectData*>(frame.objectMemory.mappedData);
+
+        uint64_t changeEnd = objectChangesBase_ + objectChanges_.size();
+        for (uint64_t change = frame.syncedObjectChange; change < changeEnd; ++change)
+        {
+            uint32_t objectId = objectChanges_[(size_t)(change - objectChangesBase_)];
+            RenderObject& object = objects_[objectId];
+            VertexDequantization dequantization = object.mesh.GetDequantization();
+
+            // Built on the stack and copied as a whole, the mapping may be write combined
+            GpuObjectData gpuObject{};
+            gpuObject.model = object.model;
+            gpuObject.positionScale = glm::vec4(dequantization.scale, 0.0f);
+            gpuObject.positionOffset = glm::vec4(dequantization.offset, 0.0f);
+            gpuObject.boundsMin = glm::vec4(object.boundsMin, 0.0f);
+            gpuObject.boundsMax = glm::vec4(object.boundsMax, 0.0f);
+            gpuObject.indexCount = (uint32_t)object.mesh.GetIndexCount(object.lod);
+            gpuObject.firstIndex = object.mesh.GetFirstIndex(object.lod);
+            gpuObject.vertexOffset = object.mesh.GetVertexOffset();
+            gpuObject.firstInstance = object.instances.firstInstance;
+            gpuObject.instanceCount = object.instances.instanceCount;
+            gpuObject.drawList = object.drawList;
+            gpuObject.drawSlot = object.drawSlot;
+            gpuObjects[objectId] = gpuObject;
+        }
+        frame.syncedObjectChange = changeEnd;
+
+        // Entries every frame has copied are no longer needed
+        uint64_t oldestSynced = changeEnd;
+        for (const FrameContext& otherFrame : frames_)
+        {
+            oldestSynced = std::min(oldestSynced, otherFrame.syncedObjectChange);
+        }
+        objectChanges_.erase(objectChanges_.begin(),
+            objectChanges_.begin() + (size_t)(oldestSynced - objectChangesBase_));
+        objectChangesBase_ = oldestSynced;
+    }
+
     bool Renderer::CheckInstanceExtensionSupport(std::vector<const char*>& requiredExtensions)
     {
         bool allExtensionsSupported = true;
@@ -1048,6 +2268,12 @@ namespace p3d
 
     bool Renderer::CheckDeviceExtensionSupport(VkPhysicalDevice device)
     {
+        // Headless rendering does not require any device extensions
+        if (headless_)
+        {
+            return true;
+        }
+
         bool allExtensionsSupported = false;
 
         // Get device extension count
@@ -1092,9 +2318,6 @@ namespace p3d
 
     void Renderer::InitSynchronisation()
     {
-        imageAvailable_.resize(MAX_FRAME_DRAWS);
-        renderFinished_.resize(MAX_FRAME_DRAWS);
-        drawFences_.resize(MAX_FRAME_DRAWS);
 
         // Semaphore creation information
         VkSemaphoreCreateInfo semaphoreCreateInfo = {};
@@ -1105,92 +2328,405 @@ namespace p3d
         fenceCreateInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
         fenceCreateInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
 
-        for (size_t i = 0; i < MAX_FRAME_DRAWS; i++)
+        for (FrameContext& frame : frames_)
         {
-            if (vkCreateSemaphore(logicalDevice_, &semaphoreCreateInfo, nullptr, &imageAvailable_[i]) != VK_SUCCESS ||
-                vkCreateSemaphore(logicalDevice_, &semaphoreCreateInfo, nullptr, &renderFinished_[i]) != VK_SUCCESS ||
-                vkCreateFence(logicalDevice_, &fenceCreateInfo, nullptr, &drawFences_[i]) != VK_SUCCESS)
+            if (vkCreateSemaphore(logicalDevice_, &semaphoreCreateInfo, nullptr, &frame.imageAvailable) != VK_SUCCESS ||
+                vkCreateSemaphore(logicalDevice_, &semaphoreCreateInfo, nullptr, &frame.renderFinished) != VK_SUCCESS ||
+                vkCreateFence(logicalDevice_, &fenceCreateInfo, nullptr, &frame.inFlight) != VK_SUCCESS)
             {
                 throw std::runtime_error("Failed to create a Semaphore and/or Fence!");
             }
         }
+
+        // No image has been rendered to yet
+        imagesInFlight_.assign(swapChainImages_.size(), VK_NULL_HANDLE);
+    }
+
+    Renderer::Renderer(GLFWwindow* window, const PresentationConfig& presentationConfig,
+        const GeometryConfig& geometryConfig) : presentationConfig_(presentationConfig),
+        vertexLayout_(geometryConfig.vertexFormat, geometryConfig.vertexNormals),
+        optimizeMeshes_(geometryConfig.optimizeMeshes), gpuCulling_(geometryConfig.gpuCulling),
+        generateLods_(geometryConfig.generateLods), lodPixelError_(geometryConfig.lodPixelError)
+    {
+        Initialise(window);
+    }
+
+    Renderer::Renderer(const HeadlessConfig& config, const PresentationConfig& presentationConfig,
+        const GeometryConfig& geometryConfig) : headless_(true), headlessConfig_(config),
+        presentationConfig_(presentationConfig), vertexLayout_(geometryConfig.vertexFormat, geometryConfig.vertexNormals),
+        optimizeMeshes_(geometryConfig.optimizeMeshes), gpuCulling_(geometryConfig.gpuCulling),
+        generateLods_(geometryConfig.generateLods), lodPixelError_(geometryConfig.lodPixelError)
+    {
+        Initialise(nullptr);
     }
 
-    Renderer::Renderer(GLFWwindow* window)
+    void Renderer::Initialise(GLFWwindow* window)
     {
+        if (presentationConfig_.framesInFlight == 0)
+        {
+            throw std::runtime_error("At least one frame must be allowed in flight!");
+        }
+
+        window_ = window;
         CreateVulkanInstance();
 #ifdef VALIDATION_LAYERS_ENABLED 
         CreateDebugCallback();
 #endif
-        CreateSurface(window);
+        if (!headless_)
+        {
+            CreateSurface(window);
+        }
         ConfigurePhysicalDeviceAndSwapChainDetails();
         ConfigureLogicalDevice();
-        CreateSwapChain(window);
+        allocator_ = std::make_unique<MemoryAllocator>(physicalDevice_, logicalDevice_);
+        pipelineCache_ = std::make_unique<PipelineCache>(physicalDevice_, logicalDevice_, PIPELINE_CACHE_PATH);
+        uploadManager_ = std::make_unique<UploadManager>(*allocator_, transferQueue_,
+            *queueFamilyIndices_.transferFamily, graphicsQueue_, *queueFamilyIndices_.graphicsFamily);
+        geometryPool_ = std::make_unique<GeometryPool>(*allocator_, *uploadManager_, vertexLayout_.GetStride(),
+            GEOMETRY_POOL_VERTEX_CAPACITY, GEOMETRY_POOL_INDEX_CAPACITY);
+        instancePool_ = std::make_unique<InstancePool>(*allocator_, *uploadManager_, INSTANCE_POOL_CAPACITY);
+        identityInstance_ = instancePool_->Allocate({ InstanceData{} });
+        if (headless_)
+        {
+            CreateOffscreenTargets();
+        }
+        else
+        {
+            CreateSwapChain(window);
+        }
+        ConfigureDepthBuffer();
         ConfigureRenderPass();
         ConfigureDescriptorSetLayout();
         ConfigureGraphicsPipeline();
+        if (gpuCulling_)
+        {
+            ConfigureComputePipeline();
+        }
         ConfigureFrameBuffers();
         ConfigureCommandPool();
 
-        float aspectRatio = ((float)selectedSwapChainExtent_.width / (float)selectedSwapChainExtent_.height);
-        projectionMatrices_.perspective = glm::perspective(glm::radians(45.0f), aspectRatio, 0.1f, 100.0f);
-        // Vulkan's Y coordinate is inverted
-        projectionMatrices_.perspective[1][1] *= -1;
+        UpdateProjection();
         projectionMatrices_.view = glm::lookAt(glm::vec3(0.0f, 0.0f, 2.0f), glm::vec3(0.0f, 0.0f, 0.0f),
             glm::vec3(0.0f, 1.0f, 0.0f));
-        projectionMatrices_.model = glm::mat4(1.0f);
 
         GenerateMeshes();
+        threadPool_ = std::make_unique<ThreadPool>();
+        profiler_ = std::make_unique<GpuProfiler>(physicalDevice_, logicalDevice_, *queueFamilyIndices_.graphicsFamily,
+            presentationConfig_.framesInFlight, enabledFeatures_.pipelineStatisticsQuery == VK_TRUE);
         ConfigureCommandBuffers();
         ConfigureUniformBuffers();
+        if (gpuCulling_)
+        {
+            ConfigureCullingBuffers();
+        }
         ConfigureDescriptorPool();
         ConfigureDescriptorSets();
-        RecordCommands();
         InitSynchronisation();
+
+        // Persist straight away rather than only at shutdown, a worker that is killed still warms the next start
+        pipelineCache_->Save();
     }
 
     void Renderer::GenerateMeshes()
     {
-        meshes_.clear();
+        objects_.clear();
+        culler_.Resize(0);
+        drawListSizes_ = {};
+        lodObjects_.clear();
 
-        meshes_.push_back(std::move(Mesh(physicalDevice_, logicalDevice_, graphicsQueue_, commandPool_,
+        RenderObject quad;
+        quad.mesh = CreateMesh(
             {{{ -0.5, 0.5, 0.0 },{ 1.0f, 0.0f, 0.0f }},
             {{ 0.5, 0.5, 0.0 },{ 0.0f, 1.0f, 0.0f }},
             {{ 0.5, -0.5, 0.0 },{ 0.0f, 0.0f, 1.0f }},
             {{ -0.5, -0.5, 0.0 },{ 1.0f, 1.0f, 0.0f }},},
-            {0, 1, 2,2, 3, 0})));
+            {0, 1, 2,2, 3, 0});
+        AddObject(std::move(quad), {});
     }
 
-    Renderer::~Renderer()
+    uint32_t Renderer::AddObject(RenderObject&& object, const std::vector<InstanceData>& instances)
     {
-        vkDeviceWaitIdle(logicalDevice_);
+        if (gpuCulling_ && objects_.size() >= GPU_CULLING_OBJECT_CAPACITY)
+        {
+            throw std::runtime_error("GPU culling object capacity exceeded!");
+        }
 
-        vkDestroyDescriptorPool(logicalDevice_, descriptorPool_, nullptr);
-        vkDestroyDescriptorSetLayout(logicalDevice_, descriptorSetLayout_, nullptr);
-        for (size_t i = 0; i < uniformBuffer_.size(); i++)
+        const MeshBounds& meshBounds = object.mesh.GetBounds();
+        object.boundsMin = meshBounds.min;
+        object.boundsMax = meshBounds.max;
+        object.sphereCentre = meshBounds.sphereCentre;
+        object.sphereRadius = meshBounds.sphereRadius;
+
+        if (instances.empty())
         {
-            vkDestroyBuffer(logicalDevice_, uniformBuffer_[i], nullptr);
-            vkFreeMemory(logicalDevice_, uniformBufferMemory_[i], nullptr);
+            object.instances = identityInstance_;
         }
+        else
+        {
+            object.instances = instancePool_->Allocate(instances);
+
+            // Instances may be spread far apart, the object's box has to cover all of them
+            object.boundsMin = glm::vec3(std::numeric_limits<float>::max());
+            object.boundsMax = glm::vec3(std::numeric_limits<float>::lowest());
+            for (const InstanceData& instance : instances)
+            {
+                glm::vec3 instanceMin, instanceMax;
+                FrustumCuller::TransformBox(instance.model, meshBounds.min, meshBounds.max, instanceMin, instanceMax);
+                object.boundsMin = glm::min(object.boundsMin, instanceMin);
+                object.boundsMax = glm::max(object.boundsMax, instanceMax);
+
+                float scaleSquared = std::max(std::max(glm::dot(instance.model[0], instance.model[0]),
+                    glm::dot(instance.model[1], instance.model[1])), glm::dot(instance.model[2], instance.model[2]));
+                object.instanceScale = std::max(object.instanceScale, std::sqrt(scaleSquared));
+            }
 
-        meshes_.clear();
+            object.sphereCentre = (object.boundsMin + object.boundsMax) * 0.5f;
+            object.sphereRadius = glm::length(object.boundsMax - object.boundsMin) * 0.5f;
+        }
 
-        for (size_t i = 0; i < MAX_FRAME_DRAWS; i++)
+        if (gpuCulling_)
         {
-            vkDestroySemaphore(logicalDevice_, renderFinished_[i], nullptr);
-            vkDestroySemaphore(logicalDevice_, imageAvailable_[i], nullptr);
-            vkDestroyFence(logicalDevice_, drawFences_[i], nullptr);
+            object.drawList = object.mesh.GetIndexType() == VK_INDEX_TYPE_UINT16 ? 0 : 1;
+            object.drawSlot = drawListSizes_[object.drawList]++;
         }
 
+        // Command buffers are recorded every frame, so the object is drawn from the next frame on
+        objects_.push_back(std::move(object));
+        uint32_t objectId = (uint32_t)(objects_.size() - 1);
+        if (objects_.back().mesh.GetLodCount() > 1)
+        {
+            lodObjects_.push_back(objectId);
+        }
+        if (gpuCulling_)
+        {
+            objectChanges_.push_back(objectId);
+        }
+        else
+        {
+            culler_.Resize((uint32_t)objects_.size());
+            UpdateObjectBounds(objectId);
+        }
+        ++sceneVersion_;
+
+        // The mesh and instance uploads go out with the next frame's flush, so objects added in bulk share a batch
+        return objectId;
+    }
+
+    void Renderer::UpdateObjectBounds(uint32_t objectId)
+    {
+        const RenderObject& object = objects_[objectId];
+        glm::vec3 worldMin, worldMax;
+        FrustumCuller::TransformBox(object.model, object.boundsMin, object.boundsMax, worldMin, worldMax);
+        culler_.SetBounds(objectId, worldMin, worldMax);
+    }
+
+    void Renderer::CullObjects()
+    {
+        culler_.Cull(projectionMatrices_.perspective * projectionMatrices_.view, cullResults_);
+    }
+
+    void Renderer::SortVisibleObjects()
+    {
+        // Depth of each object's sphere centre along the view direction. Every object is opaque, so the
+        // nearest are drawn first and fill the depth buffer for the ones behind them
+        const glm::mat4& view = projectionMatrices_.view;
+        glm::vec4 depthRow(-view[0][2], -view[1][2], -view[2][2], -view[3][2]);
+
+        drawSortKeys_.resize(cullResults_.size());
+        for (size_t i = 0; i < cullResults_.size(); ++i)
+        {
+            uint32_t objectId = cullResults_[i];
+            const RenderObject& object = objects_[objectId];
+            float depth = glm::dot(depthRow, object.model * glm::vec4(object.sphereCentre, 1.0f));
+            drawSortKeys_[i] = ((uint64_t)GetOrderedFloatBits(depth) << 32) | objectId;
+        }
+
+        // Ids break ties between objects at the same depth, so the order is stable from frame to frame
+        std::sort(drawSortKeys_.begin(), drawSortKeys_.end());
+        for (size_t i = 0; i < drawSortKeys_.size(); ++i)
+        {
+            cullResults_[i] = (uint32_t)drawSortKeys_[i];
+        }
+
+        if (cullResults_ != visibleObjects_)
+        {
+            visibleObjects_.swap(cullResults_);
+            ++sceneVersion_;
+        }
+    }
+
+    void Renderer::SelectLods()
+    {
+        if (lodObjects_.empty())
+        {
+            return;
+        }
+
+        // Pixels one world space unit covers at a distance of one, along the height of the screen
+        float pixelsPerUnit = 0.5f * (float)selectedSwapChainExtent_.height
+            * std::fabs(projectionMatrices_.perspective[1][1]);
+        glm::vec3 eye = glm::vec3(glm::inverse(projectionMatrices_.view)[3]);
+
+        // Only recorded objects matter on the CPU path, the cull pass draws from every object's data
+        const std::vector<uint32_t>& candidates = gpuCulling_ ? lodObjects_ : visibleObjects_;
+        for (uint32_t objectId : candidates)
+        {
+            RenderObject& object = objects_[objectId];
+            if (object.mesh.GetLodCount() == 1)
+            {
+                continue;
+            }
+
+            const glm::mat4& model = object.model;
+            float scale = std::sqrt(std::max(std::max(glm::dot(model[0], model[0]), glm::dot(model[1], model[1])),
+                glm::dot(model[2], model[2])));
+            glm::vec3 centre = glm::vec3(model * glm::vec4(object.sphereCentre, 1.0f));
+            float distance = glm::length(centre - eye) - object.sphereRadius * scale;
+
+            // Full detail while the camera is inside the sphere
+            uint32_t lod = 0;
+            if (distance > 0.0f)
+            {
+                float pixelsPerModelUnit = pixelsPerUnit * scale * object.instanceScale / distance;
+
+                // Too coarse levels are left straight away, coarser ones only once clearly within the threshold
+                lod = object.lod;
+                if (object.mesh.GetLodError(lod) * pixelsPerModelUnit > lodPixelError_)
+                {
+                    lod = GetCoarsestLodWithin(object.mesh, pixelsPerModelUnit, lodPixelError_);
+                }
+                else
+                {
+                    lod = std::max(lod, GetCoarsestLodWithin(object.mesh, pixelsPerModelUnit,
+                        lodPixelError_ * (1.0f - LOD_HYSTERESIS)));
+                }
+            }
+
+            if (lod != object.lod)
+            {
+                object.lod = lod;
+                if (gpuCulling_)
+                {
+                    objectChanges_.push_back(objectId);
+                }
+                else
+                {
+                    ++sceneVersion_;
+                }
+            }
+        }
+    }
+
+    Mesh Renderer::CreateMesh(std::vector<Vertex> vertices, std::vector<uint32_t> indices)
+    {
+        if (optimizeMeshes_)
+        {
+            MeshOptimizationReport report = MeshOptimizer::Optimize(vertices, indices);
+            printf("Mesh optimised: %u -> %u vertices, ACMR %.3f -> %.3f, ATVR %.3f -> %.3f\n",
+                report.vertexCountBefore, report.vertexCountAfter, report.before.acmr, report.after.acmr,
+                report.before.atvr, report.after.atvr);
+        }
+
+        std::vector<MeshLod> lods;
+        if (generateLods_)
+        {
+            lods = MeshSimplifier::GenerateLods(vertices, indices);
+            printf("Mesh LODs: %u levels, %u -> %u triangles, error %.4f\n", (uint32_t)lods.size(),
+                lods.front().indexCount / 3, lods.back().indexCount / 3, lods.back().error);
+        }
+
+        return Mesh(*geometryPool_, vertexLayout_, vertices, indices, lods);
+    }
+
+    uint32_t Renderer::AddInstancedMesh(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices,
+        const std::vector<InstanceData>& instances)
+    {
+        RenderObject object;
+        object.mesh = CreateMesh(vertices, indices);
+        return AddObject(std::move(object), instances);
+    }
+
+    uint32_t Renderer::AddMeshFile(const std::string& path, const std::vector<InstanceData>& instances)
+    {
+        // The mapping only has to outlive the upload, Upload copies every chunk into staging before returning
+        MeshFile meshFile(path);
+
+        RenderObject object;
+        object.mesh = Mesh(*geometryPool_, vertexLayout_, meshFile);
+        return AddObject(std::move(object), instances);
+    }
+
+    void Renderer::SetObjectTransform(uint32_t objectId, const glm::mat4& model)
+    {
+        RenderObject& object = objects_.at(objectId);
+        if (object.model != model)
+        {
+            object.model = model;
+
+            // With GPU culling only the object's data changes, the recorded cull pass and draws stay valid
+            if (gpuCulling_)
+            {
+                objectChanges_.push_back(objectId);
+            }
+            else
+            {
+                UpdateObjectBounds(objectId);
+                ++sceneVersion_;
+            }
+        }
+    }
+
+    Renderer::~Renderer()
+    {
+        vkDeviceWaitIdle(logicalDevice_);
+
+        vkDestroyDescriptorPool(logicalDevice_, descriptorPool_, nullptr);
+        vkDestroyDescriptorSetLayout(logicalDevice_, descriptorSetLayout_, nullptr);
+        vkDestroyDescriptorPool(logicalDevice_, cullDescriptorPool_, nullptr);
+        vkDestroyDescriptorSetLayout(logicalDevice_, cullDescriptorSetLayout_, nullptr);
+        uniformRing_.reset();
+
+        objects_.clear();
+        instancePool_.reset();
+        geometryPool_.reset();
+        uploadManager_.reset();
+
         vkDestroyCommandPool(logicalDevice_, commandPool_, nullptr);
 
+        for (FrameContext& frame : frames_)
+        {
+            vkDestroySemaphore(logicalDevice_, frame.renderFinished, nullptr);
+            vkDestroySemaphore(logicalDevice_, frame.imageAvailable, nullptr);
+            vkDestroyFence(logicalDevice_, frame.inFlight, nullptr);
+
+            if (frame.objectBuffer != VK_NULL_HANDLE)
+            {
+                allocator_->DestroyBuffer(frame.objectBuffer, frame.objectMemory);
+                allocator_->DestroyBuffer(frame.drawBuffer, frame.drawMemory);
+            }
+
+            vkDestroyCommandPool(logicalDevice_, frame.commandPool, nullptr);
+            for (SecondaryRecorder& recorder : frame.secondaryRecorders)
+            {
+                vkDestroyCommandPool(logicalDevice_, recorder.commandPool, nullptr);
+            }
+        }
+        threadPool_.reset();
+        profiler_.reset();
+
         for (VkFramebuffer& framebuffer : swapChainFramebuffers_)
         {
             vkDestroyFramebuffer(logicalDevice_, framebuffer, nullptr);
         }
 
         vkDestroyPipeline(logicalDevice_, graphicsPipeline_, nullptr);
+        vkDestroyPipeline(logicalDevice_, indirectPipeline_, nullptr);
+        vkDestroyPipeline(logicalDevice_, cullPipeline_, nullptr);
+        pipelineCache_->Save();
+        pipelineCache_.reset();
         vkDestroyPipelineLayout(logicalDevice_, pipelineLayout_, nullptr);
+        vkDestroyPipelineLayout(logicalDevice_, indirectPipelineLayout_, nullptr);
+        vkDestroyPipelineLayout(logicalDevice_, cullPipelineLayout_, nullptr);
         vkDestroyRenderPass(logicalDevice_, renderPass_, nullptr);
 
         for (SwapchainImage& image : swapChainImages_)
@@ -1198,8 +2734,18 @@ namespace p3d
             vkDestroyImageView(logicalDevice_, image.imageView, nullptr);
         }
 
+        DestroyDepthBuffer();
+
+        // Swapchain images belong to the swapchain, only offscreen targets are owned by the renderer
+        for (size_t i = 0; i < offscreenImageMemory_.size(); ++i)
+        {
+            allocator_->DestroyImage(swapChainImages_[i].image, offscreenImageMemory_[i]);
+        }
+
         vkDestroySwapchainKHR(logicalDevice_, swapchain_, nullptr);
 
+        allocator_.reset();
+
         vkDestroyDevice(logicalDevice_, nullptr);
         vkDestroySurfaceKHR(instance_, surface_, nullptr);
 
@@ -3,14 +3,27 @@
 
 #include <vulkan/vulkan.h>
 #include <vector>
+#include <memory>
 #include <optional>
+#include <array>
+#include <string>
+#include <cstddef>
 
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
+#include "FrustumCuller.h"
+#include "GeometryPool.h"
+#include "GpuProfiler.h"
+#include "InstancePool.h"
+#include "MemoryAllocator.h"
 #include "Mesh.h"
+#include "PipelineCache.h"
+#include "ThreadPool.h"
+#include "UniformRingBuffer.h"
+#include "UploadManager.h"
 #include "Utilities.h"
 
 namespace p3d
@@ -48,6 +61,54 @@ namespace p3d
         VkImageView imageView;
     };
 
+    // Describes the offscreen render targets used when the renderer runs without a window
+    struct HeadlessConfig
+    {
+        uint32_t width = 1024;
+        uint32_t height = 768;
+        VkFormat format = VK_FORMAT_R8G8B8A8_UNORM;
+
+        // Keeps render targets in a transfer source layout so that ReadbackImage can copy them
+        bool enableReadback = false;
+    };
+
+    // Trades latency against throughput. Interactive use wants few queued frames, batch use wants many
+    struct PresentationConfig
+    {
+        // FIFO, which every device supports, is used when the requested mode is unavailable
+        VkPresentModeKHR presentMode = VK_PRESENT_MODE_MAILBOX_KHR;
+
+        // Zero asks for one image more than the surface's minimum. Clamped to what the surface allows
+        uint32_t swapchainImageCount = 0;
+
+        // Frames the CPU may record ahead of the GPU, each with its own command buffers and uniform slice
+        uint32_t framesInFlight = 3;
+    };
+
+    // How geometry is stored on the GPU, compact layouts trade precision for vertex fetch bandwidth and memory
+    struct GeometryConfig
+    {
+        VertexFormat vertexFormat = VertexFormat::Float32;
+
+        // Reserves an octahedral encoded normal in every vertex
+        bool vertexNormals = false;
+
+        // Runs MeshOptimizer over every mesh before it is uploaded and reports the cache statistics it reaches
+        bool optimizeMeshes = false;
+
+        // Culls objects in a compute pass and draws the survivors with indirect draws, so the CPU no longer
+        // touches per-object draw data each frame. Falls back to CPU culling on devices without
+        // VK_KHR_shader_draw_parameters, multiDrawIndirect or drawIndirectFirstInstance
+        bool gpuCulling = false;
+
+        // Simplifies every mesh into a chain of levels of detail before it is uploaded
+        bool generateLods = false;
+
+        // Objects are drawn with the coarsest level whose error projects to no more than this many pixels.
+        // Applies to every mesh with levels, including those loaded from mesh files
+        float lodPixelError = 1.0f;
+    };
+
     class Renderer
     {
     public:
@@ -56,18 +117,57 @@ namespace p3d
             std::optional<uint32_t> graphicsFamily;
             std::optional<uint32_t> presentationFamily;
 
+            // A transfer-only family when the device exposes one, the graphics family otherwise
+            std::optional<uint32_t> transferFamily;
+
             bool AreValid()
             {
                 return graphicsFamily.has_value() && presentationFamily.has_value();
             }
         };
 
-        Renderer(GLFWwindow* window);
+        Renderer(GLFWwindow* window, const PresentationConfig& presentationConfig = {},
+            const GeometryConfig& geometryConfig = {});
+        Renderer(const HeadlessConfig& config, const PresentationConfig& presentationConfig = {},
+            const GeometryConfig& geometryConfig = {});
         ~Renderer();
 
         void Render(float dt);
 
+        // Rebuilds the swap chain before the next frame. Out of date swap chains are detected without it,
+        // but not every platform reports a resize that way
+        void NotifyFramebufferResized();
+
+        // Blocks until all submitted work has finished executing
+        void WaitIdle();
+
+        bool IsHeadless() const { return headless_; }
+
+        // Returns the pixels of the most recently rendered offscreen image as tightly packed rows
+        std::vector<uint8_t> ReadbackImage();
+
+        const MemoryAllocator& GetMemoryAllocator() const { return *allocator_; }
+
+        // Adds a mesh that is drawn once per instance with a single draw call, or once when instances is empty.
+        // Returns the object's id
+        uint32_t AddInstancedMesh(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices,
+            const std::vector<InstanceData>& instances = {});
+
+        // Adds a mesh stored in a mesh file, streaming it from the file's mapping into the staging ring.
+        // Drawn once when instances is empty. Returns the object's id
+        uint32_t AddMeshFile(const std::string& path, const std::vector<InstanceData>& instances = {});
+
+        // Places an object in the world, every instance of it is transformed along with it
+        void SetObjectTransform(uint32_t objectId, const glm::mat4& model);
+
+        // Exports per-frame GPU and CPU timings, CSV unless the path ends in .json
+        void SetProfileOutput(const std::string& path);
+
+        const GpuProfiler& GetProfiler() const { return *profiler_; }
+
     private:
+        // Measures the renderer's internals directly rather than through a public surface made just for it
+        friend class RendererBenchmark;
 
 #ifdef VALIDATION_LAYERS_ENABLED
         void CreateDebugCallback();
@@ -78,77 +178,362 @@ namespace p3d
 
         QueueFamilyIndices queueFamilyIndices_;
 
+        bool headless_ = false;
+        HeadlessConfig headlessConfig_;
+
+        // Only framesInFlight applies when headless, it is also the number of offscreen targets
+        PresentationConfig presentationConfig_;
+
         VkInstance instance_;
 
-        VkPhysicalDevice physicalDevice_;
+        VkPhysicalDevice physicalDevice_ = VK_NULL_HANDLE;
         VkDevice logicalDevice_;
+        VkPhysicalDeviceFeatures enabledFeatures_{};
+
+        // Sub-allocates every buffer and image the renderer and its meshes create
+        std::unique_ptr<MemoryAllocator> allocator_;
+
+        // Persisted across runs so that pipelines do not have to be compiled from scratch on every start
+        std::unique_ptr<PipelineCache> pipelineCache_;
+
+        // VK_EXT_pipeline_creation_feedback reports whether a pipeline was found in the cache
+        bool pipelineFeedbackSupported_ = false;
+
+        // From VK_KHR_draw_indirect_count when available. Without it every object is drawn indirectly and
+        // culled ones are given an instance count of zero
+        PFN_vkCmdDrawIndexedIndirectCountKHR drawIndexedIndirectCount_ = nullptr;
+
+        // Batches mesh uploads on the transfer queue. Each batch is acquired on the graphics queue,
+        // which orders it ahead of any draw submitted afterwards
+        std::unique_ptr<UploadManager> uploadManager_;
+
+        // Every mesh lives in these shared buffers, so they are bound once per command buffer
+        std::unique_ptr<GeometryPool> geometryPool_;
+
+        // Format of the vertices in the geometry pool, the pipeline's vertex input is generated from it
+        VertexLayout vertexLayout_;
+        bool optimizeMeshes_ = false;
+
+        // Requested through GeometryConfig, cleared again when the device lacks what it needs
+        bool gpuCulling_ = false;
+
+        bool generateLods_ = false;
+        float lodPixelError_ = 1.0f;
+
+        // Per-instance transforms and colours, bound once next to the geometry pool
+        std::unique_ptr<InstancePool> instancePool_;
+
+        // A single identity instance shared by every mesh that is not instanced
+        InstanceRange identityInstance_;
 
         VkQueue graphicsQueue_;
         VkQueue presentationQueue_;
+        VkQueue transferQueue_;
 
-        VkSurfaceKHR surface_;
+        GLFWwindow* window_ = nullptr;
+        VkSurfaceKHR surface_ = VK_NULL_HANDLE;
+        bool framebufferResized_ = false;
 
-        VkSwapchainKHR swapchain_;
+        VkSwapchainKHR swapchain_ = VK_NULL_HANDLE;
         SwapChainDetails swapChainDetails_;
+
+        // Holds the swapchain images, or the offscreen render targets when running headless
         std::vector<SwapchainImage> swapChainImages_;
+        std::vector<MemoryAllocation> offscreenImageMemory_;
+        uint32_t lastRenderedImage_ = 0;
 
         // Container for all frame buffers - one for each swap chain image
         std::vector<VkFramebuffer> swapChainFramebuffers_;
-        std::vector<VkCommandBuffer> commandBuffers_;
+
+        // A secondary command buffer and the pool it comes from, recorded by one thread at a time
+        struct SecondaryRecorder
+        {
+            VkCommandPool commandPool = VK_NULL_HANDLE;
+            VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+        };
+
+        // Everything one frame in flight writes to. All of it is free to reuse once inFlight has signalled,
+        // so the number of these sets how far the CPU may run ahead, independently of the swap chain
+        struct FrameContext
+        {
+            VkCommandPool commandPool = VK_NULL_HANDLE;
+            VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+            std::vector<SecondaryRecorder> secondaryRecorders;
+
+            // What the command buffer was last recorded for, it is replayed while both still match
+            uint64_t recordedSceneVersion = 0;
+            uint32_t recordedImage = 0;
+
+            // Dynamic offset of the frame's slice of the uniform ring
+            uint32_t uniformOffset = 0;
+
+            // GPU culling only. The frame's copy of every object's GpuObjectData, host visible so that
+            // changed objects are written in place, and the draw lists the cull pass builds from it
+            VkBuffer objectBuffer = VK_NULL_HANDLE;
+            MemoryAllocation objectMemory;
+            VkBuffer drawBuffer = VK_NULL_HANDLE;
+            MemoryAllocation drawMemory;
+            VkDescriptorSet cullDescriptorSet = VK_NULL_HANDLE;
+
+            // Position in the object change log up to which objectBuffer is current
+            uint64_t syncedObjectChange = 0;
+
+            VkSemaphore imageAvailable = VK_NULL_HANDLE;
+            VkSemaphore renderFinished = VK_NULL_HANDLE;
+            VkFence inFlight = VK_NULL_HANDLE;
+        };
+
+        std::vector<FrameContext> frames_;
+
+        // The fence of the frame that last rendered into each swap chain image. Images can be acquired out
+        // of order, so an image may still be in use by a different frame than the one acquiring it
+        std::vector<VkFence> imagesInFlight_;
+
+        // Records slices of the draw list in parallel
+        std::unique_ptr<ThreadPool> threadPool_;
+
+        // Timestamps and pipeline statistics, ringed over the frames in flight
+        std::unique_ptr<GpuProfiler> profiler_;
 
         VkFormat selectedSwapChainImageFormat_;
         VkExtent2D selectedSwapChainExtent_;
 
+        // Cleared when the render pass begins and discarded when it ends, so on tiled GPUs it can live in
+        // lazily allocated memory and never be written out. Frames in flight share it, the render pass
+        // orders their depth accesses
+        VkFormat depthFormat_ = VK_FORMAT_UNDEFINED;
+        VkImage depthImage_ = VK_NULL_HANDLE;
+        MemoryAllocation depthImageMemory_;
+        VkImageView depthImageView_ = VK_NULL_HANDLE;
+
         VkPipeline graphicsPipeline_;
         VkPipelineLayout pipelineLayout_;
 
+        // GPU culling only. The cull pass and the graphics pipeline that draws the lists it writes. Both
+        // layouts use set 0 for the projection matrices and set 1 for the culling buffers
+        VkPipeline cullPipeline_ = VK_NULL_HANDLE;
+        VkPipelineLayout cullPipelineLayout_ = VK_NULL_HANDLE;
+        VkPipeline indirectPipeline_ = VK_NULL_HANDLE;
+        VkPipelineLayout indirectPipelineLayout_ = VK_NULL_HANDLE;
+
         VkRenderPass renderPass_;
 
         VkCommandPool commandPool_;
 
-        std::vector<VkSemaphore> imageAvailable_;
-        std::vector<VkSemaphore> renderFinished_;
-        std::vector<VkFence> drawFences_;
-
         int currentFrame_ = 0;
 
-        std::vector<Mesh> meshes_;
+        // A mesh, the instances it is drawn with and where it is placed in the world
+        struct RenderObject
+        {
+            Mesh mesh;
+            InstanceRange instances;
+            glm::mat4 model = glm::mat4(1.0f);
+
+            // Box around the mesh under every instance transform, in the object's space
+            glm::vec3 boundsMin = glm::vec3(0.0f);
+            glm::vec3 boundsMax = glm::vec3(0.0f);
+
+            // GPU culling only. The draw list matching the mesh's index type and the object's place in it
+            uint32_t drawList = 0;
+            uint32_t drawSlot = 0;
+
+            // Sphere the level of detail is chosen from, in the object's space. Covers every instance
+            glm::vec3 sphereCentre = glm::vec3(0.0f);
+            float sphereRadius = 0.0f;
+
+            // Largest scale of any instance, errors of the mesh grow with it
+            float instanceScale = 1.0f;
+
+            // Level of detail the object is currently drawn with
+            uint32_t lod = 0;
+        };
+
+        // An object's index in this list is its id
+        std::vector<RenderObject> objects_;
+
+        // World space bounds of every object, indexed by object id
+        FrustumCuller culler_;
+
+        // Ids of the objects inside the view frustum, nearest first. Only these are recorded
+        std::vector<uint32_t> visibleObjects_;
+
+        // The culler's output for the current frame, sorted and swapped with visibleObjects_ when the two differ
+        std::vector<uint32_t> cullResults_;
+
+        // View depth in the high half and object id in the low half, sorting them sorts the ids front to back
+        std::vector<uint64_t> drawSortKeys_;
 
+        // Ids of the objects whose mesh has more than one level of detail
+        std::vector<uint32_t> lodObjects_;
+
+        // GPU culling writes one draw list per index type, since the index type is bound outside of the
+        // indirect draws. Lists hold 16-bit and 32-bit meshes respectively
+        static constexpr uint32_t DRAW_LIST_COUNT = 2;
+
+        // Objects in each draw list
+        std::array<uint32_t, DRAW_LIST_COUNT> drawListSizes_{};
+
+        // Ids of objects added or moved while GPU culling, every frame copies them into its object buffer
+        // before it is submitted. objectChangesBase_ is the position of the log's first entry, entries
+        // every frame has consumed are dropped
+        std::vector<uint32_t> objectChanges_;
+        uint64_t objectChangesBase_ = 0;
+
+        // Bumped whenever anything that is recorded into the command buffers changes. Starts above
+        // the version FrameContexts start with, so that every frame is recorded at least once
+        uint64_t sceneVersion_ = 1;
+
+        // Per-frame constants, shared by every draw
         struct ProjectionMatrices
         {
             glm::mat4 perspective;
             glm::mat4 view;
-            glm::mat4 model;
         } projectionMatrices_;
 
+        // Bound as the uniform block of every shader, with a descriptor range of exactly this size
+        static_assert(sizeof(ProjectionMatrices) == 2 * sizeof(glm::mat4),
+            "ProjectionMatrices must match the shaders' ProjectionMatrices block");
+
+        // Per-draw constants, pushed before each draw so that objects can move independently
+        struct ObjectPushConstants
+        {
+            glm::mat4 model;
+
+            // The mesh's VertexDequantization, vec4s keep the layout identical to the shader's block
+            glm::vec4 positionScale;
+            glm::vec4 positionOffset;
+
+            uint32_t objectId;
+        };
+
+        // 128 bytes is the smallest maxPushConstantsSize a device may report
+        static_assert(offsetof(ObjectPushConstants, model) == 0 && sizeof(ObjectPushConstants) <= 128,
+            "ObjectPushConstants must match the vertex shader's push constant block");
+        static_assert(offsetof(ObjectPushConstants, positionScale) == 64
+            && offsetof(ObjectPushConstants, positionOffset) == 80 && offsetof(ObjectPushConstants, objectId) == 96,
+            "Dequantization constants must sit at the offsets of the vertex shader's push constant block");
+
+        // An object as the cull pass and the indirect vertex shader see it, must match GpuObject in
+        // Shaders/cull.comp and Shaders/indirect_shader.vert
+        struct GpuObjectData
+        {
+            glm::mat4 model;
+            glm::vec4 positionScale;
+            glm::vec4 positionOffset;
+
+            // Object space box, w is unused
+            glm::vec4 boundsMin;
+            glm::vec4 boundsMax;
+
+            uint32_t indexCount;
+            uint32_t firstIndex;
+            int32_t vertexOffset;
+            uint32_t firstInstance;
+            uint32_t instanceCount;
+            uint32_t drawList;
+            uint32_t drawSlot;
+            uint32_t padding;
+        };
+
+        // Pushed once when the cull pass is recorded, must match CullConstants in Shaders/cull.comp
+        struct CullPushConstants
+        {
+            uint32_t objectCount;
+
+            // Draws reserved per list, list n starts at n * listCapacity
+            uint32_t listCapacity;
+
+            // Non-zero when draws are appended through the count buffer rather than written to fixed slots
+            uint32_t compact;
+            uint32_t depthZeroToOne;
+        };
+
         VkDescriptorSetLayout descriptorSetLayout_;
 
+        // Object buffer, draw commands, the object drawn by each command and the draw counts
+        VkDescriptorSetLayout cullDescriptorSetLayout_ = VK_NULL_HANDLE;
+        VkDescriptorPool cullDescriptorPool_ = VK_NULL_HANDLE;
+
         VkDescriptorPool descriptorPool_;
-        std::vector<VkDescriptorSet> descriptorSets_;
 
-        std::vector<VkBuffer> uniformBuffer_;
-        std::vector<VkDeviceMemory> uniformBufferMemory_;
+        // A single set is enough, each frame selects its slice of the ring with a dynamic offset
+        VkDescriptorSet descriptorSet_;
+
+        std::unique_ptr<UniformRingBuffer> uniformRing_;
 
+        void Initialise(GLFWwindow* window);
         void CreateVulkanInstance();
         void ConfigurePhysicalDeviceAndSwapChainDetails();
         void ConfigureLogicalDevice();
         void CreateSurface(GLFWwindow* window);
         void CreateSwapChain(GLFWwindow* window);
+        void CreateOffscreenTargets();
+
+        // Creates the depth attachment at the size of the colour targets, picking its format the first time
+        void ConfigureDepthBuffer();
+        void DestroyDepthBuffer();
+
+        // Rebuilds the swap chain and everything sized to it. The pipeline and render pass are kept
+        void RecreateSwapChain();
+        void UpdateProjection();
         void ConfigureGraphicsPipeline();
+
+        // Builds a pipeline around the given vertex shader with the fixed function state every draw shares
+        VkPipeline CreateGraphicsPipeline(const std::string& vertexShaderPath, VkPipelineLayout layout,
+            const std::string& name);
+
+        // Creates the cull pass, only called when GPU culling is enabled
+        void ConfigureComputePipeline();
         void ConfigureRenderPass();
         void ConfigureFrameBuffers();
         void ConfigureCommandPool();
         void ConfigureCommandBuffers();
         void GenerateMeshes();
 
+        // Appends the object and registers its bounds with the culler. Returns its id
+        uint32_t AddObject(RenderObject&& object, const std::vector<InstanceData>& instances);
+        void UpdateObjectBounds(uint32_t objectId);
+
+        // Finds the objects that intersect the view frustum
+        void CullObjects();
+
+        // Orders the culled objects front to back, so that early depth testing rejects the fragments of the
+        // objects behind them before they are shaded. A different set or order than last frame is a scene change
+        void SortVisibleObjects();
+
+        // Picks each drawn object's level of detail from the size of its bounding sphere on screen. A changed
+        // level is a scene change, or an object change with GPU culling
+        void SelectLods();
+
+        // Optimises the mesh and generates its levels of detail first when enabled, then uploads it into the
+        // geometry pool
+        Mesh CreateMesh(std::vector<Vertex> vertices, std::vector<uint32_t> indices);
+
         void ConfigureDescriptorSetLayout();
         void ConfigureUniformBuffers();
         void ConfigureDescriptorPool();
         void ConfigureDescriptorSets();
 
-        void UpdateUniformBuffer(uint32_t imageIndex);
+        // Per-frame object buffers and draw lists for GPU culling
+        void ConfigureCullingBuffers();
+
+        // Copies the objects changed since the frame was last submitted into its object buffer
+        void SyncGpuObjects(FrameContext& frame);
+
+        // Records the cull pass ahead of the render pass
+        void RecordCullPass(VkCommandBuffer commandBuffer, FrameContext& frame);
+
+        // Draws both draw lists of the frame, inside a secondary command buffer
+        void RecordIndirectDraws(VkCommandBuffer commandBuffer, FrameContext& frame);
+
+        void UpdateUniformBuffer(uint32_t frameIndex);
+
+        // Records the current frame's command buffer, drawing the visible objects into the given image
+        void RecordCommands(uint32_t imageIndex);
 
-        void RecordCommands();
+        // Records the draws of visibleObjects_[firstVisible, lastVisible)
+        void RecordSecondaryCommands(SecondaryRecorder& recorder, uint32_t taskIndex, VkFramebuffer framebuffer,
+            uint32_t firstVisible, uint32_t lastVisible);
 
         bool CheckInstanceExtensionSupport(std::vector<const char*>& extensionList);
         bool CheckDeviceExtensionSupport(VkPhysicalDevice device);